@@ -0,0 +1,459 @@
+#include "audiooffset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+
+typedef std::complex<double> Complex;
+
+static const int EnvelopeMs = 10; // Length of a sample of the envelopes
+static const int CoarseFactor = 10; // Envelope samples averaged in a sample of the coarse search
+static const int RefineLags = 15; // Envelope samples searched on each side of a coarse offset
+static const int CheckLags = 5; // Envelope samples searched on each side of the offset of the previous window
+static const int SmoothingSamples = 50; // Half of the moving average removed from the envelopes, 1 s in all
+static const double Pi = 3.14159265358979323846;
+
+namespace
+{
+
+// Envelope samples, with the prefix sums of their squares to get the energy of any range in O(1)
+class Envelope
+{
+    std::vector<float> Values;
+    std::vector<double> Energy;
+
+public:
+    explicit Envelope(std::vector<float> &&values) :
+        Values(std::move(values)),
+        Energy(Values.size() + 1, 0.0)
+    {
+        for(std::size_t i = 0; i < Values.size(); ++i)
+        {
+            Energy[i + 1] = Energy[i] + double(Values[i]) * Values[i];
+        }
+    }
+
+    int size() const
+    {
+        return Values.size();
+    }
+
+    float operator[](int i) const
+    {
+        return Values[i];
+    }
+
+    double energy(int first, int last) const
+    {
+        return Energy[last] - Energy[first];
+    }
+
+    // Averages of factor samples
+    Envelope decimate(int factor) const
+    {
+        std::vector<float> Result(Values.size() / factor);
+        for(std::size_t i = 0; i < Result.size(); ++i)
+        {
+            float Sum = 0.0f;
+            for(int k = 0; k < factor; ++k)
+            {
+                Sum += Values[i * factor + k];
+            }
+            Result[i] = Sum / factor;
+        }
+        return Envelope(std::move(Result));
+    }
+};
+
+// Radix-2 FFT, in place
+class FFT
+{
+    std::vector<Complex> Twiddles; // exp(-2 pi i k / N) for k < N / 2
+    std::size_t N;
+
+    static Complex multiply(const Complex &a, const Complex &b)
+    {
+        // std::complex checks for infinities, which is much slower
+        return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+    }
+
+public:
+    explicit FFT(std::size_t size) :
+        Twiddles(size / 2),
+        N(size)
+    {
+        for(std::size_t k = 0; k < Twiddles.size(); ++k)
+        {
+            const double Angle = -2.0 * Pi * k / N;
+            Twiddles[k] = Complex(std::cos(Angle), std::sin(Angle));
+        }
+    }
+
+    std::size_t size() const
+    {
+        return N;
+    }
+
+    void transform(std::vector<Complex> &data, bool inverse) const
+    {
+        for(std::size_t i = 1, j = 0; i < N; ++i)
+        {
+            std::size_t Bit = N >> 1;
+            for(; j & Bit; Bit >>= 1)
+            {
+                j ^= Bit;
+            }
+            j ^= Bit;
+            if(i < j) std::swap(data[i], data[j]);
+        }
+
+        for(std::size_t Length = 2; Length <= N; Length <<= 1)
+        {
+            const std::size_t Half = Length / 2;
+            const std::size_t Stride = N / Length;
+            for(std::size_t i = 0; i < N; i += Length)
+            {
+                for(std::size_t k = 0; k < Half; ++k)
+                {
+                    const Complex &W = Twiddles[k * Stride];
+                    const Complex V = multiply(data[i + k + Half], inverse ? std::conj(W) : W);
+                    data[i + k + Half] = data[i + k] - V;
+                    data[i + k] += V;
+                }
+            }
+        }
+
+        if(inverse)
+        {
+            for(Complex &Value : data)
+            {
+                Value /= double(N);
+            }
+        }
+    }
+
+    // Cross-correlation spectrum of a with the signal of spectrum b
+    static void correlate(std::vector<Complex> &a, const std::vector<Complex> &b)
+    {
+        for(std::size_t k = 0; k < a.size(); ++k)
+        {
+            a[k] = multiply(std::conj(a[k]), b[k]);
+        }
+    }
+};
+
+struct Match
+{
+    int Lag; // In samples of the envelopes searched
+    double Correlation;
+};
+
+// Searches ranges of the reference all over the other envelope, at every lag at once
+class CoarseSearch
+{
+    const Envelope &Reference;
+    const Envelope &Other;
+    FFT Transform;
+    std::vector<Complex> OtherSpectrum;
+
+    static std::size_t powerOf2(std::size_t size)
+    {
+        std::size_t Result = 1;
+        while(Result < size) Result <<= 1;
+        return Result;
+    }
+
+public:
+    CoarseSearch(const Envelope &reference, const Envelope &other) :
+        Reference(reference),
+        Other(other),
+        Transform(powerOf2(reference.size() + other.size())),
+        OtherSpectrum(Transform.size())
+    {
+        for(int i = 0; i < Other.size(); ++i)
+        {
+            OtherSpectrum[i] = Other[i];
+        }
+        Transform.transform(OtherSpectrum, false);
+    }
+
+    // Lag of the other envelope, within maxLag, best correlated with reference[first, last),
+    // over at least half of the range
+    Match find(int first, int last, int maxLag) const
+    {
+        Match Best { 0, 0.0 };
+        const int Length = last - first;
+        std::vector<Complex> Data(Transform.size());
+        for(int t = 0; t < Length; ++t)
+        {
+            Data[t] = Reference[first + t];
+        }
+        Transform.transform(Data, false);
+        FFT::correlate(Data, OtherSpectrum);
+        Transform.transform(Data, true);
+
+        // Sum of reference[t] * other[t + lag] for t in [first, last) is at index lag + first, modulo the size
+        const int MinLag = std::max(-maxLag, -first - Length / 2);
+        const int MaxLag = std::min(maxLag, Other.size() - first - (Length + 1) / 2);
+        for(int Lag = MinLag; Lag <= MaxLag; ++Lag)
+        {
+            const int From = std::max(first, -Lag);
+            const int To = std::min(last, Other.size() - Lag);
+            const double Energy = Reference.energy(From, To) * Other.energy(From + Lag, To + Lag);
+            if(Energy <= 0.0) continue;
+            const std::size_t Index = (Lag + first + std::ptrdiff_t(Transform.size())) % Transform.size();
+            const double Correlation = Data[Index].real() / std::sqrt(Energy);
+            if(Correlation > Best.Correlation)
+            {
+                Best = Match { Lag, Correlation };
+            }
+        }
+        return Best;
+    }
+};
+
+}
+
+// Loudness every EnvelopeMs, without its moving average
+static Envelope envelope(const Peaks &peaks)
+{
+    const double MsPerPeak = 1000.0 * peaks.samplesPerPeak() / peaks.sampleRate();
+    const int Count = int(peaks.peaksNumber() * MsPerPeak / EnvelopeMs);
+    std::vector<float> Loudness(Count, -1.0f);
+    for(std::size_t p = 0; p < peaks.peaksNumber(); ++p)
+    {
+        const int Sample = int(p * MsPerPeak / EnvelopeMs);
+        if(Sample >= Count) break;
+        const int Amplitude = std::max(std::abs(peaks[p].min()), std::abs(peaks[p].max()));
+        Loudness[Sample] = std::max(Loudness[Sample], float(std::log1p(double(Amplitude))));
+    }
+    // Peaks longer than a sample leave gaps
+    for(int i = 0; i < Count; ++i)
+    {
+        if(Loudness[i] < 0.0f) Loudness[i] = i > 0 ? Loudness[i - 1] : 0.0f;
+    }
+
+    std::vector<double> Sums(Count + 1, 0.0);
+    for(int i = 0; i < Count; ++i)
+    {
+        Sums[i + 1] = Sums[i] + Loudness[i];
+    }
+    std::vector<float> Result(Count);
+    for(int i = 0; i < Count; ++i)
+    {
+        const int First = std::max(0, i - SmoothingSamples);
+        const int Last = std::min(Count, i + SmoothingSamples + 1);
+        Result[i] = Loudness[i] - float((Sums[Last] - Sums[First]) / (Last - First));
+    }
+    return Envelope(std::move(Result));
+}
+
+// Correlation of reference[first, last) with other at lag, over at least half of the range
+static double correlation(const Envelope &reference, const Envelope &other, int first, int last, int lag)
+{
+    const int From = std::max(first, -lag);
+    const int To = std::min(last, other.size() - lag);
+    if(2 * (To - From) < last - first) return 0.0;
+
+    double Sum = 0.0;
+    for(int t = From; t < To; ++t)
+    {
+        Sum += double(reference[t]) * other[t + lag];
+    }
+    const double Energy = reference.energy(From, To) * other.energy(From + lag, To + lag);
+    return Energy > 0.0 ? Sum / std::sqrt(Energy) : 0.0;
+}
+
+// Best lag within radius of lag, to a fraction of sample
+static Match refine(const Envelope &reference, const Envelope &other, int first, int last, int lag, int radius, double &fraction)
+{
+    std::vector<double> Correlations(2 * radius + 1);
+    int Best = 0;
+    for(int i = 0; i <= 2 * radius; ++i)
+    {
+        Correlations[i] = correlation(reference, other, first, last, lag - radius + i);
+        if(Correlations[i] > Correlations[Best]) Best = i;
+    }
+
+    // Vertex of the parabola through the best correlation and its neighbours
+    fraction = 0.0;
+    if(Best > 0 && Best < 2 * radius)
+    {
+        const double Left = Correlations[Best - 1];
+        const double Right = Correlations[Best + 1];
+        const double Curvature = Left - 2.0 * Correlations[Best] + Right;
+        if(Curvature < 0.0) fraction = 0.5 * (Left - Right) / Curvature;
+    }
+    return Match { lag - radius + Best, Correlations[Best] };
+}
+
+// Sample in [first, last) from which offset b fits better than offset a, where they meet
+static int splitPoint(const Envelope &reference, const Envelope &other, int first, int last, int lagA, int lagB)
+{
+    // Without their moving average, the logarithms of the envelopes are about equal where they match,
+    // whatever the gain, so the split minimises the squared differences, which is sharper than
+    // maximising the products: another part of the audio is as likely to multiply high as to differ little
+    auto difference = [&](int t, int lag)
+    {
+        const float Other = t + lag >= 0 && t + lag < other.size() ? other[t + lag] : 0.0f;
+        return double(reference[t] - Other) * (reference[t] - Other);
+    };
+
+    double Sum = 0.0, Best = 0.0;
+    int Split = first;
+    for(int t = first; t < last; ++t)
+    {
+        Sum += difference(t, lagA) - difference(t, lagB);
+        if(-Sum > Best)
+        {
+            Best = -Sum;
+            Split = t + 1;
+        }
+    }
+    return Split;
+}
+
+AudioOffset findAudioOffset(const Peaks &reference, const Peaks &other, const OffsetOptions &options)
+{
+    AudioOffset Result;
+    const Envelope Reference = envelope(reference);
+    const Envelope Other = envelope(other);
+    const Envelope CoarseReference = Reference.decimate(CoarseFactor);
+    const Envelope CoarseOther = Other.decimate(CoarseFactor);
+    if(CoarseReference.size() == 0 || CoarseOther.size() == 0) return Result;
+
+    const CoarseSearch Search(CoarseReference, CoarseOther);
+    const int MaxCoarseLag = options.MaxOffsetMs / (EnvelopeMs * CoarseFactor);
+
+    // Whole audio
+    const Match Coarse = Search.find(0, CoarseReference.size(), MaxCoarseLag);
+    double Fraction;
+    const Match Global = refine(Reference, Other, 0, Reference.size(), Coarse.Lag * CoarseFactor, RefineLags, Fraction);
+    Result.OffsetMs = int(std::lround((Global.Lag + Fraction) * EnvelopeMs));
+    Result.Confidence = std::max(0.0, Global.Correlation);
+
+    // Each window, at the offset of the last matched one or searched again
+    struct Window
+    {
+        int First;
+        int Last;
+        int Lag; // Envelope samples
+        int OffsetMs;
+        double Correlation; // 0 if unmatched
+    };
+    std::vector<Window> Windows;
+    const int WindowSamples = std::max(CoarseFactor, options.WindowMs / EnvelopeMs);
+    const double MeanEnergy = Reference.energy(0, Reference.size()) / Reference.size() * WindowSamples;
+    int LastLag = Global.Lag;
+    for(int First = 0, Last; First < Reference.size(); First = Last)
+    {
+        // A short last window is joined to the previous one
+        Last = std::min(Reference.size(), First + WindowSamples);
+        if(Reference.size() - Last < WindowSamples / 2) Last = Reference.size();
+
+        Window W { First, Last, 0, 0, 0.0 };
+        // Silence matches anything
+        if(Reference.energy(First, Last) >= 0.01 * MeanEnergy * (Last - First) / WindowSamples)
+        {
+            Match Found = refine(Reference, Other, First, Last, LastLag, CheckLags, Fraction);
+            if(Found.Correlation < options.MinCorrelation && LastLag != Global.Lag)
+            {
+                Found = refine(Reference, Other, First, Last, Global.Lag, CheckLags, Fraction);
+            }
+            double Threshold = options.MinCorrelation;
+            if(Found.Correlation < Threshold)
+            {
+                const Match CoarseFound = Search.find(First / CoarseFactor, Last / CoarseFactor, MaxCoarseLag);
+                Found = refine(Reference, Other, First, Last, CoarseFound.Lag * CoarseFactor, RefineLags, Fraction);
+                Threshold = options.MinSearchCorrelation;
+            }
+            if(Found.Correlation >= Threshold)
+            {
+                W.Lag = Found.Lag;
+                W.OffsetMs = int(std::lround((Found.Lag + Fraction) * EnvelopeMs));
+                W.Correlation = Found.Correlation;
+                LastLag = Found.Lag;
+            }
+        }
+        Windows.push_back(W);
+    }
+
+    // Consecutive matched windows close to the offset of the first one make a segment,
+    // the unmatched ones go with their neighbours
+    const int DurationMs = Reference.size() * EnvelopeMs;
+    const Window *SegmentFirst = nullptr;
+    const Window *SegmentLast = nullptr;
+    int Matched = 0;
+    double Weight = 0.0, WeightedOffset = 0.0;
+    auto closeSegment = [&](int endMs)
+    {
+        const int StartMs = Result.Segments.empty() ? 0 : Result.Segments.back().EndMs;
+        Result.Segments.push_back(OffsetSegment { StartMs, endMs, int(std::lround(WeightedOffset / Weight)), Weight / Matched });
+    };
+    for(const Window &W : Windows)
+    {
+        if(W.Correlation <= 0.0) continue;
+        if(SegmentFirst && std::abs(W.OffsetMs - SegmentFirst->OffsetMs) > options.ToleranceMs)
+        {
+            // The cut is somewhere from the last window at the old offset to this one
+            closeSegment(splitPoint(Reference, Other, SegmentLast->First, W.Last, SegmentLast->Lag, W.Lag) * EnvelopeMs);
+            SegmentFirst = nullptr;
+        }
+        if(!SegmentFirst)
+        {
+            SegmentFirst = &W;
+            Matched = 0;
+            Weight = WeightedOffset = 0.0;
+        }
+        SegmentLast = &W;
+        ++Matched;
+        Weight += W.Correlation;
+        WeightedOffset += W.Correlation * W.OffsetMs;
+    }
+    if(SegmentFirst)
+    {
+        closeSegment(DurationMs);
+    }
+    else
+    {
+        Result.Segments.push_back(OffsetSegment { 0, DurationMs, Result.OffsetMs, Result.Confidence });
+    }
+    return Result;
+}
+
+TimeMap AudioOffset::timeMap() const
+{
+    if(Segments.size() <= 1)
+    {
+        return TimeMap::shift(Segments.empty() ? OffsetMs : Segments.front().OffsetMs);
+    }
+
+    // Where the offset drops, the start of the next segment would map before the end of the previous one,
+    // and a cue across the cut would end before it starts. The times of the next segment are held at
+    // the end of the previous one until its offset catches up, so that the map never goes back
+    std::vector<std::pair<int, int>> Points;
+    int FloorMs = std::numeric_limits<int>::min();
+    for(std::size_t i = 0; i < Segments.size(); ++i)
+    {
+        const OffsetSegment &Segment = Segments[i];
+        int StartMs = Segment.StartMs;
+        if(StartMs + Segment.OffsetMs < FloorMs)
+        {
+            StartMs = FloorMs - Segment.OffsetMs;
+        }
+        int EndMs = Segment.EndMs;
+        if(StartMs >= EndMs)
+        {
+            // Wholly held, but the last segment still gives the map after the end
+            if(i + 1 < Segments.size()) continue;
+            EndMs = StartMs + 1;
+        }
+        Points.emplace_back(StartMs, StartMs + Segment.OffsetMs);
+        Points.emplace_back(EndMs, EndMs + Segment.OffsetMs);
+        FloorMs = EndMs + Segment.OffsetMs;
+    }
+    return TimeMap::piecewise(Points);
+}
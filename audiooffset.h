@@ -0,0 +1,49 @@
+#ifndef AUDIOOFFSET_H
+#define AUDIOOFFSET_H
+
+#include <vector>
+
+#include "mediaProcessor/peaks.h"
+#include "timemap.h"
+
+struct OffsetOptions
+{
+    int MaxOffsetMs = 600000; // Largest offset searched, either way
+    int WindowMs = 30000; // Length of the parts of the reference checked for drift
+    int ToleranceMs = 40; // Parts whose offsets differ less belong to the same segment
+    double MinCorrelation = 0.3; // Parts correlating less at the offset of the previous part are searched again
+    double MinSearchCorrelation = 0.5; // Parts found elsewhere correlating less are unmatched, e.g. a scene cut
+                                       // from the other audio; the best of many offsets correlates more by chance
+};
+
+// Part of the reference audio with the same offset in the other audio
+struct OffsetSegment
+{
+    int StartMs;
+    int EndMs;
+    int OffsetMs; // Time in the other audio minus time in the reference
+    double Confidence; // Correlation of the envelopes, from 0 to 1
+};
+
+struct AudioOffset
+{
+    int OffsetMs = 0; // Of the whole audio
+    double Confidence = 0.0;
+    std::vector<OffsetSegment> Segments; // In time order, a single one if nothing drifts
+
+    // Map from the times of the reference to the times of the other audio, to move subtitles with.
+    // The offset is constant in each segment and steps at their ends; where it drops, the start
+    // of the next segment is held at the end of the previous one, so the map never goes back
+    TimeMap timeMap() const;
+};
+
+// Find where the audio of reference is in other, e.g. in a new conform of the same film.
+// The peaks are turned into loudness envelopes of 10 ms, without their slow changes so that
+// different mixes still match, then cross-correlated through an FFT at 100 ms resolution,
+// and refined to the millisecond around the best offset.
+// Then each window of the reference is checked at the offset of the previous one, and searched
+// again only if it doesn't match there; consecutive windows with the same offset form a segment,
+// and the cut between two segments is put where it fits both offsets best
+AudioOffset findAudioOffset(const Peaks &reference, const Peaks &other, const OffsetOptions &options = OffsetOptions());
+
+#endif // AUDIOOFFSET_H
@@ -0,0 +1,314 @@
+#include "autosavelog.h"
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <cstring>
+
+#include "srtwriter.h"
+
+static const char LogMagic[8] = { 'W', 'A', 'V', 'E', 'L', 'O', 'G', '1' };
+static const int LogHeaderSize = 16; // Magic, epoch and padding
+
+// Each record is the payload size, the checksum of the payload, 2 bytes of padding,
+// then the payload: whether the entry was reverted, its number of deltas and the deltas
+static const int RecordHeaderSize = 8;
+
+static const quint32 SnapshotMagic = 0x57415653;
+static const quint32 SnapshotVersion = 1;
+
+AutosaveLog::AutosaveLog(const QString &basePath, std::size_t compactBytes) :
+    SnapshotPath(basePath + ".autosave"),
+    LogPath(basePath + ".autosave-log"),
+    CompactBytes(compactBytes)
+{ }
+
+AutosaveLog::~AutosaveLog()
+{
+    stop();
+}
+
+bool AutosaveLog::hasRecovery() const
+{
+    return QFile::exists(SnapshotPath);
+}
+
+bool AutosaveLog::recover(RangeList &result, QString *error)
+{
+    auto fail = [error](const QString &what)
+    {
+        if(error) *error = what;
+        return false;
+    };
+
+    QFile File(SnapshotPath);
+    if(!File.open(QIODevice::ReadOnly)) return fail(File.errorString());
+    const QByteArray Data = File.readAll();
+
+    QDataStream In(Data);
+    In.setVersion(QDataStream::Qt_5_0);
+    quint32 Magic, Version, SnapshotEpoch, Count, SlotCount;
+    In >> Magic >> Version >> SnapshotEpoch >> Count >> SlotCount;
+    if(In.status() != QDataStream::Ok || Magic != SnapshotMagic) return fail("Not an autosave file");
+    if(Version != SnapshotVersion) return fail(QString("Unsupported autosave version %1").arg(Version));
+    // Each subtitle takes at least 20 bytes and each slot 4, checking this avoids huge allocations
+    if(Count > quint32(Data.size()) / 20 || SlotCount > quint32(Data.size()) / 4) return fail("Corrupt autosave file");
+
+    Snapshot S;
+    S.Generations.resize(SlotCount);
+    for(quint32 &Generation : S.Generations)
+    {
+        In >> Generation;
+    }
+    S.Times.resize(Count);
+    S.Numbers.resize(Count);
+    S.Texts.resize(Count);
+    S.SlotOf.resize(Count);
+    for(quint32 i = 0; i < Count; ++i)
+    {
+        qint32 Start, End;
+        In >> S.SlotOf[i] >> S.Numbers[i] >> Start >> End >> S.Texts[i];
+        S.Times[i] = Range { Start, End };
+    }
+    if(In.status() != QDataStream::Ok || !std::is_sorted(S.Times.begin(), S.Times.end())) return fail("Corrupt autosave file");
+
+    RangeList RL(std::move(S.Times), std::move(S.Numbers), std::move(S.Texts), true);
+    if(!RL.restoreSlots(S.SlotOf, S.Generations)) return fail("Corrupt autosave file");
+
+    // Replay the log written after the snapshot, up to the first damaged record
+    QFile LogFile(LogPath);
+    if(LogFile.open(QIODevice::ReadOnly))
+    {
+        const QByteArray Bytes = LogFile.readAll();
+        quint32 LogEpoch = 0;
+        if(Bytes.size() >= LogHeaderSize && std::memcmp(Bytes.constData(), LogMagic, sizeof(LogMagic)) == 0)
+        {
+            std::memcpy(&LogEpoch, Bytes.constData() + sizeof(LogMagic), sizeof(LogEpoch));
+        }
+
+        int Pos = LogHeaderSize;
+        while(LogEpoch == SnapshotEpoch && Bytes.size() - Pos >= RecordHeaderSize)
+        {
+            quint32 Size;
+            quint16 Checksum;
+            std::memcpy(&Size, Bytes.constData() + Pos, sizeof(Size));
+            std::memcpy(&Checksum, Bytes.constData() + Pos + sizeof(Size), sizeof(Checksum));
+            const char *Payload = Bytes.constData() + Pos + RecordHeaderSize;
+            if(Size > quint32(Bytes.size() - Pos - RecordHeaderSize) || qChecksum(Payload, Size) != Checksum) break;
+
+            QDataStream Stream(QByteArray::fromRawData(Payload, Size));
+            Stream.setVersion(QDataStream::Qt_5_0);
+            quint8 Reverted;
+            quint32 DeltaCount;
+            Stream >> Reverted >> DeltaCount;
+            if(DeltaCount > Size) break;
+
+            EditJournal::Entry Entry;
+            Entry.Bytes = 0;
+            Entry.Deltas.resize(DeltaCount);
+            for(EditDelta &Delta : Entry.Deltas)
+            {
+                Stream >> Delta;
+            }
+            if(Stream.status() != QDataStream::Ok) break;
+
+            EditJournal::apply(Entry, RL, Reverted);
+            Pos += RecordHeaderSize + Size;
+        }
+    }
+
+    Epoch = SnapshotEpoch;
+    result = std::move(RL);
+    return true;
+}
+
+void AutosaveLog::start(const RangeList &RL)
+{
+    if(!Started)
+    {
+        Started = true;
+        Writer = std::thread(&AutosaveLog::run, this);
+    }
+    queueSnapshot(RL);
+}
+
+void AutosaveLog::compactIfNeeded(const RangeList &RL)
+{
+    if(Started && LogBytes >= CompactBytes)
+    {
+        queueSnapshot(RL);
+    }
+}
+
+void AutosaveLog::flush()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    const std::uint64_t Target = Queued;
+    Written.wait(Lock, [this, Target] { return WrittenUpTo >= Target; });
+}
+
+void AutosaveLog::discard()
+{
+    stop();
+    Started = false;
+    Log.close();
+    QFile::remove(LogPath);
+    QFile::remove(SnapshotPath);
+}
+
+void AutosaveLog::entryApplied(const EditJournal::Entry &entry, bool reverted)
+{
+    if(!Started) return;
+
+    // Size and checksum are filled in later, the checksum by the writer
+    Record.resize(RecordHeaderSize);
+    {
+        QDataStream Out(&Record, QIODevice::Append);
+        Out.setVersion(QDataStream::Qt_5_0);
+        Out << quint8(reverted) << quint32(entry.Deltas.size());
+        for(const EditDelta &Delta : entry.Deltas)
+        {
+            Out << Delta;
+        }
+    }
+    const quint32 Size = Record.size() - RecordHeaderSize;
+    std::memcpy(Record.data(), &Size, sizeof(Size));
+    LogBytes += Record.size();
+
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        if(Jobs.empty() || Jobs.back().Compaction)
+        {
+            Jobs.emplace_back();
+        }
+        Jobs.back().Records.append(Record);
+        ++Queued;
+    }
+    Wake.notify_one();
+}
+
+std::unique_ptr<AutosaveLog::Snapshot> AutosaveLog::takeSnapshot(const RangeList &RL)
+{
+    std::unique_ptr<Snapshot> S(new Snapshot);
+    S->Times.reserve(RL.size());
+    S->Numbers.reserve(RL.size());
+    S->Texts.reserve(RL.size());
+    for(auto Sub = RL.cbegin(); Sub != RL.cend(); ++Sub)
+    {
+        S->Times.push_back(Sub->Time);
+        S->Numbers.push_back(Sub->Number);
+        S->Texts.push_back(Sub->Text);
+    }
+    RL.saveSlots(S->SlotOf, S->Generations);
+    return S;
+}
+
+void AutosaveLog::queueSnapshot(const RangeList &RL)
+{
+    std::unique_ptr<Snapshot> S = takeSnapshot(RL);
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        if(Jobs.empty() || Jobs.back().Compaction)
+        {
+            Jobs.emplace_back();
+        }
+        Jobs.back().Compaction = std::move(S);
+        ++Queued;
+    }
+    LogBytes = 0;
+    Wake.notify_one();
+}
+
+void AutosaveLog::stop()
+{
+    if(!Writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Stopping = true;
+    }
+    Wake.notify_one();
+    Writer.join();
+    Stopping = false;
+}
+
+void AutosaveLog::run()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    while(true)
+    {
+        Wake.wait(Lock, [this] { return Stopping || !Jobs.empty(); });
+        if(Jobs.empty()) break;
+
+        // Take everything queued meanwhile, so that many records go in a single write
+        std::vector<Job> Taken;
+        Taken.swap(Jobs);
+        const std::uint64_t Target = Queued;
+        Lock.unlock();
+
+        for(Job &J : Taken)
+        {
+            appendRecords(J.Records);
+            // If the snapshot can't be written the log goes on, it still fits the old one
+            if(J.Compaction && writeSnapshot(*J.Compaction, Epoch + 1))
+            {
+                resetLog(Epoch + 1);
+            }
+        }
+
+        Lock.lock();
+        WrittenUpTo = Target;
+        Written.notify_all();
+    }
+}
+
+bool AutosaveLog::writeSnapshot(const Snapshot &snapshot, std::uint32_t epoch)
+{
+    QByteArray Data;
+    {
+        QDataStream Out(&Data, QIODevice::WriteOnly);
+        Out.setVersion(QDataStream::Qt_5_0);
+        Out << SnapshotMagic << SnapshotVersion << quint32(epoch)
+            << quint32(snapshot.Times.size()) << quint32(snapshot.Generations.size());
+        for(std::uint32_t Generation : snapshot.Generations)
+        {
+            Out << quint32(Generation);
+        }
+        for(std::size_t i = 0; i < snapshot.Times.size(); ++i)
+        {
+            Out << quint32(snapshot.SlotOf[i]) << quint32(snapshot.Numbers[i])
+                << qint32(snapshot.Times[i].StartTime) << qint32(snapshot.Times[i].EndTime) << snapshot.Texts[i];
+        }
+    }
+    return writeFileAtomically(SnapshotPath, Data);
+}
+
+void AutosaveLog::resetLog(std::uint32_t epoch)
+{
+    Log.close();
+    Log.setFileName(LogPath);
+    if(!Log.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    char Header[LogHeaderSize] = { };
+    std::memcpy(Header, LogMagic, sizeof(LogMagic));
+    const quint32 Value = epoch;
+    std::memcpy(Header + sizeof(LogMagic), &Value, sizeof(Value));
+    Log.write(Header, LogHeaderSize);
+    Log.flush();
+    Epoch = epoch;
+}
+
+void AutosaveLog::appendRecords(QByteArray &records)
+{
+    if(records.isEmpty() || !Log.isOpen()) return;
+
+    for(int Pos = 0; Pos < records.size();)
+    {
+        quint32 Size;
+        std::memcpy(&Size, records.constData() + Pos, sizeof(Size));
+        const quint16 Checksum = qChecksum(records.constData() + Pos + RecordHeaderSize, Size);
+        std::memcpy(records.data() + Pos + sizeof(Size), &Checksum, sizeof(Checksum));
+        Pos += RecordHeaderSize + Size;
+    }
+    Log.write(records);
+    Log.flush();
+}
@@ -0,0 +1,112 @@
+#ifndef AUTOSAVELOG_H
+#define AUTOSAVELOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "editjournal.h"
+#include "rangelist.h"
+
+// Crash recovery for the edits to a RangeList.
+// A snapshot of the list is saved at start, then every entry of its EditJournal
+// is appended to a log as a small binary record. A writer thread writes all the
+// records queued since its last write at once, so the edits themselves only
+// serialize their deltas. When the log grows past a threshold it is replaced,
+// in background, by a new snapshot.
+// Snapshot and log share an epoch number, so that a log already merged into
+// the snapshot is never replayed on it
+class AutosaveLog : public EditJournal::Sink
+{
+public:
+    // Files go next to basePath, which doesn't need to exist
+    explicit AutosaveLog(const QString &basePath, std::size_t compactBytes = 4 * 1024 * 1024);
+
+    // Write what is queued, then stop. The files are kept
+    ~AutosaveLog();
+
+    AutosaveLog(const AutosaveLog &) = delete;
+    AutosaveLog &operator=(const AutosaveLog &) = delete;
+
+    // Whether a previous session left its files, because it didn't end cleanly
+    bool hasRecovery() const;
+
+    // Rebuild the list of the previous session from its snapshot and log.
+    // Records after the first damaged one, e.g. written partially, are ignored.
+    // Returns false, leaving result unchanged, if the snapshot can't be read
+    bool recover(RangeList &result, QString *error = nullptr);
+
+    // Start logging the changes to RL, from a snapshot of it
+    void start(const RangeList &RL);
+
+    // Replace the log with a snapshot of RL if it grew past the threshold.
+    // RL must have no changes that aren't logged yet, i.e. no journal group open
+    void compactIfNeeded(const RangeList &RL);
+
+    // Wait until everything queued has been written
+    void flush();
+
+    // Stop logging and remove the files, when the session ends cleanly
+    void discard();
+
+    virtual void entryApplied(const EditJournal::Entry &entry, bool reverted) override;
+
+private:
+    // State of a list, with its handles
+    struct Snapshot
+    {
+        std::vector<Range> Times;
+        std::vector<unsigned int> Numbers;
+        std::vector<QString> Texts; // Implicitly shared with the list
+        std::vector<std::uint32_t> SlotOf;
+        std::vector<std::uint32_t> Generations;
+    };
+
+    // Records to append, then possibly a snapshot to replace the log with
+    struct Job
+    {
+        QByteArray Records;
+        std::unique_ptr<Snapshot> Compaction;
+    };
+
+    static std::unique_ptr<Snapshot> takeSnapshot(const RangeList &RL);
+    void queueSnapshot(const RangeList &RL);
+    void stop();
+
+    // Writer thread
+    void run();
+    bool writeSnapshot(const Snapshot &snapshot, std::uint32_t epoch);
+    void resetLog(std::uint32_t epoch);
+    void appendRecords(QByteArray &records);
+
+    const QString SnapshotPath;
+    const QString LogPath;
+    const std::size_t CompactBytes;
+
+    QByteArray Record; // Scratch buffer of entryApplied()
+    std::size_t LogBytes = 0; // Queued since the last snapshot
+    bool Started = false;
+
+    std::thread Writer;
+    std::mutex Mutex;
+    std::condition_variable Wake; // Jobs were queued, or stopping
+    std::condition_variable Written; // Jobs were written
+    std::vector<Job> Jobs; // Guarded by Mutex
+    std::uint64_t Queued = 0; // Changes queued so far, guarded by Mutex
+    std::uint64_t WrittenUpTo = 0; // Changes written so far, guarded by Mutex
+    bool Stopping = false; // Guarded by Mutex
+
+    // Used by the writer thread only, and by recover() before it starts
+    std::uint32_t Epoch = 0;
+    QFile Log;
+};
+
+#endif // AUTOSAVELOG_H
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Time of aligning a translation with a VO cut again
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = alignbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/trackalignment.cpp \
+    $$ROOT/editjournal.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/benchmarks/benchmarkutils.h \
+    $$ROOT/trackalignment.h \
+    $$ROOT/subtitlediff.h \
+    $$ROOT/editjournal.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/srtParser/srtsubtitle.h
@@ -0,0 +1,108 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "trackalignment.h"
+#include "benchmarks/benchmarkutils.h"
+
+// The translation: the cues spotted again, up to 100 ms away
+static std::vector<SrtSubtitle> makeTranslation(const std::vector<SrtSubtitle> &original, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int> Jitter(-100, 100);
+    std::vector<SrtSubtitle> Result = original;
+    for(SrtSubtitle &Sub : Result)
+    {
+        Sub.Time.StartTime += Jitter(Gen);
+        Sub.Time.EndTime += Jitter(Gen);
+    }
+    return Result;
+}
+
+// The new VO: cutCount scenes of sceneCues cues removed, the rest moved back to close the gaps,
+// and as many scenes of new cues added
+static std::vector<SrtSubtitle> makeRecut(const std::vector<SrtSubtitle> &original, int cutCount, int sceneCues, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int> Jitter(-20, 20);
+    std::vector<SrtSubtitle> Result;
+    const int Count = original.size();
+    int Shift = 0;
+    for(int i = 0; i < Count; ++i)
+    {
+        const int Scene = i * cutCount / Count;
+        const int SceneStart = Scene * Count / cutCount;
+        if(i == SceneStart && i + sceneCues < Count)
+        {
+            // Removed
+            Shift -= original[i + sceneCues].Time.StartTime - original[i].Time.StartTime;
+            // Added
+            for(int k = 0; k < sceneCues / 2; ++k)
+            {
+                SrtSubtitle Sub;
+                Sub.Time = Range { original[i].Time.StartTime + Shift + k * 1500, original[i].Time.StartTime + Shift + k * 1500 + 1000 };
+                Result.push_back(Sub);
+            }
+            Shift += sceneCues / 2 * 1500;
+            i += sceneCues - 1;
+            continue;
+        }
+        SrtSubtitle Sub = original[i];
+        Sub.Time.StartTime += Shift + Jitter(Gen);
+        Sub.Time.EndTime += Shift + Jitter(Gen);
+        Result.push_back(Sub);
+    }
+    for(std::size_t i = 0; i < Result.size(); ++i)
+    {
+        Result[i].Number = i + 1;
+    }
+    return Result;
+}
+
+static QJsonObject result(const char *name, int cues, int cuts, const TrackAlignment &alignment, int runs, qint64 elapsedNs)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["cues"] = cues;
+    Result["cuts"] = cuts;
+    Result["matches"] = int(alignment.Matches.size());
+    Result["unmatched"] = int(alignment.Unmatched.size());
+    Result["mean_confidence"] = alignment.MeanConfidence;
+    Result["ms"] = elapsedNs / 1000000.0 / runs;
+    return Result;
+}
+
+int main()
+{
+    const int Runs = 5;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+    QElapsedTimer Timer;
+
+    const int Counts[] = { 1000, 5000, 20000 };
+    const int Cuts[] = { 0, 1, 10 };
+    for(int Count : Counts)
+    {
+        const std::vector<SrtSubtitle> Original = makeSubtitles(Count, Gen);
+        const RangeList Translation(makeTranslation(Original, Gen));
+        for(int CutCount : Cuts)
+        {
+            const RangeList VO(CutCount ? makeRecut(Original, CutCount, 20, Gen) : makeTranslation(Original, Gen), false);
+            TrackAlignment Alignment;
+            Timer.start();
+            for(int r = 0; r < Runs; ++r)
+            {
+                Alignment = alignTracks(Translation, VO);
+            }
+            Results.append(result("align", Count, CutCount, Alignment, Runs, Timer.nsecsElapsed()));
+        }
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
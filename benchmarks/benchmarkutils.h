@@ -0,0 +1,62 @@
+#ifndef BENCHMARKUTILS_H
+#define BENCHMARKUTILS_H
+
+#include <QJsonObject>
+#include <QString>
+
+#include <random>
+#include <vector>
+
+#include "srtParser/srtsubtitle.h"
+
+// count sorted subtitles, with one or two lines of text each
+inline std::vector<SrtSubtitle> makeSubtitles(int count, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int> Gap(0, 2000);
+    std::uniform_int_distribution<int> Length(500, 4000);
+    std::uniform_int_distribution<int> Lines(1, 2);
+
+    std::vector<SrtSubtitle> Result;
+    Result.reserve(count);
+    int StartMs = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        SrtSubtitle Sub;
+        StartMs += Gap(Gen);
+        Sub.Number = i + 1;
+        Sub.Time = Range { StartMs, StartMs + Length(Gen) };
+        Sub.Text = QString("Line 1 of cue %1, with some àccénted text").arg(i + 1);
+        if(Lines(Gen) == 2)
+        {
+            Sub.Text += QString("\nLine 2 of cue %1").arg(i + 1);
+        }
+        StartMs = Sub.Time.EndTime;
+        Result.push_back(Sub);
+    }
+    return Result;
+}
+
+// Result of runs of a benchmark writing or reading bytes for cues subtitles
+inline QJsonObject result(const char *name, int cues, qint64 bytes, int runs, qint64 elapsedNs)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["cues"] = cues;
+    Result["bytes"] = double(bytes);
+    Result["ms_per_run"] = elapsedNs / 1000000.0 / runs;
+    Result["mb_per_s"] = double(bytes) * runs / (1024.0 * 1024.0) / (elapsedNs / 1e9);
+    return Result;
+}
+
+// Sum of the fields of subs, so that parsing them can't be optimized away
+inline long long checksum(const std::vector<SrtSubtitle> &subs)
+{
+    long long Result = 0;
+    for(const SrtSubtitle &Sub : subs)
+    {
+        Result += Sub.Number + Sub.Time.StartTime + Sub.Time.EndTime + Sub.Text.size();
+    }
+    return Result;
+}
+
+#endif // BENCHMARKUTILS_H
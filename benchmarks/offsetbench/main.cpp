@@ -0,0 +1,115 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "audiooffset.h"
+
+static const double Pi = 3.14159265358979323846;
+
+// Amplitudes every 10 ms of something like speech: syllables between pauses
+static std::vector<int> makeSpeech(int count, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int> Pause(0, 80);
+    std::uniform_int_distribution<int> Syllables(3, 22);
+    std::uniform_int_distribution<int> SyllableLength(8, 32);
+    std::uniform_int_distribution<int> Loudness(2000, 22000);
+    std::uniform_int_distribution<int> Noise(0, 300);
+
+    std::vector<int> Result;
+    Result.reserve(count + 1000);
+    while(int(Result.size()) < count)
+    {
+        for(int i = Pause(Gen); i > 0; --i)
+        {
+            Result.push_back(Noise(Gen));
+        }
+        for(int s = Syllables(Gen); s > 0; --s)
+        {
+            const int Length = SyllableLength(Gen);
+            const int Amplitude = Loudness(Gen);
+            for(int i = 0; i < Length; ++i)
+            {
+                Result.push_back(int(Amplitude * (0.5 + 0.5 * std::sin(Pi * i / Length))) + Noise(Gen));
+            }
+        }
+    }
+    Result.resize(count);
+    return Result;
+}
+
+static Peaks makePeaks(const std::vector<int> &amplitudes, int sampleRate)
+{
+    std::vector<Peak> List;
+    List.reserve(amplitudes.size());
+    for(int Amplitude : amplitudes)
+    {
+        List.emplace_back(-Amplitude, Amplitude);
+    }
+    return Peaks(std::move(List), -32768, 32767, sampleRate / 100, sampleRate);
+}
+
+// The same audio in a new conform: quieter, noisier, starting later, with cutCount
+// scenes of 40 s removed and as many of 20 s added
+static std::vector<int> makeConform(const std::vector<int> &original, int cutCount, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int> Noise(0, 1500);
+    std::vector<int> Result = makeSpeech(321, Gen);
+    const int Count = original.size();
+    for(int i = 0; i < Count; ++i)
+    {
+        if(cutCount > 0 && i % (Count / cutCount) == Count / cutCount / 2)
+        {
+            const std::vector<int> Added = makeSpeech(2000, Gen);
+            Result.insert(Result.end(), Added.begin(), Added.end());
+            i += 4000;
+            continue;
+        }
+        Result.push_back(original[i] / 2 + Noise(Gen));
+    }
+    return Result;
+}
+
+static QJsonObject result(const char *name, int minutes, int cuts, const AudioOffset &offset, qint64 elapsedNs)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["minutes"] = minutes;
+    Result["cuts"] = cuts;
+    Result["offset_ms"] = offset.OffsetMs;
+    Result["confidence"] = offset.Confidence;
+    Result["segments"] = int(offset.Segments.size());
+    Result["ms"] = elapsedNs / 1000000.0;
+    return Result;
+}
+
+int main()
+{
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+    QElapsedTimer Timer;
+
+    const int Minutes[] = { 30, 120, 180 };
+    const int Cuts[] = { 0, 3, 10 };
+    for(int Length : Minutes)
+    {
+        const std::vector<int> Original = makeSpeech(Length * 6000, Gen);
+        const Peaks Reference = makePeaks(Original, 44100);
+        for(int CutCount : Cuts)
+        {
+            const Peaks Conform = makePeaks(makeConform(Original, CutCount, Gen), 48000);
+            Timer.start();
+            const AudioOffset Offset = findAudioOffset(Reference, Conform);
+            Results.append(result("offset", Length, CutCount, Offset, Timer.nsecsElapsed()));
+        }
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Time of finding the offset between two audios
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = offsetbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/audiooffset.cpp \
+    $$ROOT/timemap.cpp
+
+HEADERS += \
+    $$ROOT/audiooffset.h \
+    $$ROOT/timemap.h \
+    $$ROOT/mediaProcessor/peaks.h
@@ -0,0 +1,91 @@
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "projectfile.h"
+#include "benchmarks/benchmarkutils.h"
+
+// Peaks of durationS seconds of audio at 44.1 kHz
+static Peaks makePeaks(int durationS, int samplesPerPeak, std::mt19937 &Gen)
+{
+    std::uniform_int_distribution<int32_t> Value(0, 30000);
+    std::vector<Peak> List;
+    List.reserve(std::size_t(durationS) * 44100 / samplesPerPeak);
+    for(std::size_t i = 0; i < List.capacity(); ++i)
+    {
+        List.emplace_back(-Value(Gen), Value(Gen));
+    }
+    return Peaks(std::move(List), -30000, 30000, samplesPerPeak, 44100);
+}
+
+int main()
+{
+    const int Runs = 5;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+    QTemporaryDir Dir;
+    const QString Path = Dir.filePath("bench.wfproj");
+
+    // A two hours film, with peaks every 10 ms
+    Peaks P = makePeaks(2 * 3600, 441, Gen);
+    std::vector<int> SceneChanges;
+    for(int Ms = 0; Ms < 2 * 3600 * 1000; Ms += 3000)
+    {
+        SceneChanges.push_back(Ms);
+    }
+
+    const int CueCounts[] = { 2000, 40000 };
+    for(int CueCount : CueCounts)
+    {
+        RangeList Subs(makeSubtitles(CueCount, Gen), true);
+        RangeList VO(makeSubtitles(CueCount, Gen), false);
+        std::vector<ProjectFile::List> Lists { { &Subs, true }, { &VO, false } };
+        QElapsedTimer Timer;
+
+        qint64 Bytes = 0;
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            Bytes = ProjectFile::serialize(P, SceneChanges, Lists, ViewState()).size();
+        }
+        Results.append(result("serialize", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+
+        ProjectFile::save(Path, P, SceneChanges, Lists, ViewState());
+
+        // Mapping and checking only
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            ProjectFile Project;
+            Project.open(Path);
+        }
+        Results.append(result("open", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+
+        // Everything needed to show the project
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            ProjectFile Project;
+            Project.open(Path);
+            Peaks Loaded = Project.peaks();
+            std::vector<int> Scenes = Project.sceneChanges();
+            for(int l = 0; l < Project.listCount(); ++l)
+            {
+                RangeList List = Project.list(l);
+            }
+        }
+        Results.append(result("open_and_load", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
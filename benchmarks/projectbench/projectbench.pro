@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Saving and opening binary project files
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = projectbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/projectfile.cpp \
+    $$ROOT/srtwriter.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/projectfile.h \
+    $$ROOT/benchmarks/benchmarkutils.h \
+    $$ROOT/mediaProcessor/peaks.h \
+    $$ROOT/srtwriter.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/srtParser/srtsubtitle.h
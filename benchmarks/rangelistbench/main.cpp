@@ -0,0 +1,218 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "rangelist.h"
+
+// count cues spread over durationMs, lasting up to maxLengthMs,
+// so that long cues overlap many others
+static std::vector<SrtSubtitle> makeSubtitles(int count, int durationMs, int maxLengthMs, std::mt19937 &Gen)
+{
+    std::vector<SrtSubtitle> Result;
+    Result.reserve(count);
+
+    std::uniform_int_distribution<int> Start(0, durationMs);
+    std::uniform_int_distribution<int> Length(500, maxLengthMs);
+
+    for(int i = 0; i < count; ++i)
+    {
+        SrtSubtitle Sub;
+        Sub.Number = i + 1;
+        Sub.Time.StartTime = Start(Gen);
+        Sub.Time.EndTime = Sub.Time.StartTime + Length(Gen);
+        Sub.Text = QString("Cue %1").arg(i + 1);
+        Result.push_back(std::move(Sub));
+    }
+    return Result;
+}
+
+static QJsonObject result(const char *name, int queries, qint64 elapsedNs, long long checksum)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["queries"] = queries;
+    Result["ns_per_query"] = double(elapsedNs) / queries;
+    Result["checksum"] = double(checksum);
+    return Result;
+}
+
+// Apart from the transforms and the gap queries, only the iterator API is used,
+// so that the results can be compared with older versions of RangeList
+int main()
+{
+    const int DurationMs = 2 * 60 * 60 * 1000;
+    const int Queries = 20000;
+    const int SortRuns = 5;
+    const int TransformRuns = 20;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+
+    // Short cues, typical dialogue, and long cues overlapping hundreds of others
+    const int CueCounts[] = { 50000, 100000 };
+    const int MaxLengthsMs[] = { 4000, 120000 };
+    for(int CueCount : CueCounts)
+    {
+        for(int MaxLengthMs : MaxLengthsMs)
+        {
+            std::vector<SrtSubtitle> Unsorted = makeSubtitles(CueCount, DurationMs, MaxLengthMs, Gen);
+
+            QElapsedTimer Timer;
+            long long Checksum;
+
+            // Building the list sorts the subtitles and their indexes
+            qint64 SortNs = 0;
+            Checksum = 0;
+            for(int i = 0; i < SortRuns; ++i)
+            {
+                std::vector<SrtSubtitle> Subs = Unsorted;
+                Timer.start();
+                RangeList Sorted(std::move(Subs));
+                SortNs += Timer.nsecsElapsed();
+                Checksum += Sorted.begin()->Number;
+            }
+            QJsonObject Sort = result("sortSubs", SortRuns * CueCount, SortNs, Checksum);
+
+            RangeList RL(std::move(Unsorted));
+
+            std::uniform_int_distribution<int> Pos(0, DurationMs);
+            std::vector<int> Positions(Queries);
+            for(int &P : Positions) P = Pos(Gen);
+
+            // Stabbing queries through the interval index
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                for(auto it = RL.first_at(P); it != RL.end_search(); ++it)
+                {
+                    Checksum += it->Number;
+                }
+            }
+            QJsonObject Stabbing = result("first_at", Queries, Timer.nsecsElapsed(), Checksum);
+
+            // The same queries done by scanning every range
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                for(auto it = RL.begin(); it != RL.end() && it->Time.StartTime <= P; ++it)
+                {
+                    if(it->Time.EndTime >= P) Checksum += it->Number;
+                }
+            }
+            QJsonObject Linear = result("linear_scan", Queries, Timer.nsecsElapsed(), Checksum);
+
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                auto it = RL.getSubtitleAt(P);
+                if(it != RL.end()) Checksum += it->Number;
+            }
+            QJsonObject SubtitleAt = result("getSubtitleAt", Queries, Timer.nsecsElapsed(), Checksum);
+
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                Checksum += RL.countOverlapping(P, P + 1000);
+            }
+            QJsonObject Count = result("countOverlapping", Queries, Timer.nsecsElapsed(), Checksum);
+
+            // Every overlapping pair, found with a sweep over the sorted timings
+            Checksum = 0;
+            Timer.start();
+            for(auto it = RL.begin(); it != RL.end(); ++it)
+            {
+                for(auto next = it + 1; next != RL.end() && next->Time.StartTime <= it->Time.EndTime; ++next)
+                {
+                    ++Checksum;
+                }
+            }
+            QJsonObject Overlaps = result("overlap_scan", CueCount, Timer.nsecsElapsed(), Checksum);
+
+            // First gap long enough for a new cue after each position, through the gap index
+            const int GapMs = 300;
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                Checksum += RL.firstGap(P, GapMs).StartTime;
+            }
+            QJsonObject FirstGap = result("firstGap", Queries, Timer.nsecsElapsed(), Checksum);
+
+            // The same queries done by walking the subtitles after each position
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                int CoveredUntilMs = P;
+                auto it = RL.begin();
+                for(; it != RL.end() && it->Time.StartTime < P; ++it)
+                {
+                    CoveredUntilMs = std::max(CoveredUntilMs, it->Time.EndTime);
+                }
+                for(; it != RL.end() && it->Time.StartTime - CoveredUntilMs < GapMs; ++it)
+                {
+                    CoveredUntilMs = std::max(CoveredUntilMs, it->Time.EndTime);
+                }
+                Checksum += CoveredUntilMs;
+            }
+            QJsonObject FirstGapScan = result("firstGap_scan", Queries, Timer.nsecsElapsed(), Checksum);
+
+            Checksum = 0;
+            Timer.start();
+            for(int P : Positions)
+            {
+                Checksum += RL.largestGap(P, P + 60000).duration();
+            }
+            QJsonObject LargestGap = result("largestGap", Queries, Timer.nsecsElapsed(), Checksum);
+
+            // Whole track transforms, each one followed by its inverse
+            struct Transform
+            {
+                const char *Name;
+                TimeMap Forward;
+                TimeMap Backward;
+            };
+            const Transform Transforms[] = {
+                { "transform_shift", TimeMap::shift(1500), TimeMap::shift(-1500) },
+                { "transform_framerate", TimeMap::frameRate(23.976, 25.0), TimeMap::frameRate(25.0, 23.976) },
+                { "transform_piecewise",
+                  TimeMap::piecewise({ std::make_pair(0, 0), std::make_pair(DurationMs / 2, DurationMs / 2 + 2000), std::make_pair(DurationMs, DurationMs) }),
+                  TimeMap::piecewise({ std::make_pair(0, 0), std::make_pair(DurationMs / 2 + 2000, DurationMs / 2), std::make_pair(DurationMs, DurationMs) }) }
+            };
+            std::vector<QJsonObject> TransformResults;
+            for(const Transform &T : Transforms)
+            {
+                Timer.start();
+                for(int i = 0; i < TransformRuns; ++i)
+                {
+                    RL.transformTimes(T.Forward);
+                    RL.transformTimes(T.Backward);
+                }
+                TransformResults.push_back(result(T.Name, 2 * TransformRuns * CueCount, Timer.nsecsElapsed(), RL.begin()->Time.StartTime));
+            }
+
+            std::vector<QJsonObject> Benchmarks = { Sort, Stabbing, Linear, SubtitleAt, Count, Overlaps, FirstGap, FirstGapScan, LargestGap };
+            Benchmarks.insert(Benchmarks.end(), TransformResults.begin(), TransformResults.end());
+            for(QJsonObject Benchmark : Benchmarks)
+            {
+                Benchmark["cues"] = CueCount;
+                Benchmark["maxCueLengthMs"] = MaxLengthMs;
+                Results.append(Benchmark);
+            }
+        }
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
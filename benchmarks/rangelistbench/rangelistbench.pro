@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of RangeList lookups
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rangelistbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/rangelist.h \
+    $$ROOT/timemap.h \
+    $$ROOT/gapindex.h
@@ -0,0 +1,122 @@
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "model.h"
+#include "srtwriter.h"
+#include "srtParser/srtbyteparser.h"
+#include "benchmarks/benchmarkutils.h"
+
+// File contents of subs
+static QByteArray toSrt(const std::vector<SrtSubtitle> &subs)
+{
+    return serializeSrt(SrtSnapshot(RangeList(std::vector<SrtSubtitle>(subs))));
+}
+
+static QJsonObject result(const char *name, const char *change, int cues, int runs, qint64 parseNs, qint64 diffNs, qint64 applyNs)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["change"] = change;
+    Result["cues"] = cues;
+    Result["parse_ms"] = parseNs / 1000000.0 / runs;
+    Result["diff_ms"] = diffNs / 1000000.0 / runs;
+    Result["apply_ms"] = applyNs / 1000000.0 / runs;
+    Result["total_ms"] = (parseNs + diffNs + applyNs) / 1000000.0 / runs;
+    return Result;
+}
+
+int main()
+{
+    const int Runs = 5;
+    const int CueCount = 50000;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+
+    const std::vector<SrtSubtitle> Original = makeSubtitles(CueCount, Gen);
+    std::uniform_int_distribution<int> AnyCue(0, CueCount - 1);
+
+    // Versions of the file as another program could save them
+    struct Change
+    {
+        const char *Name;
+        QByteArray Data;
+    };
+    std::vector<Change> Changes;
+    Changes.push_back(Change { "none", toSrt(Original) });
+    {
+        std::vector<SrtSubtitle> Subs = Original;
+        for(int i = 0; i < 50; ++i)
+        {
+            Subs[AnyCue(Gen)].Text = "Translated again";
+        }
+        Changes.push_back(Change { "50_texts", toSrt(Subs) });
+    }
+    {
+        std::vector<SrtSubtitle> Subs = Original;
+        for(SrtSubtitle &Sub : Subs)
+        {
+            Sub.Time = Range { Sub.Time.StartTime + 40, Sub.Time.EndTime + 40 };
+        }
+        Changes.push_back(Change { "all_shifted", toSrt(Subs) });
+    }
+    {
+        std::vector<SrtSubtitle> Subs = Original;
+        for(int i = 0; i < 500; ++i)
+        {
+            Subs.erase(Subs.begin() + AnyCue(Gen) % Subs.size());
+        }
+        for(std::size_t i = 0; i < Subs.size(); ++i)
+        {
+            Subs[i].Number = i + 1;
+        }
+        Changes.push_back(Change { "500_removed_renumbered", toSrt(Subs) });
+    }
+
+    for(const Change &C : Changes)
+    {
+        QElapsedTimer Timer;
+
+        // Rebuilding the whole list, as reloading did before
+        qint64 ParseNs = 0, BuildNs = 0;
+        for(int i = 0; i < Runs; ++i)
+        {
+            Timer.start();
+            std::vector<SrtSubtitle> Parsed = SrtByteParser(C.Data.constData(), C.Data.size()).parseSubsParallel();
+            ParseNs += Timer.nsecsElapsed();
+            Timer.start();
+            SubtitleData Data { RangeList(std::move(Parsed)) };
+            BuildNs += Timer.nsecsElapsed();
+        }
+        Results.append(result("rebuild", C.Name, CueCount, Runs, ParseNs, 0, BuildNs));
+
+        // Diffing with the list in memory, and applying only the changes
+        ParseNs = 0;
+        qint64 DiffNs = 0, ApplyNs = 0;
+        for(int i = 0; i < Runs; ++i)
+        {
+            SubtitleData Data { RangeList(std::vector<SrtSubtitle>(Original)) };
+            Timer.start();
+            std::vector<SrtSubtitle> Parsed = SrtByteParser(C.Data.constData(), C.Data.size()).parseSubsParallel();
+            ParseNs += Timer.nsecsElapsed();
+            Timer.start();
+            SubtitleDiff Diff = diffSubtitles(*Data.subs(), std::move(Parsed));
+            DiffNs += Timer.nsecsElapsed();
+            Timer.start();
+            Data.applyDiff(std::move(Diff));
+            ApplyNs += Timer.nsecsElapsed();
+        }
+        Results.append(result("diff", C.Name, CueCount, Runs, ParseNs, DiffNs, ApplyNs));
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# Latency of reloading a subtitle file changed by another program
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = reloadbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/subtitlediff.cpp \
+    $$ROOT/srtwriter.cpp \
+    $$ROOT/editjournal.cpp \
+    $$ROOT/subtitlevalidator.cpp \
+    $$ROOT/textindex.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/benchmarks/benchmarkutils.h \
+    $$ROOT/subtitlediff.h \
+    $$ROOT/srtwriter.h \
+    $$ROOT/editjournal.h \
+    $$ROOT/subtitlevalidator.h \
+    $$ROOT/textindex.h \
+    $$ROOT/model.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/srtParser/srtbyteparser.h \
+    $$ROOT/srtParser/srtsubtitle.h
@@ -0,0 +1,267 @@
+#include <QApplication>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "waveformview.h"
+#include "renderer.h"
+
+// Allocation counting ---------------------------------
+// On glibc every allocation, including the ones made by Qt containers
+// and by operator new, goes through malloc, so wrapping it is enough
+
+static unsigned long AllocationCount = 0;
+
+#ifdef __GLIBC__
+extern "C"
+{
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t num, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(std::size_t size)
+{
+    ++AllocationCount;
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t num, std::size_t size)
+{
+    ++AllocationCount;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, std::size_t size)
+{
+    ++AllocationCount;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+}
+static const bool CountsAllocations = true;
+#else
+static const bool CountsAllocations = false;
+#endif
+// -----------------------------------------------------
+
+class NullRenderer : public AbstractRenderer
+{
+public:
+    int getPositionMs() const override
+    {
+        return 0;
+    }
+
+    void loadMedia(const char *filename) override
+    {
+        Q_UNUSED(filename)
+    }
+
+    void setVideoOutput(QWidget *widget) override
+    {
+        Q_UNUSED(widget)
+    }
+};
+
+// Peaks of a synthetic signal lasting durationMs, with 100 peaks per second
+static Peaks makePeaks(int durationMs, std::mt19937 &Gen)
+{
+    const int SampleRate = 44100;
+    const int SamplesPerPeak = SampleRate / 100;
+
+    Peaks Result(SamplesPerPeak, SampleRate);
+    std::uniform_int_distribution<int> Noise(0, 4000);
+
+    int PeaksNumber = durationMs / 10;
+    for(int i = 0; i < PeaksNumber; ++i)
+    {
+        // Speech like envelope, a few seconds long
+        double Envelope = 0.5 + 0.5 * std::sin(i / 300.0) * std::sin(i / 37.0);
+        int32_t Max = Envelope * 28000 + Noise(Gen);
+        Peak P(-Max, Max);
+        Result.addPeak(P);
+    }
+    Result.updateMinPeak(-32768);
+    Result.updateMaxPeak(32767);
+    return Result;
+}
+
+// count subtitles spread over durationMs, some of them overlapping
+static std::vector<SrtSubtitle> makeSubtitles(int count, int durationMs, std::mt19937 &Gen)
+{
+    std::vector<SrtSubtitle> Result;
+    Result.reserve(count);
+
+    double SlotMs = double(durationMs) / count;
+    std::uniform_real_distribution<double> Length(0.4, 1.3);
+
+    for(int i = 0; i < count; ++i)
+    {
+        SrtSubtitle Sub;
+        Sub.Number = i + 1;
+        Sub.Time.StartTime = std::round(SlotMs * i);
+        Sub.Time.EndTime = Sub.Time.StartTime + std::max(1, int(std::round(SlotMs * Length(Gen))));
+        Sub.Text = QString("Synthetic line number %1\nwith a second line of dialogue").arg(i + 1);
+        Result.push_back(std::move(Sub));
+    }
+    return Result;
+}
+
+struct PassStats
+{
+    std::vector<double> Samples;
+
+    QJsonObject toJson() const
+    {
+        std::vector<double> Sorted = Samples;
+        std::sort(Sorted.begin(), Sorted.end());
+
+        double Total = 0.0;
+        for(double S : Sorted) Total += S;
+
+        QJsonObject Result;
+        Result["mean_ms"] = Sorted.empty() ? 0.0 : Total / Sorted.size();
+        Result["median_ms"] = Sorted.empty() ? 0.0 : Sorted[Sorted.size() / 2];
+        Result["max_ms"] = Sorted.empty() ? 0.0 : Sorted.back();
+        return Result;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    // Run without any display or GPU, unless told otherwise
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication App(argc, argv);
+
+    bool Quick = argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+
+    std::vector<int> DurationsMs = { 60 * 1000, 60 * 60 * 1000, 10 * 60 * 60 * 1000 };
+    std::vector<int> SubtitleCounts = { 100, 5000, 50000 };
+    std::vector<int> PageSizesMs = { 5000, 15000, 60000, 600000, -1 }; // -1 means the whole file
+    std::vector<QSize> WidgetSizes = { QSize(800, 200), QSize(1920, 400) };
+    std::vector<int> VerticalScalings = { 100, 300 };
+    int ScrollPositions = 5;
+    int FramesPerPosition = 3;
+
+    if(Quick)
+    {
+        DurationsMs = { 60 * 60 * 1000 };
+        SubtitleCounts = { 5000 };
+        WidgetSizes = { QSize(800, 200) };
+        VerticalScalings = { 100 };
+        FramesPerPosition = 1;
+    }
+
+    std::mt19937 Gen(42);
+    NullRenderer Rend;
+    QJsonArray Results;
+
+    for(int DurationMs : DurationsMs)
+    {
+        for(int SubtitleCount : SubtitleCounts)
+        {
+            std::vector<SrtSubtitle> Subs = makeSubtitles(SubtitleCount, DurationMs, Gen);
+            std::vector<SrtSubtitle> VOSubs = Subs;
+            RangeList VO(std::move(VOSubs), false);
+
+            WaveformViewport Viewport(&Rend, makePeaks(DurationMs, Gen), SubtitleData(RangeList(std::move(Subs), true), &VO));
+
+            for(QSize Size : WidgetSizes)
+            {
+                Viewport.resize(Size);
+                QImage Surface(Size, QImage::Format_ARGB32_Premultiplied);
+
+                for(int PageSizeMs : PageSizesMs)
+                {
+                    if(PageSizeMs > DurationMs) continue;
+                    if(PageSizeMs < 0) PageSizeMs = DurationMs;
+                    Viewport.setPageSize(PageSizeMs);
+
+                    for(int VerticalScaling : VerticalScalings)
+                    {
+                        Viewport.setVerticalScaling(VerticalScaling);
+
+                        PassStats Wav, Ruler, MinimumBlank, RangeLists, Selection, Cursor, PlayCursor, Total;
+                        unsigned long Allocations = 0;
+                        int Frames = 0;
+
+                        for(int Pos = 0; Pos < ScrollPositions; ++Pos)
+                        {
+                            int MaxPositionMs = std::max(0, DurationMs - PageSizeMs);
+                            Viewport.setPosition(ScrollPositions > 1 ? (double(MaxPositionMs) * Pos) / (ScrollPositions - 1) : 0);
+
+                            for(int Frame = 0; Frame < FramesPerPosition; ++Frame)
+                            {
+                                FramePassTimings Timings;
+                                unsigned long AllocationsBefore = AllocationCount;
+                                {
+                                    QPainter Painter(&Surface);
+                                    Viewport.paintFrame(Painter, &Timings);
+                                }
+                                Allocations += AllocationCount - AllocationsBefore;
+                                ++Frames;
+
+                                Wav.Samples.push_back(Timings.Wav);
+                                Ruler.Samples.push_back(Timings.Ruler);
+                                MinimumBlank.Samples.push_back(Timings.MinimumBlank);
+                                RangeLists.Samples.push_back(Timings.RangeLists);
+                                Selection.Samples.push_back(Timings.Selection);
+                                Cursor.Samples.push_back(Timings.Cursor);
+                                PlayCursor.Samples.push_back(Timings.PlayCursor);
+                                Total.Samples.push_back(Timings.Wav + Timings.Ruler + Timings.MinimumBlank + Timings.RangeLists +
+                                                        Timings.Selection + Timings.Cursor + Timings.PlayCursor);
+                            }
+                        }
+
+                        QJsonObject Passes;
+                        Passes["paintWav"] = Wav.toJson();
+                        Passes["paintRuler"] = Ruler.toJson();
+                        Passes["paintMinimumBlank"] = MinimumBlank.toJson();
+                        Passes["paintRangeLists"] = RangeLists.toJson();
+                        Passes["paintSelection"] = Selection.toJson();
+                        Passes["paintCursor"] = Cursor.toJson();
+                        Passes["paintPlayCursor"] = PlayCursor.toJson();
+
+                        QJsonObject Result;
+                        Result["durationMs"] = DurationMs;
+                        Result["subtitles"] = SubtitleCount;
+                        Result["pageSizeMs"] = PageSizeMs;
+                        Result["width"] = Size.width();
+                        Result["height"] = Size.height();
+                        Result["verticalScaling"] = VerticalScaling;
+                        Result["frames"] = Frames;
+                        Result["passes"] = Passes;
+                        Result["total"] = Total.toJson();
+                        if(CountsAllocations)
+                        {
+                            Result["allocationsPerFrame"] = double(Allocations) / Frames;
+                        }
+                        Results.append(Result);
+                    }
+                }
+            }
+        }
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#-------------------------------------------------
+#
+# Offscreen rendering benchmark for WaveformViewport
+#
+# Run it headless with:
+#   QT_QPA_PLATFORM=offscreen ./renderbench > results.json
+#
+#-------------------------------------------------
+
+QT       += core gui multimedia widgets
+
+TARGET = renderbench
+TEMPLATE = app
+
+CONFIG += c++11 console link_pkgconfig
+CONFIG -= app_bundle
+
+PKGCONFIG += mpv
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/waveformview.cpp \
+    $$ROOT/waveformcontroller.cpp \
+    $$ROOT/waveformutils.cpp \
+    $$ROOT/renderer.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/minblank.cpp \
+    $$ROOT/textlayoutcache.cpp \
+    $$ROOT/renderscheduler.cpp \
+    $$ROOT/snappingindex.cpp \
+    $$ROOT/editjournal.cpp \
+    $$ROOT/subtitlevalidator.cpp \
+    $$ROOT/textindex.cpp \
+    $$ROOT/gapindex.cpp
+
+HEADERS += \
+    $$ROOT/waveformview.h \
+    $$ROOT/renderer.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/timemap.h \
+    $$ROOT/model.h \
+    $$ROOT/textlayoutcache.h \
+    $$ROOT/renderscheduler.h \
+    $$ROOT/snappingindex.h \
+    $$ROOT/editjournal.h \
+    $$ROOT/subtitlevalidator.h \
+    $$ROOT/textindex.h \
+    $$ROOT/gapindex.h
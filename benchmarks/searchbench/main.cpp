@@ -0,0 +1,134 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "textindex.h"
+
+// count sorted subtitles, each with a few words, some of them accented
+static std::vector<SrtSubtitle> makeSubtitles(int count, std::mt19937 &Gen)
+{
+    const QStringList Words = QString("the quick brown fox jumps over lazy dog café naïve hello world what are "
+                                      "you doing tonight never again please stop Élan déjà vu").split(' ');
+    std::uniform_int_distribution<int> Word(0, Words.size() - 1);
+    std::uniform_int_distribution<int> WordCount(4, 12);
+
+    std::vector<SrtSubtitle> Result;
+    Result.reserve(count);
+    for(int i = 0; i < count; ++i)
+    {
+        SrtSubtitle Sub;
+        Sub.Number = i + 1;
+        Sub.Time = Range { i * 2000, i * 2000 + 1500 };
+        const int Count = WordCount(Gen);
+        for(int w = 0; w < Count; ++w)
+        {
+            Sub.Text += Words[Word(Gen)];
+            Sub.Text += w == Count / 2 ? '\n' : ' ';
+        }
+        Sub.Text += QString::number(i);
+        Result.push_back(Sub);
+    }
+    return Result;
+}
+
+static QJsonObject result(const char *name, const QString &query, int cues, int matches, int runs, qint64 elapsedNs)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["query"] = query;
+    Result["cues"] = cues;
+    Result["matches"] = matches;
+    Result["ms"] = elapsedNs / 1000000.0 / runs;
+    return Result;
+}
+
+int main()
+{
+    const int Runs = 20;
+    const int CueCount = 100000;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+    RangeList RL(makeSubtitles(CueCount, Gen));
+    QElapsedTimer Timer;
+
+    TextIndex Index;
+    Timer.start();
+    Index.rebuild(RL);
+    Results.append(result("rebuild", QString(), CueCount, 0, 1, Timer.nsecsElapsed()));
+
+    const QStringList Queries = QStringList() << "t" << "to" << "ton" << "tonight" << "CAFE" << "lazy dog" << "12345" << "never again please" << "xyz";
+    for(const QString &Query : Queries)
+    {
+        // Case insensitive scan of every text, without folding diacritics
+        int Matches = 0;
+        Timer.start();
+        for(int r = 0; r < Runs; ++r)
+        {
+            Matches = 0;
+            for(auto Sub = RL.cbegin(); Sub != RL.cend(); ++Sub)
+            {
+                Matches += Sub->Text.contains(Query, Qt::CaseInsensitive);
+            }
+        }
+        Results.append(result("scan", Query, CueCount, Matches, Runs, Timer.nsecsElapsed()));
+
+        Timer.start();
+        for(int r = 0; r < Runs; ++r)
+        {
+            Matches = Index.find(RL, Query).size();
+        }
+        Results.append(result("find", Query, CueCount, Matches, Runs, Timer.nsecsElapsed()));
+    }
+
+    // Typing a query one character at a time, each search filtering the previous results
+    const QString Typed = "never again";
+    qint64 Elapsed = 0;
+    int Matches = 0;
+    for(int r = 0; r < Runs; ++r)
+    {
+        Timer.start();
+        std::vector<SubtitleHandle> Found = Index.find(RL, Typed.left(1));
+        for(int Length = 2; Length <= Typed.size(); ++Length)
+        {
+            Found = Index.refine(RL, Found, Typed.left(Length));
+        }
+        Elapsed += Timer.nsecsElapsed();
+        Matches = Found.size();
+    }
+    Results.append(result("type_refine", Typed, CueCount, Matches, Runs, Elapsed));
+
+    Elapsed = 0;
+    for(int r = 0; r < Runs; ++r)
+    {
+        Timer.start();
+        for(int Length = 1; Length <= Typed.size(); ++Length)
+        {
+            Matches = Index.find(RL, Typed.left(Length)).size();
+        }
+        Elapsed += Timer.nsecsElapsed();
+    }
+    Results.append(result("type_find", Typed, CueCount, Matches, Runs, Elapsed));
+
+    // Editing the text of a subtitle, then updating the index
+    std::uniform_int_distribution<int> AnyCue(0, CueCount - 1);
+    const int Edits = 1000;
+    Timer.start();
+    for(int i = 0; i < Edits; ++i)
+    {
+        auto Sub = RL.begin() + AnyCue(Gen);
+        RL.setText(Sub, Sub->Text + " edited");
+        Index.update(RL, RL.handle(Sub));
+    }
+    Results.append(result("update", QString(), CueCount, 0, Edits, Timer.nsecsElapsed()));
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Latency of searching the text of subtitles
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = searchbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/textindex.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/textindex.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/srtParser/srtsubtitle.h
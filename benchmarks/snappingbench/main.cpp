@@ -0,0 +1,102 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "snappingindex.h"
+
+static QJsonObject result(const char *name, int points, int steps, qint64 elapsedNs, qint64 maxNs, long long checksum)
+{
+    QJsonObject Result;
+    Result["benchmark"] = name;
+    Result["points"] = points;
+    Result["steps"] = steps;
+    Result["ns_per_step"] = double(elapsedNs) / steps;
+    Result["max_ns"] = double(maxNs);
+    Result["checksum"] = double(checksum);
+    return Result;
+}
+
+int main()
+{
+    const int DurationMs = 2 * 60 * 60 * 1000;
+    const int Steps = 100000;
+    const int SnappingDistanceMs = 80; // 8 pixels at the default zoom
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+
+    const int CueCounts[] = { 5000, 50000 };
+    for(int CueCount : CueCounts)
+    {
+        // Subtitle boundaries and some scene changes
+        SnappingIndex Index;
+        SnappingIndex::SourceId Starts = Index.addSource(SnapSubtitleStart, 3);
+        SnappingIndex::SourceId Ends = Index.addSource(SnapSubtitleEnd, 3);
+        SnappingIndex::SourceId Scenes = Index.addSource(SnapSceneChange, 2);
+
+        std::uniform_int_distribution<int> Pos(0, DurationMs);
+        std::uniform_int_distribution<int> Length(500, 4000);
+        std::vector<int> StartTimes, EndTimes, SceneTimes;
+        for(int i = 0; i < CueCount; ++i)
+        {
+            StartTimes.push_back(Pos(Gen));
+            EndTimes.push_back(StartTimes.back() + Length(Gen));
+        }
+        for(int i = 0; i < CueCount / 20; ++i)
+        {
+            SceneTimes.push_back(Pos(Gen));
+        }
+        Index.setPoints(Starts, std::move(StartTimes));
+        Index.setPoints(Ends, std::move(EndTimes));
+        Index.setPoints(Scenes, std::move(SceneTimes));
+        const int Points = Index.size();
+
+        // Drag the start of a subtitle back and forth,
+        // each step queries the index and moves the dragged point
+        QElapsedTimer Timer, StepTimer;
+        qint64 MaxQueryNs = 0, MaxDragNs = 0;
+        long long Checksum = 0;
+        std::uniform_int_distribution<int> Move(-30, 30);
+
+        int DraggedMs = Index.points(Starts)[CueCount / 2];
+        int CursorMs = DraggedMs;
+        Timer.start();
+        for(int i = 0; i < Steps; ++i)
+        {
+            CursorMs += Move(Gen);
+            StepTimer.start();
+            SnappingPoint Point = Index.nearest(CursorMs, SnappingDistanceMs, { SnappingIndex::Exclusion { Starts, DraggedMs } });
+            MaxQueryNs = std::max(MaxQueryNs, StepTimer.nsecsElapsed());
+            if(Point.Exists) Checksum += Point.TimeMs;
+        }
+        QJsonObject Query = result("nearest", Points, Steps, Timer.nsecsElapsed(), MaxQueryNs, Checksum);
+
+        Checksum = 0;
+        Timer.start();
+        for(int i = 0; i < Steps; ++i)
+        {
+            CursorMs += Move(Gen);
+            StepTimer.start();
+            SnappingPoint Point = Index.nearest(CursorMs, SnappingDistanceMs, { SnappingIndex::Exclusion { Starts, DraggedMs } });
+            int NewMs = Point.Exists ? Point.TimeMs : CursorMs;
+            Index.movePoint(Starts, DraggedMs, NewMs);
+            DraggedMs = NewMs;
+            MaxDragNs = std::max(MaxDragNs, StepTimer.nsecsElapsed());
+            Checksum += NewMs;
+        }
+        QJsonObject Drag = result("drag_step", Points, Steps, Timer.nsecsElapsed(), MaxDragNs, Checksum);
+
+        Results.append(Query);
+        Results.append(Drag);
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of snapping queries while dragging
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = snappingbench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/snappingindex.cpp
+
+HEADERS += \
+    $$ROOT/snappingindex.h
@@ -0,0 +1,189 @@
+#include <QBuffer>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryFile>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "srtParser/srtparser.h"
+#include "srtParser/srtbyteparser.h"
+#include "srtParser/subtitlereader.h"
+#include "benchmarks/benchmarkutils.h"
+
+// A file of count cues in format, with one or two lines of text each
+static QByteArray makeFile(SubtitleFormat format, int count, bool crlf, std::mt19937 &Gen)
+{
+    const char *NewLine = crlf ? "\r\n" : "\n";
+    std::uniform_int_distribution<int> Gap(0, 2000);
+    std::uniform_int_distribution<int> Length(500, 4000);
+    std::uniform_int_distribution<int> Lines(1, 2);
+
+    auto timeString = [format](int ms)
+    {
+        char Buffer[16];
+        if(format == SubtitleFormat::Ass)
+        {
+            std::snprintf(Buffer, sizeof(Buffer), "%d:%02d:%02d.%02d", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000 / 10);
+        }
+        else
+        {
+            const char Separator = format == SubtitleFormat::Srt ? ',' : '.';
+            std::snprintf(Buffer, sizeof(Buffer), "%02d:%02d:%02d%c%03d", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, Separator, ms % 1000);
+        }
+        return QByteArray(Buffer);
+    };
+
+    QByteArray Result;
+    if(format == SubtitleFormat::WebVtt)
+    {
+        Result += QByteArray("WEBVTT") + NewLine + NewLine;
+    }
+    else if(format == SubtitleFormat::Ass)
+    {
+        Result += QByteArray("[Script Info]") + NewLine + "ScriptType: v4.00+" + NewLine + NewLine;
+        Result += QByteArray("[V4+ Styles]") + NewLine + "Format: Name, Fontname, Fontsize" + NewLine;
+        Result += QByteArray("Style: Default,Arial,20") + NewLine + NewLine;
+        Result += QByteArray("[Events]") + NewLine;
+        Result += QByteArray("Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text") + NewLine;
+    }
+
+    int StartMs = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        StartMs += Gap(Gen);
+        int EndMs = StartMs + Length(Gen);
+        if(format == SubtitleFormat::Ass)
+        {
+            Result += "Dialogue: 0," + timeString(StartMs) + "," + timeString(EndMs) + ",Default,,0,0,0,,";
+            if(i % 10 == 0)
+            {
+                Result += "{\\an8}";
+            }
+            for(int l = Lines(Gen); l > 0; --l)
+            {
+                Result += QString("Line %1 of cue %2, with some àccénted text").arg(l).arg(i + 1).toUtf8() + (l > 1 ? "\\N" : "");
+            }
+            Result += NewLine;
+        }
+        else
+        {
+            Result += QByteArray::number(i + 1) + NewLine;
+            Result += timeString(StartMs) + " --> " + timeString(EndMs);
+            if(format == SubtitleFormat::WebVtt && i % 10 == 0)
+            {
+                Result += " align:start position:10%";
+            }
+            Result += NewLine;
+            for(int l = Lines(Gen); l > 0; --l)
+            {
+                Result += QString("Line %1 of cue %2, with some àccénted text").arg(l).arg(i + 1).toUtf8() + NewLine;
+            }
+            Result += NewLine;
+        }
+        StartMs = EndMs;
+    }
+    return Result;
+}
+
+int main()
+{
+    const int Runs = 5;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+
+    const int CueCounts[] = { 40000, 200000 };
+    for(int CueCount : CueCounts)
+    {
+        for(bool Crlf : { false, true })
+        {
+            QByteArray Srt = makeFile(SubtitleFormat::Srt, CueCount, Crlf, Gen);
+            QByteArray Vtt = makeFile(SubtitleFormat::WebVtt, CueCount, Crlf, Gen);
+            QByteArray Ass = makeFile(SubtitleFormat::Ass, CueCount, Crlf, Gen);
+            QElapsedTimer Timer;
+            long long Sum;
+
+            // Line by line through QTextStream
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                QBuffer Buffer(&Srt);
+                Buffer.open(QIODevice::ReadOnly);
+                Sum += checksum(SrtParser(&Buffer).parseSubs());
+            }
+            QJsonObject Stream = result(Crlf ? "SrtParser_crlf" : "SrtParser", CueCount, Srt.size(), Runs, Timer.nsecsElapsed());
+            Stream["checksum"] = double(Sum);
+
+            // Bytes already in memory
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                Sum += checksum(SrtByteParser(Srt.constData(), Srt.size()).parseSubs());
+            }
+            QJsonObject Bytes = result(Crlf ? "SrtByteParser_crlf" : "SrtByteParser", CueCount, Srt.size(), Runs, Timer.nsecsElapsed());
+            Bytes["checksum"] = double(Sum);
+
+            // The same bytes split among all the hardware threads
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                Sum += checksum(SrtByteParser(Srt.constData(), Srt.size()).parseSubsParallel());
+            }
+            QJsonObject Parallel = result(Crlf ? "SrtByteParser_parallel_crlf" : "SrtByteParser_parallel", CueCount, Srt.size(), Runs, Timer.nsecsElapsed());
+            Parallel["checksum"] = double(Sum);
+
+            // The whole path from a file, mapped in memory
+            QTemporaryFile File;
+            File.open();
+            File.write(Srt);
+            File.flush();
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                File.seek(0);
+                Sum += checksum(SrtByteParser::parseFile(File));
+            }
+            QJsonObject Mapped = result(Crlf ? "SrtByteParser_file_crlf" : "SrtByteParser_file", CueCount, Srt.size(), Runs, Timer.nsecsElapsed());
+            Mapped["checksum"] = double(Sum);
+
+            // The other formats, through the same lexer
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                Sum += checksum(VttParser(Vtt.constData(), Vtt.size()).parse().Subs);
+            }
+            QJsonObject WebVtt = result(Crlf ? "VttParser_crlf" : "VttParser", CueCount, Vtt.size(), Runs, Timer.nsecsElapsed());
+            WebVtt["checksum"] = double(Sum);
+
+            Sum = 0;
+            Timer.start();
+            for(int i = 0; i < Runs; ++i)
+            {
+                Sum += checksum(AssParser(Ass.constData(), Ass.size()).parse().Subs);
+            }
+            QJsonObject AssSsa = result(Crlf ? "AssParser_crlf" : "AssParser", CueCount, Ass.size(), Runs, Timer.nsecsElapsed());
+            AssSsa["checksum"] = double(Sum);
+
+            Results.append(Stream);
+            Results.append(Bytes);
+            Results.append(Parallel);
+            Results.append(Mapped);
+            Results.append(WebVtt);
+            Results.append(AssSsa);
+        }
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Throughput of the SRT, WebVTT and ASS parsers
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = srtparsebench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp
+
+HEADERS += \
+    $$ROOT/benchmarks/benchmarkutils.h \
+    $$ROOT/srtParser/srtsubtitle.h \
+    $$ROOT/srtParser/srtparser.h \
+    $$ROOT/srtParser/srtbyteparser.h \
+    $$ROOT/srtParser/subtitlelexer.h \
+    $$ROOT/srtParser/parsedsubtitles.h \
+    $$ROOT/srtParser/vttparser.h \
+    $$ROOT/srtParser/assparser.h \
+    $$ROOT/srtParser/subtitlereader.h
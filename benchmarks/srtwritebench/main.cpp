@@ -0,0 +1,76 @@
+#include <QBuffer>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "srtwriter.h"
+#include "benchmarks/benchmarkutils.h"
+
+int main()
+{
+    const int Runs = 5;
+
+    std::mt19937 Gen(42);
+    QJsonArray Results;
+    QTemporaryDir Dir;
+
+    const int CueCounts[] = { 40000, 200000 };
+    for(int CueCount : CueCounts)
+    {
+        RangeList RL(makeSubtitles(CueCount, Gen));
+        QElapsedTimer Timer;
+        qint64 Bytes = 0;
+
+        // A QTextStream and formatted strings for each subtitle
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            QByteArray Data;
+            QBuffer Buffer(&Data);
+            Buffer.open(QIODevice::WriteOnly);
+            for(auto Sub = RL.cbegin(); Sub != RL.cend(); ++Sub)
+            {
+                SrtSubtitle(*Sub).writeToFile(&Buffer);
+            }
+            Bytes = Data.size();
+        }
+        Results.append(result("writeToFile", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+
+        // Taking the snapshot alone, this is the part done on the UI thread
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            SrtSnapshot Snapshot(RL);
+        }
+        Results.append(result("snapshot", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+
+        // One pre-sized buffer
+        SrtSnapshot Snapshot(RL);
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            Bytes = serializeSrt(Snapshot).size();
+        }
+        Results.append(result("serializeSrt", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+
+        // The whole save, through a temporary file
+        const QString Path = Dir.filePath("bench.srt");
+        Timer.start();
+        for(int i = 0; i < Runs; ++i)
+        {
+            writeFileAtomically(Path, serializeSrt(Snapshot));
+        }
+        Results.append(result("serializeSrt_file", CueCount, Bytes, Runs, Timer.nsecsElapsed()));
+    }
+
+    QByteArray Json = QJsonDocument(Results).toJson();
+    std::fwrite(Json.constData(), 1, Json.size(), stdout);
+    return 0;
+}
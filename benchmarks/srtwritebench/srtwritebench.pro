@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Throughput of saving subtitles in SRT format
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = srtwritebench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/srtwriter.cpp \
+    $$ROOT/rangelist.cpp \
+    $$ROOT/timemap.cpp \
+    $$ROOT/gapindex.cpp \
+    $$ROOT/minblank.cpp
+
+HEADERS += \
+    $$ROOT/benchmarks/benchmarkutils.h \
+    $$ROOT/srtwriter.h \
+    $$ROOT/rangelist.h \
+    $$ROOT/srtParser/srtsubtitle.h
@@ -0,0 +1,215 @@
+#include "editjournal.h"
+
+#include <algorithm>
+
+void EditDelta::apply(RangeList &RL, bool revert) const
+{
+    switch(Type)
+    {
+    case Timing:
+        if(RL.contains(Sub))
+        {
+            RL.setTiming(RL.find(Sub), revert ? OldTime : NewTime);
+        }
+        break;
+    case Text:
+        if(RL.contains(Sub))
+        {
+            RL.setText(RL.find(Sub), revert ? QString(OldText) : QString(NewText));
+        }
+        break;
+    case Insert:
+    case Remove:
+        // Reverting an insertion is a removal, and viceversa
+        if((Type == Insert) == revert)
+        {
+            RL.removeSubtitle(Sub);
+        }
+        else
+        {
+            SrtSubtitle Restored;
+            Restored.Number = Number;
+            Restored.Time = Type == Insert ? NewTime : OldTime;
+            Restored.Text = Type == Insert ? NewText : OldText;
+            RL.restoreSubtitle(Sub, std::move(Restored));
+        }
+        break;
+    case Renumber:
+        if(RL.contains(Sub))
+        {
+            RL.setNumber(RL.find(Sub), revert ? OldNumber : Number);
+        }
+        break;
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const EditDelta &delta)
+{
+    out << quint8(delta.Type) << quint32(delta.Sub.slot()) << quint32(delta.Sub.generation()) << quint32(delta.Number)
+        << qint32(delta.OldTime.StartTime) << qint32(delta.OldTime.EndTime)
+        << qint32(delta.NewTime.StartTime) << qint32(delta.NewTime.EndTime);
+    if(delta.Type == EditDelta::Renumber)
+    {
+        out << quint32(delta.OldNumber);
+    }
+    else if(delta.Type != EditDelta::Timing)
+    {
+        out << delta.OldText << delta.NewText;
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, EditDelta &delta)
+{
+    quint8 Type;
+    quint32 Slot, Generation, Number;
+    qint32 OldStart, OldEnd, NewStart, NewEnd;
+    in >> Type >> Slot >> Generation >> Number >> OldStart >> OldEnd >> NewStart >> NewEnd;
+
+    delta.Type = EditDelta::Kind(Type);
+    delta.Sub = SubtitleHandle::fromRaw(Slot, Generation);
+    delta.Number = Number;
+    delta.OldTime = Range { OldStart, OldEnd };
+    delta.NewTime = Range { NewStart, NewEnd };
+    delta.OldText.clear();
+    delta.NewText.clear();
+    delta.OldNumber = 0;
+    if(delta.Type == EditDelta::Renumber)
+    {
+        quint32 OldNumber;
+        in >> OldNumber;
+        delta.OldNumber = OldNumber;
+    }
+    else if(delta.Type != EditDelta::Timing)
+    {
+        in >> delta.OldText >> delta.NewText;
+    }
+    return in;
+}
+
+void EditJournal::record(EditDelta &&delta)
+{
+    // A new change makes the undone ones unreachable
+    for(const Entry &E : RedoStack)
+    {
+        UsedBytes -= E.Bytes;
+    }
+    RedoStack.clear();
+
+    if(GroupDepth > 0 && GroupStarted)
+    {
+        Entry &Group = UndoStack.back();
+        EditDelta &Last = Group.Deltas.back();
+        if(delta.Type == EditDelta::Timing && Last.Type == EditDelta::Timing && Last.Sub == delta.Sub)
+        {
+            // Keep the time before the first change and the one after the last
+            Last.NewTime = delta.NewTime;
+            return;
+        }
+        Group.Bytes += delta.bytes();
+        UsedBytes += delta.bytes();
+        Group.Deltas.push_back(std::move(delta));
+        return;
+    }
+
+    Entry New;
+    New.Bytes = delta.bytes();
+    New.Deltas.push_back(std::move(delta));
+    UsedBytes += New.Bytes;
+    UndoStack.push_back(std::move(New));
+
+    if(GroupDepth > 0)
+    {
+        GroupStarted = true;
+    }
+    else
+    {
+        notify(UndoStack.back(), false);
+        enforceBudget();
+    }
+}
+
+void EditJournal::beginGroup()
+{
+    if(GroupDepth++ == 0)
+    {
+        GroupStarted = false;
+    }
+}
+
+void EditJournal::endGroup()
+{
+    if(GroupDepth == 0) return;
+
+    if(--GroupDepth == 0 && GroupStarted)
+    {
+        GroupStarted = false;
+        notify(UndoStack.back(), false);
+        enforceBudget();
+    }
+}
+
+const EditJournal::Entry *EditJournal::undo(RangeList &RL)
+{
+    if(!canUndo()) return nullptr;
+
+    RedoStack.push_back(std::move(UndoStack.back()));
+    UndoStack.pop_back();
+
+    const Entry &E = RedoStack.back();
+    apply(E, RL, true);
+    notify(E, true);
+    return &E;
+}
+
+const EditJournal::Entry *EditJournal::redo(RangeList &RL)
+{
+    if(!canRedo()) return nullptr;
+
+    UndoStack.push_back(std::move(RedoStack.back()));
+    RedoStack.pop_back();
+
+    const Entry &E = UndoStack.back();
+    apply(E, RL, false);
+    notify(E, false);
+    return &E;
+}
+
+void EditJournal::clear()
+{
+    UndoStack.clear();
+    RedoStack.clear();
+    GroupDepth = 0;
+    GroupStarted = false;
+    UsedBytes = 0;
+}
+
+void EditJournal::enforceBudget()
+{
+    // Always keep the last entry, even if it is larger than the budget
+    while(UsedBytes > BudgetBytes && UndoStack.size() > 1)
+    {
+        UsedBytes -= UndoStack.front().Bytes;
+        UndoStack.pop_front();
+    }
+}
+
+void EditJournal::apply(const Entry &entry, RangeList &RL, bool revert)
+{
+    // Changes to much of the list, e.g. timings of a whole track, are applied in a batch,
+    // so that the list is merged once instead of moving each subtitle. Merging costs O(n),
+    // so smaller entries move each subtitle, keeping undo and redo O(delta).
+    // Insertions and removals move subtitles, so they can't be batched
+    bool Batch = entry.Deltas.size() > 1 && entry.Deltas.size() > RL.size() / 4 && std::all_of(entry.Deltas.begin(), entry.Deltas.end(), [](const EditDelta &Delta)
+    {
+        return Delta.Type == EditDelta::Timing || Delta.Type == EditDelta::Text || Delta.Type == EditDelta::Renumber;
+    });
+
+    if(Batch) RL.beginBatch();
+    const int Count = entry.Deltas.size();
+    for(int i = 0; i < Count; ++i)
+    {
+        entry.Deltas[revert ? Count - 1 - i : i].apply(RL, revert);
+    }
+    if(Batch) RL.endBatch();
+}
@@ -0,0 +1,153 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QString>
+#include <QDataStream>
+
+#include <deque>
+#include <vector>
+#include <cstddef>
+
+#include "rangelist.h"
+
+// A single change to a subtitle, with what is needed to apply it and to revert it
+struct EditDelta
+{
+    enum Kind : unsigned char
+    {
+        Timing,
+        Text,
+        Insert,
+        Remove,
+        Renumber
+    };
+
+    Kind Type;
+    SubtitleHandle Sub;
+    unsigned int Number; // Insert, Remove, and the new number of Renumber
+    Range OldTime; // Unused by Insert
+    Range NewTime; // Unused by Remove
+    QString OldText; // Unused by Insert and Timing
+    QString NewText; // Unused by Remove and Timing
+    unsigned int OldNumber; // Renumber only
+
+    // Apply this change to RL, or revert it
+    void apply(RangeList &RL, bool revert) const;
+
+    // Approximate memory used by the delta
+    std::size_t bytes() const
+    {
+        return sizeof(EditDelta) + (OldText.size() + NewText.size()) * sizeof(QChar);
+    }
+};
+
+QDataStream &operator<<(QDataStream &out, const EditDelta &delta);
+QDataStream &operator>>(QDataStream &in, EditDelta &delta);
+
+// Undo/redo history of the edits to a RangeList.
+// Each entry holds the deltas of one user action, so undo and redo
+// cost O(delta), whatever the size of the list
+class EditJournal
+{
+public:
+    struct Entry
+    {
+        std::vector<EditDelta> Deltas;
+        std::size_t Bytes;
+    };
+
+    // Receives every entry once it is complete, and every undo and redo,
+    // so that the same changes can be saved elsewhere, e.g. for crash recovery
+    class Sink
+    {
+    public:
+        virtual ~Sink() { }
+        virtual void entryApplied(const Entry &entry, bool reverted) = 0;
+    };
+
+private:
+    std::deque<Entry> UndoStack;
+    std::vector<Entry> RedoStack;
+
+    int GroupDepth = 0; // Groups can be nested, the outermost one makes the entry
+    bool GroupStarted = false; // Whether the open group already has its entry
+
+    std::size_t UsedBytes = 0;
+    std::size_t BudgetBytes;
+
+    Sink *Observer = nullptr;
+
+public:
+    // Oldest entries are forgotten when the history uses more than budgetBytes
+    explicit EditJournal(std::size_t budgetBytes = 16 * 1024 * 1024) :
+        BudgetBytes(budgetBytes)
+    { }
+
+    // Record a change that has already been applied
+    void record(EditDelta &&delta);
+
+    // Changes recorded between beginGroup() and endGroup() are undone together.
+    // Consecutive timing changes of the same subtitle are merged into one,
+    // so a whole drag takes a single delta. Groups can be nested
+    void beginGroup();
+    void endGroup();
+
+    // Revert the last entry on RL, return it or nullptr if there is nothing to undo
+    const Entry *undo(RangeList &RL);
+
+    // Apply again the last undone entry on RL, return it or nullptr if there is nothing to redo
+    const Entry *redo(RangeList &RL);
+
+    // Whether a group is open, its changes are applied but not recorded yet
+    bool inGroup() const
+    {
+        return GroupDepth > 0;
+    }
+
+    bool canUndo() const
+    {
+        return !UndoStack.empty() && GroupDepth == 0;
+    }
+
+    bool canRedo() const
+    {
+        return !RedoStack.empty() && GroupDepth == 0;
+    }
+
+    void clear();
+
+    // The last entry recorded or redone, nullptr if there is none
+    const Entry *lastEntry() const
+    {
+        return UndoStack.empty() ? nullptr : &UndoStack.back();
+    }
+
+    void setBudget(std::size_t budgetBytes)
+    {
+        BudgetBytes = budgetBytes;
+        enforceBudget();
+    }
+
+    std::size_t usedBytes() const
+    {
+        return UsedBytes;
+    }
+
+    void setSink(Sink *sink)
+    {
+        Observer = sink;
+    }
+
+    // Apply, or revert, all the deltas of entry
+    static void apply(const Entry &entry, RangeList &RL, bool revert);
+
+private:
+    void enforceBudget();
+
+    void notify(const Entry &entry, bool reverted)
+    {
+        if(Observer) Observer->entryApplied(entry, reverted);
+    }
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,207 @@
+#include "gapindex.h"
+
+#include <algorithm>
+#include <limits>
+
+static const int NoGap = std::numeric_limits<int>::min();
+static const int Unbounded = std::numeric_limits<int>::max();
+
+void GapIndex::rebuild(const std::vector<Range> &Times)
+{
+    const Node Empty { NoGap, NoGap, NoGap };
+
+    Size = Times.size();
+    Capacity = 1;
+    while(Capacity < Size)
+    {
+        Capacity <<= 1;
+    }
+
+    Nodes.assign(2 * Capacity, Empty);
+    for(int i = 0; i < Size; ++i)
+    {
+        Nodes[Capacity + i] = Node { Times[i].EndTime, Times[i].StartTime, NoGap };
+    }
+    for(int k = Capacity - 1; k >= 1; --k)
+    {
+        updateNode(k);
+    }
+}
+
+void GapIndex::update(const std::vector<Range> &Times, int First, int Last)
+{
+    const Node Empty { NoGap, NoGap, NoGap };
+
+    // The tree only grows, a list that shrinks keeps empty leaves
+    Size = Times.size();
+    if(Size > Capacity || Nodes.empty())
+    {
+        rebuild(Times);
+        return;
+    }
+
+    First = std::max(First, 0);
+    Last = std::min(Last, Capacity - 1);
+    if(First > Last) return;
+
+    for(int i = First; i <= Last; ++i)
+    {
+        Nodes[Capacity + i] = i < Size ? Node { Times[i].EndTime, Times[i].StartTime, NoGap } : Empty;
+    }
+
+    // Update the ancestors of the changed leaves, level by level
+    for(int Lo = (Capacity + First) >> 1, Hi = (Capacity + Last) >> 1; Lo >= 1; Lo >>= 1, Hi >>= 1)
+    {
+        for(int k = Lo; k <= Hi; ++k)
+        {
+            updateNode(k);
+        }
+    }
+}
+
+void GapIndex::updateNode(int k)
+{
+    const Node &Left = Nodes[2 * k];
+    const Node &Right = Nodes[2 * k + 1];
+    Nodes[k] = Node { std::max(Left.MaxEnd, Right.MaxEnd), std::max(Left.MaxStart, Right.MaxStart), nodeGap(2 * k + 1, Left.MaxEnd) };
+}
+
+int GapIndex::nodeGap(int k, int CarryMs) const
+{
+    const Node &N = Nodes[k];
+    if(N.MaxStart == NoGap) return NoGap; // Empty node
+    if(CarryMs == NoGap) return Unbounded; // Nothing before the node, so nothing bounds its first gap
+    if(k >= Capacity) return N.MaxStart - CarryMs;
+
+    const Node &Left = Nodes[2 * k];
+    if(CarryMs >= Left.MaxEnd)
+    {
+        // Nothing in the left child ends after the carry, so its largest gap
+        // is the one before its last subtitle, and the right child has the same carry
+        int LeftGap = Left.MaxStart == NoGap ? NoGap : Left.MaxStart - CarryMs;
+        return std::max(LeftGap, nodeGap(2 * k + 1, CarryMs));
+    }
+    // The left child ends after the carry, so the right child sees the same times as when the node was built
+    return std::max(nodeGap(2 * k, CarryMs), N.RightGap);
+}
+
+int GapIndex::findGap(int k, int Lo, int Hi, int First, int LengthMs, int &CarryMs) const
+{
+    const Node &N = Nodes[k];
+    if(Hi < First)
+    {
+        CarryMs = std::max(CarryMs, N.MaxEnd);
+        return -1;
+    }
+    if(Lo >= Size) return -1;
+
+    if(Lo >= First && nodeGap(k, CarryMs) < LengthMs)
+    {
+        CarryMs = std::max(CarryMs, N.MaxEnd);
+        return -1;
+    }
+    if(k >= Capacity) return Lo;
+
+    int Mid = (Lo + Hi) / 2;
+    int Result = findGap(2 * k, Lo, Mid, First, LengthMs, CarryMs);
+    return Result >= 0 ? Result : findGap(2 * k + 1, Mid + 1, Hi, First, LengthMs, CarryMs);
+}
+
+int GapIndex::lowerBound(int PosMs, int &CarryMs) const
+{
+    CarryMs = NoGap;
+    if(Size == 0) return 0;
+
+    int k = 1;
+    while(k < Capacity)
+    {
+        // Start times are sorted, so the left child has a start at or after PosMs
+        // if its last one is
+        if(Nodes[2 * k].MaxStart >= PosMs)
+        {
+            k = 2 * k;
+        }
+        else
+        {
+            CarryMs = std::max(CarryMs, Nodes[2 * k].MaxEnd);
+            k = 2 * k + 1;
+        }
+    }
+
+    if(Nodes[k].MaxStart >= PosMs)
+    {
+        return k - Capacity;
+    }
+    CarryMs = std::max(CarryMs, Nodes[k].MaxEnd);
+    return Size;
+}
+
+int GapIndex::rangeGap(int k, int Lo, int Hi, int First, int Last, int &CarryMs) const
+{
+    const Node &N = Nodes[k];
+    if(Hi < First)
+    {
+        CarryMs = std::max(CarryMs, N.MaxEnd);
+        return NoGap;
+    }
+    if(Lo > Last || Lo >= Size) return NoGap;
+
+    if(Lo >= First && Hi <= Last)
+    {
+        int Result = nodeGap(k, CarryMs);
+        CarryMs = std::max(CarryMs, N.MaxEnd);
+        return Result;
+    }
+
+    int Mid = (Lo + Hi) / 2;
+    int Result = rangeGap(2 * k, Lo, Mid, First, Last, CarryMs);
+    return std::max(Result, rangeGap(2 * k + 1, Mid + 1, Hi, First, Last, CarryMs));
+}
+
+Range GapIndex::gapAt(int PosMs) const
+{
+    int CarryMs;
+    int Pos = lowerBound(PosMs, CarryMs);
+    return Range { CarryMs, Pos < Size ? Nodes[Capacity + Pos].MaxStart : Unbounded };
+}
+
+Range GapIndex::firstGap(int PosMs, int LengthMs) const
+{
+    // Subtitles starting before PosMs can only shorten the gaps after it
+    int Dummy;
+    int First = lowerBound(PosMs, Dummy);
+
+    int CarryMs = PosMs;
+    int Pos = Size > 0 ? findGap(1, 0, Capacity - 1, First, LengthMs, CarryMs) : -1;
+    return Range { CarryMs, Pos >= 0 ? Nodes[Capacity + Pos].MaxStart : Unbounded };
+}
+
+Range GapIndex::largestGap(int FromMs, int ToMs) const
+{
+    if(ToMs <= FromMs || Size == 0)
+    {
+        return Range { FromMs, ToMs };
+    }
+
+    // Gaps before the subtitles starting in [FromMs, ToMs], then the one up to ToMs
+    int Dummy;
+    int First = lowerBound(FromMs, Dummy);
+    int Last = lowerBound(ToMs + 1, Dummy) - 1;
+
+    int CarryMs = FromMs;
+    int Best = First <= Last ? rangeGap(1, 0, Capacity - 1, First, Last, CarryMs) : NoGap;
+    if(First > Last)
+    {
+        lowerBound(FromMs, CarryMs);
+        CarryMs = std::max(CarryMs, FromMs);
+    }
+
+    if(ToMs - CarryMs >= Best)
+    {
+        return Range { CarryMs, ToMs };
+    }
+
+    CarryMs = FromMs;
+    int Pos = findGap(1, 0, Capacity - 1, First, Best, CarryMs);
+    return Range { CarryMs, Nodes[Capacity + Pos].MaxStart };
+}
@@ -0,0 +1,71 @@
+#ifndef GAPINDEX_H
+#define GAPINDEX_H
+
+#include <vector>
+
+#include "srtParser/srtsubtitle.h"
+
+// Segment tree over sorted timings, to find the free time between subtitles.
+// The gap before the subtitle at position i goes from the maximum end time
+// of the subtitles before it to its start time, so subtitles overlapping
+// their neighbours are handled too.
+// Each node keeps the gaps of its right half as if its left half came first,
+// so that gaps can be found without walking the subtitles: queries and
+// single updates take O(log^2 n)
+class GapIndex
+{
+    struct Node
+    {
+        int MaxEnd; // Maximum end time in the node
+        int MaxStart; // Start time of the last subtitle in the node
+        int RightGap; // Largest gap in the right child, after the left child
+    };
+
+    // Nodes of a complete binary tree, the root is at 1 and the leaves at Capacity + i.
+    // Leaves past the end of the list are empty
+    std::vector<Node> Nodes;
+    int Capacity = 0;
+    int Size = 0;
+
+    // Largest gap in node k, when the subtitles before it end at CarryMs
+    int nodeGap(int k, int CarryMs) const;
+
+    // Position of the first subtitle in node k, spanning [Lo, Hi], at or after First,
+    // whose gap is at least LengthMs. CarryMs is the maximum end before the node,
+    // updated with the subtitles skipped. Returns -1 if there is none
+    int findGap(int k, int Lo, int Hi, int First, int LengthMs, int &CarryMs) const;
+
+    // Largest gap of the subtitles in [First, Last], inside node k spanning [Lo, Hi].
+    // CarryMs is updated like in findGap()
+    int rangeGap(int k, int Lo, int Hi, int First, int Last, int &CarryMs) const;
+
+    // First position whose subtitle starts at or after PosMs,
+    // CarryMs is set to the maximum end of the subtitles before it
+    int lowerBound(int PosMs, int &CarryMs) const;
+
+    void updateNode(int k);
+
+public:
+    // Rebuild the whole tree, in O(n log n)
+    void rebuild(const std::vector<Range> &Times);
+
+    // Update the tree after the subtitles at positions [First, Last] changed.
+    // Positions past the end of Times are cleared
+    void update(const std::vector<Range> &Times, int First, int Last);
+
+    // Free time around PosMs: from the maximum end of the subtitles starting before PosMs
+    // to the start of the first subtitle starting at or after it.
+    // Unbounded sides are INT_MIN and INT_MAX.
+    // If StartTime >= PosMs, PosMs is covered by a subtitle
+    Range gapAt(int PosMs) const;
+
+    // First free span at least LengthMs long after PosMs, only the part after PosMs counts.
+    // The free time after the last subtitle ends at INT_MAX
+    Range firstGap(int PosMs, int LengthMs) const;
+
+    // Largest free span in [FromMs, ToMs], clipped to it.
+    // Its duration is 0 or less if there is no free time
+    Range largestGap(int FromMs, int ToMs) const;
+};
+
+#endif // GAPINDEX_H
@@ -3,13 +3,25 @@
 
 #include <fstream>
 #include "waveformview.h"
+#include "waveformoverview.h"
 
 #include <QGraphicsRectItem>
 #include <QOpenGLWidget>
+#include <QVBoxLayout>
+#include <QShortcut>
+#include <QTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLineEdit>
+#include <QFileDialog>
 
 #include <iostream>
 
-#include "srtParser/srtparser.h"
+#include "srtParser/subtitlereader.h"
+#include "srtwriter.h"
+#include "projectfile.h"
+#include "autosavelog.h"
+#include "audiooffset.h"
 
 #include "renderer.h"
 
@@ -20,42 +32,461 @@
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
+    Waveform(nullptr),
+    Overview(new WaveformOverview),
+    Media(nullptr),
+    Extractor(nullptr),
+    ConformMedia(nullptr),
+    ConformExtractor(nullptr),
+    Saver(nullptr),
+    SavePending(false),
+    ReloadPending(false),
+    Autosave(nullptr),
+    Watcher(nullptr),
+    KnownFileSize(-1),
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
 
-    MediaFile file("/home/francesco/Desktop/vid.mp4");
-    AVStream **AudioStream = file.best_stream_of_type(AVMEDIA_TYPE_AUDIO);
-    Peaks P;
-    if(AudioStream != file.streams_end())
+    QWidget *Central = new QWidget(this);
+    QVBoxLayout *Layout = new QVBoxLayout(Central);
+    Layout->addWidget(Overview);
+    setCentralWidget(Central);
+
+    MediaPath = "/home/francesco/Desktop/vid.mp4";
+    SubtitlesPath = "/home/francesco/Desktop/VO.srt";
+    ProjectPath = "/home/francesco/Desktop/vid.wfproj";
+    Autosave = new AutosaveLog(SubtitlesPath);
+    if(QFile::exists(ProjectPath) && openProject())
     {
-        MediaExtractor extractor(file, *AudioStream, nullptr, P);
-        P = extractor.ExtractPeaksAndSceneChanges();
+        return;
     }
-    else
+
+    Media = new MediaFile(MediaPath.toLocal8Bit().constData());
+    AVStream **AudioStream = Media->best_stream_of_type(AVMEDIA_TYPE_AUDIO);
+    if(AudioStream == Media->streams_end())
     {
         return;
     }
 
-    QFile f("/home/francesco/Desktop/VO.srt");
+    // Extract peaks in background, meanwhile the overview shows the progress
+    Extractor = new MediaExtractor(*Media, *AudioStream, nullptr, ExtractedPeaks);
+    connect(Extractor, SIGNAL(progress(int)), Overview, SLOT(setProgress(int)));
+    connect(Extractor, SIGNAL(finished()), this, SLOT(extractionFinished()));
+    Extractor->start();
+}
+
+void MainWindow::extractionFinished()
+{
+    Extractor->wait();
+    if(Extractor->getException())
+    {
+        try
+        {
+            std::rethrow_exception(Extractor->getException());
+        }
+        catch(std::exception &err)
+        {
+            std::cerr << err.what() << std::endl;
+        }
+        return;
+    }
+
+    QFile f(SubtitlesPath);
     f.open(QFile::ReadOnly);
-    SrtParser parser(&f);
-    std::vector<SrtSubtitle> Subs = parser.parseSubs();
+    ParsedSubtitles File = parseSubtitleFile(f);
+    std::vector<SrtSubtitle> Subs = std::move(File.Subs);
     auto Subs2 = Subs;
     f.close();
 
     RangeList *VO = new RangeList(std::move(Subs2), false);
-    SubtitleData sdata(RangeList(std::move(Subs), true), VO);
+    RangeList Edited(std::move(Subs), true);
+    recoverSubtitles(Edited);
+    SubtitleData Data(std::move(Edited), VO);
+    Data.setFileFormatting(std::move(File));
+    showWaveform(std::move(ExtractedPeaks), std::move(Data));
+}
+
+bool MainWindow::openProject()
+{
+    ProjectFile Project;
+    if(!Project.open(ProjectPath))
+    {
+        std::cerr << "Can't open " << ProjectPath.toStdString() << ": " << Project.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    // The first editable list is the one to edit, the first other one the VO
+    int Edited = -1;
+    int VOIndex = -1;
+    for(int i = 0; i < Project.listCount(); ++i)
+    {
+        int &Index = Project.listEditable(i) ? Edited : VOIndex;
+        if(Index < 0) Index = i;
+    }
+    RangeList *VO = VOIndex >= 0 ? new RangeList(Project.list(VOIndex)) : nullptr;
+    RangeList Subs = Edited >= 0 ? Project.list(Edited) : RangeList(std::vector<SrtSubtitle>());
+    recoverSubtitles(Subs);
+
+    showWaveform(Project.peaks(), SubtitleData(std::move(Subs), VO));
+    Waveform->waveformViewport()->setSceneChanges(Project.sceneChanges());
+    Waveform->waveformViewport()->setPageSize(Project.view().PageSizeMs);
+    Waveform->waveformViewport()->setVerticalScaling(Project.view().VerticalScaling);
+    Waveform->setPositionMs(Project.view().PositionMs);
+    Overview->setProgress(100);
+    return true;
+}
+
+void MainWindow::saveProject()
+{
+    if(!Waveform) return;
+
+    WaveformViewport *Viewport = Waveform->waveformViewport();
+    std::vector<ProjectFile::List> Lists;
+    Lists.push_back(ProjectFile::List { Viewport->subtitleData().subs(), true });
+    if(Viewport->subtitleData().hasVO())
+    {
+        Lists.push_back(ProjectFile::List { Viewport->subtitleData().vo(), false });
+    }
+
+    ViewState View;
+    View.PositionMs = Viewport->position();
+    View.PageSizeMs = Viewport->pageSize();
+    View.VerticalScaling = Viewport->verticalScaling();
+
+    QString Error;
+    if(!ProjectFile::save(ProjectPath, Viewport->peaks(), Viewport->sceneChanges(), Lists, View, &Error))
+    {
+        std::cerr << "Saving " << ProjectPath.toStdString() << " failed: " << Error.toStdString() << std::endl;
+    }
+}
+
+void MainWindow::recoverSubtitles(RangeList &subs)
+{
+    if(!Autosave->hasRecovery()) return;
+
+    QString Error;
+    if(!Autosave->recover(subs, &Error))
+    {
+        std::cerr << "Can't recover the autosaved subtitles: " << Error.toStdString() << std::endl;
+    }
+}
 
+void MainWindow::compactAutosave()
+{
+    EditJournal &Journal = Waveform->waveformViewport()->subtitleData().journal();
+    // Changes of an open group aren't logged yet, a snapshot would contain them twice
+    if(!Journal.inGroup())
+    {
+        Autosave->compactIfNeeded(*Waveform->waveformViewport()->subtitleData().subs());
+    }
+}
+
+void MainWindow::showWaveform(Peaks &&peaks, SubtitleData &&data)
+{
     AbstractRenderer *R = new Renderer;
-    R->loadMedia("/home/francesco/Desktop/vid.mp4");
+    R->loadMedia(MediaPath.toLocal8Bit().constData());
 
-    Waveform = new WaveformView(R, std::move(P), std::move(sdata), this);
+    Waveform = new WaveformView(R, std::move(peaks), std::move(data), this);
     Waveform->setFixedHeight(300);
-    setCentralWidget(Waveform);
+    centralWidget()->layout()->addWidget(Waveform);
+
+    Overview->setSource(Waveform->waveformViewport());
+    connect(Overview, SIGNAL(positionRequested(int)), Waveform, SLOT(setPositionMs(int)));
+
+    QShortcut *Undo = new QShortcut(QKeySequence::Undo, this);
+    QShortcut *Redo = new QShortcut(QKeySequence::Redo, this);
+    connect(Undo, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(undo()));
+    connect(Redo, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(redo()));
+
+    // Walk through the subtitles with validation problems
+    connect(Waveform->waveformViewport(), SIGNAL(positionRequested(int)), Waveform, SLOT(setPositionMs(int)));
+    QShortcut *NextViolation = new QShortcut(QKeySequence(Qt::Key_F8), this);
+    QShortcut *PreviousViolation = new QShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F8), this);
+    connect(NextViolation, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(nextViolation()));
+    connect(PreviousViolation, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(previousViolation()));
+
+    QShortcut *NextGap = new QShortcut(QKeySequence(Qt::Key_F9), this);
+    connect(NextGap, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(nextGap()));
+
+    // Search as you type, Enter and F3 go to the next match
+    QLineEdit *Search = new QLineEdit(this);
+    Search->setPlaceholderText("Search subtitles");
+    centralWidget()->layout()->addWidget(Search);
+    connect(Search, SIGNAL(textChanged(QString)), Waveform->waveformViewport(), SLOT(findText(QString)));
+    connect(Search, SIGNAL(returnPressed()), Waveform->waveformViewport(), SLOT(nextMatch()));
+    QShortcut *Find = new QShortcut(QKeySequence::Find, this);
+    connect(Find, SIGNAL(activated()), Search, SLOT(setFocus()));
+    QShortcut *NextMatch = new QShortcut(QKeySequence::FindNext, this);
+    QShortcut *PreviousMatch = new QShortcut(QKeySequence::FindPrevious, this);
+    connect(NextMatch, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(nextMatch()));
+    connect(PreviousMatch, SIGNAL(activated()), Waveform->waveformViewport(), SLOT(previousMatch()));
+
+    QShortcut *Save = new QShortcut(QKeySequence::Save, this);
+    connect(Save, SIGNAL(activated()), this, SLOT(saveSubtitles()));
+    QShortcut *SaveProject = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_S), this);
+    connect(SaveProject, SIGNAL(activated()), this, SLOT(saveProject()));
+    QShortcut *Align = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_A), this);
+    connect(Align, SIGNAL(activated()), this, SLOT(alignToVO()));
+    QShortcut *Resync = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_R), this);
+    connect(Resync, SIGNAL(activated()), this, SLOT(resyncToAudio()));
+
+    // Every edit is logged from now on, from a snapshot of the current subtitles
+    SubtitleData &Data = Waveform->waveformViewport()->subtitleData();
+    Data.journal().setSink(Autosave);
+    Autosave->start(*Data.subs());
+    QTimer *Compaction = new QTimer(this);
+    connect(Compaction, SIGNAL(timeout()), this, SLOT(compactAutosave()));
+    Compaction->start(2000);
+
+    // Other programs may change the subtitles while they are open
+    const QFileInfo Info(SubtitlesPath);
+    KnownFileSize = Info.size();
+    KnownFileTime = Info.lastModified();
+    Watcher = new QFileSystemWatcher(this);
+    Watcher->addPath(SubtitlesPath);
+    connect(Watcher, SIGNAL(fileChanged(QString)), this, SLOT(subtitlesFileChanged(QString)));
+}
+
+void MainWindow::subtitlesFileChanged(const QString &path)
+{
+    // Files saved by replacing them stop being watched
+    if(!Watcher->files().contains(path) && QFile::exists(path))
+    {
+        Watcher->addPath(path);
+    }
+    reloadSubtitles();
+}
+
+void MainWindow::reloadSubtitles()
+{
+    // While saving, a change can't be told from our own write, so it is checked once the save is done
+    if(Saver)
+    {
+        ReloadPending = true;
+        return;
+    }
+
+    const QFileInfo Info(SubtitlesPath);
+    if(!Info.exists() || (Info.size() == KnownFileSize && Info.lastModified() == KnownFileTime)) return;
+
+    QFile f(SubtitlesPath);
+    if(!f.open(QFile::ReadOnly)) return;
+    ParsedSubtitles File;
+    try
+    {
+        File = parseSubtitleFile(f);
+    }
+    catch(const SrtParseError &Error)
+    {
+        // The file may be still being written, it will change again
+        std::cerr << "Can't reload " << SubtitlesPath.toStdString() << ": " << Error.what() << " at line " << Error.line() << std::endl;
+        return;
+    }
+    f.close();
+
+    WaveformViewport *Viewport = Waveform->waveformViewport();
+    SubtitleDiff Diff = diffSubtitles(*Viewport->subtitleData().subs(), std::move(File.Subs));
+    // Wait for the current drag to end
+    if(!Viewport->applySubtitleDiff(std::move(Diff)))
+    {
+        QTimer::singleShot(200, this, SLOT(reloadSubtitles()));
+        return;
+    }
+    // The subtitles are numbered as in the file now
+    Viewport->subtitleData().setFileFormatting(std::move(File));
+    KnownFileSize = Info.size();
+    KnownFileTime = Info.lastModified();
+}
+
+void MainWindow::alignToVO()
+{
+    if(!Waveform || !Waveform->waveformViewport()->subtitleData().hasVO()) return;
+
+    // Matches below this are reported, and left for the user to check
+    const double MinConfidence = 0.5;
+    const TrackAlignment Alignment = Waveform->waveformViewport()->alignToVO(MinConfidence);
+    int Applied = 0;
+    for(const CueMatch &Match : Alignment.Matches)
+    {
+        Applied += Match.Confidence >= MinConfidence;
+    }
+    ui->statusBar->showMessage(QString("Aligned %1 subtitles, %2 matched with low confidence, %3 unmatched (mean confidence %4)")
+                               .arg(Applied).arg(int(Alignment.Matches.size()) - Applied).arg(int(Alignment.Unmatched.size()))
+                               .arg(Alignment.MeanConfidence, 0, 'f', 2));
+}
+
+void MainWindow::resyncToAudio()
+{
+    if(!Waveform || ConformExtractor) return;
+
+    const QString Path = QFileDialog::getOpenFileName(this, "Audio to resync the subtitles to");
+    if(Path.isEmpty()) return;
+
+    try
+    {
+        ConformMedia = new MediaFile(Path.toLocal8Bit().constData());
+    }
+    catch(std::exception &err)
+    {
+        std::cerr << err.what() << std::endl;
+        return;
+    }
+
+    // In the file already open, the other audio is another stream, e.g. a dub
+    AVStream **Stream = ConformMedia->best_stream_of_type(AVMEDIA_TYPE_AUDIO);
+    if(Stream != ConformMedia->streams_end() && QFileInfo(Path) == QFileInfo(MediaPath))
+    {
+        AVStream **Shown = Stream;
+        Stream = ConformMedia->streams_end();
+        for(AVStream **S = ConformMedia->streams_begin(); S != ConformMedia->streams_end(); ++S)
+        {
+            if(S != Shown && (*S)->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            {
+                Stream = S;
+                break;
+            }
+        }
+    }
+    if(Stream == ConformMedia->streams_end())
+    {
+        ui->statusBar->showMessage("No other audio in " + Path);
+        delete ConformMedia;
+        ConformMedia = nullptr;
+        return;
+    }
+
+    ConformExtractor = new MediaExtractor(*ConformMedia, *Stream, nullptr, ConformPeaks);
+    connect(ConformExtractor, SIGNAL(finished()), this, SLOT(conformExtracted()));
+    ui->statusBar->showMessage("Reading the audio of " + Path);
+    ConformExtractor->start();
+}
+
+void MainWindow::conformExtracted()
+{
+    ConformExtractor->wait();
+    const std::exception_ptr Error = ConformExtractor->getException();
+    delete ConformExtractor;
+    ConformExtractor = nullptr;
+    delete ConformMedia;
+    ConformMedia = nullptr;
+    if(Error)
+    {
+        try
+        {
+            std::rethrow_exception(Error);
+        }
+        catch(std::exception &err)
+        {
+            std::cerr << err.what() << std::endl;
+        }
+        ui->statusBar->clearMessage();
+        return;
+    }
+
+    WaveformViewport *Viewport = Waveform->waveformViewport();
+    const AudioOffset Offset = findAudioOffset(Viewport->peaks(), ConformPeaks);
+    double Confidence = 0.0;
+    for(const OffsetSegment &Segment : Offset.Segments)
+    {
+        Confidence = std::max(Confidence, Segment.Confidence);
+    }
+    if(Confidence < OffsetOptions().MinCorrelation)
+    {
+        ui->statusBar->showMessage("The audio doesn't match, the subtitles were left as they were");
+        return;
+    }
+
+    // The drift of each segment is undone with the rest, as a single change
+    Viewport->transformSubtitles(Offset.timeMap());
+    ui->statusBar->showMessage(QString("Subtitles resynced: offset %1 ms (confidence %2), %3 segments")
+                               .arg(Offset.OffsetMs).arg(Offset.Confidence, 0, 'f', 2).arg(int(Offset.Segments.size())));
+}
+
+void MainWindow::saveSubtitles()
+{
+    if(!Waveform) return;
+
+    // Save again when the current save is done, with the latest changes
+    if(Saver)
+    {
+        SavePending = true;
+        return;
+    }
+
+    // Only SRT is written, saving would overwrite other formats and lose their formatting
+    SubtitleData &Data = Waveform->waveformViewport()->subtitleData();
+    if(Data.format() != SubtitleFormat::Srt)
+    {
+        ui->statusBar->showMessage("Only SRT subtitles can be saved, " + SubtitlesPath + " was left as it was");
+        return;
+    }
+
+    // The snapshot is taken here, the list can be edited while it is written
+    Saver = new SrtSaver(SrtSnapshot(*Data.subs()), SubtitlesPath);
+    connect(Saver, SIGNAL(saved(bool)), this, SLOT(subtitlesSaved(bool)));
+    Saver->start();
+}
+
+void MainWindow::subtitlesSaved(bool succeeded)
+{
+    Saver->wait();
+    if(!succeeded)
+    {
+        std::cerr << "Saving " << SubtitlesPath.toStdString() << " failed: " << Saver->errorString().toStdString() << std::endl;
+    }
+    else
+    {
+        // As written, the file may have been changed again since
+        KnownFileSize = Saver->writtenSize();
+        KnownFileTime = Saver->writtenTime();
+    }
+    delete Saver;
+    Saver = nullptr;
+
+    // Saving replaced the file, watch the new one
+    if(Watcher && !Watcher->files().contains(SubtitlesPath))
+    {
+        Watcher->addPath(SubtitlesPath);
+    }
+
+    if(ReloadPending)
+    {
+        ReloadPending = false;
+        reloadSubtitles();
+    }
+    if(SavePending)
+    {
+        SavePending = false;
+        saveSubtitles();
+    }
 }
 
 MainWindow::~MainWindow()
 {
+    if(Extractor)
+    {
+        Extractor->wait();
+        delete Extractor;
+    }
+    if(ConformExtractor)
+    {
+        ConformExtractor->wait();
+        delete ConformExtractor;
+    }
+    delete ConformMedia;
+    if(Saver)
+    {
+        Saver->wait();
+        delete Saver;
+    }
+    // The session ends cleanly, there is nothing to recover
+    if(Waveform)
+    {
+        Waveform->waveformViewport()->subtitleData().journal().setSink(nullptr);
+    }
+    Autosave->discard();
+    delete Autosave;
+    delete Media;
     delete ui;
 }
@@ -3,12 +3,23 @@
 
 #include <QMainWindow>
 #include <QGraphicsScene>
+#include <QDateTime>
+
+#include "mediaProcessor/peaks.h"
 
 namespace Ui {
 class MainWindow;
 }
 
 class WaveformView;
+class WaveformOverview;
+class MediaFile;
+class MediaExtractor;
+class SrtSaver;
+class SubtitleData;
+class AutosaveLog;
+class RangeList;
+class QFileSystemWatcher;
 
 class MainWindow : public QMainWindow
 {
@@ -18,8 +29,50 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+private slots:
+    void extractionFinished();
+    void saveSubtitles();
+    void subtitlesSaved(bool succeeded);
+    // Save peaks, subtitles and view, to restore them without extracting the peaks again
+    void saveProject();
+    // Merge the autosave log into a new snapshot if it grew too much
+    void compactAutosave();
+    void subtitlesFileChanged(const QString &path);
+    // Apply the changes made to the subtitle file by another program
+    void reloadSubtitles();
+    // Move the subtitles to the timing of the VO cues they match
+    void alignToVO();
+    // Read another audio, e.g. a new conform, to move the subtitles where their audio is in it
+    void resyncToAudio();
+    void conformExtracted();
+
 private:
+    // Restore the session saved at ProjectPath, return false if it can't be read
+    bool openProject();
+    // Replace subs with the edits of a session that didn't end cleanly, if any
+    void recoverSubtitles(RangeList &subs);
+    void showWaveform(Peaks &&peaks, SubtitleData &&data);
+
     WaveformView *Waveform;
+    WaveformOverview *Overview;
+    MediaFile *Media;
+    MediaExtractor *Extractor;
+    Peaks ExtractedPeaks;
+    // Audio the subtitles are being resynced to
+    MediaFile *ConformMedia;
+    MediaExtractor *ConformExtractor;
+    Peaks ConformPeaks;
+    QString MediaPath;
+    QString SubtitlesPath;
+    QString ProjectPath;
+    SrtSaver *Saver;
+    bool SavePending; // Saving was requested while saving
+    bool ReloadPending; // The subtitle file changed while saving
+    AutosaveLog *Autosave;
+    QFileSystemWatcher *Watcher;
+    // Size and time of the subtitle file when it was last saved or reloaded, to skip our own writes
+    qint64 KnownFileSize;
+    QDateTime KnownFileTime;
     Ui::MainWindow *ui;
 };
 
@@ -4,11 +4,11 @@ int MinBlankInfo::getStart(int minBlankTime) const
 {
     if(Part == MinBlankStart)
     {
-        return R->Time.StartTime - minBlankTime;
+        return List->find(R)->Time.StartTime - minBlankTime;
     }
     else
     {
-        return R->Time.EndTime;
+        return List->find(R)->Time.EndTime;
     }
 }
 
@@ -16,11 +16,11 @@ int MinBlankInfo::getEnd(int minBlankTime) const
 {
     if(Part == MinBlankStart)
     {
-        return R->Time.StartTime;
+        return List->find(R)->Time.StartTime;
     }
     else
     {
-        return R->Time.EndTime + minBlankTime;
+        return List->find(R)->Time.EndTime + minBlankTime;
     }
 }
 
@@ -1,7 +1,15 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <cstdint>
+#include <unordered_map>
+
 #include "rangelist.h"
+#include "srtParser/parsedsubtitles.h"
+#include "editjournal.h"
+#include "subtitlediff.h"
+#include "subtitlevalidator.h"
+#include "textindex.h"
 
 class SubtitleData
 {
@@ -13,14 +21,94 @@ private:
     // So that it can be searched in log(n) time
     RangeList Subs;
     RangeList *VO;
-    iterator Selected;
+    SubtitleHandle Selected; // Null if no subtitle is selected
+    EditJournal Journal; // Undo history of the changes to Subs
+    SubtitleValidator Validator; // Violations of Subs, kept up to date with every change
+    TextIndex SubsIndex; // Search index of Subs, kept up to date with every change
+    TextIndex VOIndex;
+    SubtitleFormat Format = SubtitleFormat::Srt; // Of the file the subtitles were read from
+    QString Header; // Of the file, see ParsedSubtitles
+    // Formatting of the subtitles having some, by handle, so that it follows them when they are sorted
+    std::unordered_map<std::uint64_t, SubtitleFormatting> Formatting;
+
+    int MaxIncrementalValidations = 256; // Changes to more subtitles than this are validated from scratch
+
+    // Update the search index after entry has been applied, or reverted
+    static std::uint64_t formattingKey(SubtitleHandle h)
+    {
+        return (std::uint64_t(h.slot()) << 32) | h.generation();
+    }
+
+    void indexEntry(const EditJournal::Entry &entry)
+    {
+        if(!SubsIndex.isBuilt()) return;
+
+        // Updates only touch the n-grams that changed, so only changes to much of the list rebuild it
+        if(entry.Deltas.size() > Subs.size() / 4)
+        {
+            SubsIndex.rebuild(Subs);
+            return;
+        }
+        // Only the final state of each subtitle matters, so the order doesn't
+        for(const EditDelta &Delta : entry.Deltas)
+        {
+            if(Delta.Type != EditDelta::Timing && Delta.Type != EditDelta::Renumber)
+            {
+                SubsIndex.update(Subs, Delta.Sub);
+            }
+        }
+    }
+
+    // Update the validator and the search index after entry has been applied, or reverted
+    void validateEntry(const EditJournal::Entry &entry, bool reverted)
+    {
+        indexEntry(entry);
+
+        const int Count = entry.Deltas.size();
+        if(Count > MaxIncrementalValidations)
+        {
+            Validator.revalidate(Subs);
+            return;
+        }
+
+        for(int i = 0; i < Count; ++i)
+        {
+            const EditDelta &Delta = entry.Deltas[reverted ? Count - 1 - i : i];
+            // The same subtitle may be removed and restored within an entry,
+            // only its final state matters
+            const bool Exists = Subs.contains(Delta.Sub);
+            switch(Delta.Type)
+            {
+            case EditDelta::Timing:
+                if(Exists) Validator.timingChanged(Subs, Delta.Sub, reverted ? Delta.NewTime : Delta.OldTime);
+                break;
+            case EditDelta::Text:
+                if(Exists) Validator.textChanged(Subs, Delta.Sub);
+                break;
+            case EditDelta::Renumber:
+                break;
+            case EditDelta::Insert:
+            case EditDelta::Remove:
+                if((Delta.Type == EditDelta::Insert) != reverted)
+                {
+                    if(Exists) Validator.subtitleInserted(Subs, Delta.Sub);
+                }
+                else
+                {
+                    Validator.subtitleRemoved(Subs, Delta.Sub, Delta.Type == EditDelta::Insert ? Delta.NewTime : Delta.OldTime);
+                }
+                break;
+            }
+        }
+    }
+
 public:
 
     SubtitleData(RangeList &&subs, RangeList *vo = nullptr) :
         Subs(std::move(subs)),
-        VO(vo),
-        Selected(Subs.end())
+        VO(vo)
     {
+        Validator.revalidate(Subs);
     }
 
     bool hasVO() const
@@ -28,7 +116,7 @@ public:
         return VO;
     }
 
-    const SrtSubtitle &operator[](RangeList::size_type index) const
+    ConstSubtitleRef operator[](RangeList::size_type index) const
     {
         return Subs[index];
     }
@@ -55,19 +143,217 @@ public:
         return &Subs;
     }
 
-    void setSelectedSubtitle(iterator sub)
+    void setSelectedSubtitle(SubtitleHandle sub)
     {
         Selected = sub;
     }
 
+    void setSelectedSubtitle(iterator sub)
+    {
+        Selected = sub == Subs.end() ? SubtitleHandle() : Subs.handle(sub);
+    }
+
+    void clearSelectedSubtitle()
+    {
+        Selected = SubtitleHandle();
+    }
+
+    // Return the selected subtitle, or end() if there is none
     iterator selectedSubtitle()
+    {
+        return Subs.find(Selected);
+    }
+
+    SubtitleHandle selectedHandle() const
     {
         return Selected;
     }
 
-    bool hasSelected()
+    // Change the timing of sub, keeping the list sorted
+    iterator setTiming(iterator sub, const Range &time)
+    {
+        const SubtitleHandle Handle = Subs.handle(sub);
+        const Range OldTime = sub->Time;
+        Journal.record(EditDelta { EditDelta::Timing, Handle, 0, OldTime, time, QString(), QString(), 0 });
+        iterator Result = Subs.setTiming(sub, time);
+        Validator.timingChanged(Subs, Handle, OldTime);
+        return Result;
+    }
+
+    // Map the timings of [first, last) through map, as a single change to undo
+    void transformTimes(const TimeMap &map, iterator first, iterator last)
+    {
+        std::vector<SubtitleHandle> Handles;
+        std::vector<Range> OldTimes;
+        Handles.reserve(last - first);
+        OldTimes.reserve(last - first);
+        for(iterator it = first; it != last; ++it)
+        {
+            Handles.push_back(Subs.handle(it));
+            OldTimes.push_back(it->Time);
+        }
+
+        Subs.transformTimes(map, first.index(), last.index() - 1);
+
+        const bool Incremental = int(Handles.size()) <= MaxIncrementalValidations;
+        Journal.beginGroup();
+        for(std::size_t i = 0; i < Handles.size(); ++i)
+        {
+            const Range &NewTime = Subs.find(Handles[i])->Time;
+            if(NewTime != OldTimes[i])
+            {
+                Journal.record(EditDelta { EditDelta::Timing, Handles[i], 0, OldTimes[i], NewTime, QString(), QString(), 0 });
+                if(Incremental) Validator.timingChanged(Subs, Handles[i], OldTimes[i]);
+            }
+        }
+        Journal.endGroup();
+
+        if(!Incremental)
+        {
+            Validator.revalidate(Subs);
+        }
+    }
+
+    void setText(iterator sub, QString &&text)
+    {
+        const SubtitleHandle Handle = Subs.handle(sub);
+        Journal.record(EditDelta { EditDelta::Text, Handle, 0, sub->Time, sub->Time, sub->Text, text, 0 });
+        Subs.setText(sub, std::move(text));
+        Validator.textChanged(Subs, Handle);
+        SubsIndex.update(Subs, Handle);
+    }
+
+    // Apply the changes of diff, as a single change to undo, keeping the handles
+    // of the subtitles it doesn't remove. Return the change, or nullptr if diff is empty
+    const EditJournal::Entry *applyDiff(SubtitleDiff &&diff)
+    {
+        if(diff.empty()) return nullptr;
+
+        Subs.beginBatch();
+        for(const EditDelta &Delta : diff.Changes)
+        {
+            Delta.apply(Subs, false);
+        }
+        Subs.endBatch();
+
+        std::vector<EditDelta> Removals;
+        Removals.reserve(diff.Removed.size());
+        for(SubtitleHandle Handle : diff.Removed)
+        {
+            iterator Sub = Subs.find(Handle);
+            Removals.push_back(EditDelta { EditDelta::Remove, Handle, Sub->Number, Sub->Time, Range(), Sub->Text, QString(), 0 });
+        }
+        Subs.removeSubtitles(diff.Removed);
+        const std::vector<SubtitleHandle> Added = Subs.addSubtitles(std::move(diff.Added));
+
+        Journal.beginGroup();
+        for(EditDelta &Delta : diff.Changes)
+        {
+            Journal.record(std::move(Delta));
+        }
+        for(EditDelta &Delta : Removals)
+        {
+            Journal.record(std::move(Delta));
+        }
+        for(SubtitleHandle Handle : Added)
+        {
+            iterator Sub = Subs.find(Handle);
+            Journal.record(EditDelta { EditDelta::Insert, Handle, Sub->Number, Range(), Sub->Time, QString(), Sub->Text, 0 });
+        }
+        Journal.endGroup();
+
+        const EditJournal::Entry *Entry = Journal.lastEntry();
+        validateEntry(*Entry, false);
+        return Entry;
+    }
+
+    // Keep the format, header and formatting of file, which the subtitles were just read or reloaded from.
+    // Its subtitles may be moved out already. Both parsers number the subtitles in file order,
+    // so the formatting entries go to the subtitles by number, wherever sorting put them
+    void setFileFormatting(ParsedSubtitles &&file)
+    {
+        Format = file.Format;
+        Header = std::move(file.Header);
+        Formatting.clear();
+        if(file.Formatting.empty()) return;
+
+        std::vector<SubtitleHandle> ByIndex(file.Formatting.back().Index + 1);
+        for(iterator Sub = Subs.begin(); Sub != Subs.end(); ++Sub)
+        {
+            if(Sub->Number >= 1 && Sub->Number <= ByIndex.size()) ByIndex[Sub->Number - 1] = Subs.handle(Sub);
+        }
+        for(SubtitleFormatting &Entry : file.Formatting)
+        {
+            const SubtitleHandle Handle = ByIndex[Entry.Index];
+            if(!Handle.isNull()) Formatting[formattingKey(Handle)] = std::move(Entry);
+        }
+    }
+
+    SubtitleFormat format() const
+    {
+        return Format;
+    }
+
+    const QString &header() const
+    {
+        return Header;
+    }
+
+    // Return the formatting of sub in its file, or nullptr if it has none
+    const SubtitleFormatting *formatting(SubtitleHandle sub) const
+    {
+        auto Entry = Formatting.find(formattingKey(sub));
+        return Entry == Formatting.end() ? nullptr : &Entry->second;
+    }
+
+    EditJournal &journal()
+    {
+        return Journal;
+    }
+
+    const SubtitleValidator &validator() const
+    {
+        return Validator;
+    }
+
+    // Search index of the subtitles, built on first use
+    const TextIndex &textIndex()
+    {
+        if(!SubsIndex.isBuilt()) SubsIndex.rebuild(Subs);
+        return SubsIndex;
+    }
+
+    // Search index of the VO, empty if there is none
+    const TextIndex &voTextIndex()
+    {
+        if(VO && !VOIndex.isBuilt()) VOIndex.rebuild(*VO);
+        return VOIndex;
+    }
+
+    void setValidationRules(const ValidationRules &rules)
+    {
+        Validator.setRules(Subs, rules);
+    }
+
+    // Revert the last change, return it or nullptr if there is none
+    const EditJournal::Entry *undo()
+    {
+        const EditJournal::Entry *Entry = Journal.undo(Subs);
+        if(Entry) validateEntry(*Entry, true);
+        return Entry;
+    }
+
+    // Apply again the last reverted change, return it or nullptr if there is none
+    const EditJournal::Entry *redo()
+    {
+        const EditJournal::Entry *Entry = Journal.redo(Subs);
+        if(Entry) validateEntry(*Entry, false);
+        return Entry;
+    }
+
+    bool hasSelected() const
     {
-        return Selected != Subs.end();
+        return Subs.contains(Selected);
     }
 };
 
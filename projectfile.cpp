@@ -0,0 +1,371 @@
+#include "projectfile.h"
+
+#include <cstring>
+
+#include "srtwriter.h"
+
+static const char Magic[8] = { 'W', 'A', 'V', 'E', 'P', 'R', 'O', 'J' };
+
+// Checksum of size bytes, 8 at a time on 4 independent lanes, so that
+// a whole project is checked in a few milliseconds
+static quint64 checksum(const char *data, std::size_t size)
+{
+    const quint64 Prime = 0x100000001B3ULL;
+    quint64 Lanes[4] = { 0xCBF29CE484222325ULL, 0x84222325CBF29CE4ULL, 0x9E3779B97F4A7C15ULL, 0x7F4A7C159E3779B9ULL };
+
+    std::size_t i = 0;
+    for(; i + 32 <= size; i += 32)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            quint64 Word;
+            std::memcpy(&Word, data + i + 8 * k, 8);
+            Lanes[k] = (Lanes[k] ^ Word) * Prime;
+        }
+    }
+    for(int k = 0; i < size; i += 8, ++k)
+    {
+        quint64 Word = 0;
+        std::memcpy(&Word, data + i, std::min<std::size_t>(8, size - i));
+        Lanes[k] = (Lanes[k] ^ Word) * Prime;
+    }
+
+    quint64 Result = size;
+    for(quint64 Lane : Lanes)
+    {
+        Result = (Result ^ Lane ^ (Lane >> 29)) * Prime;
+    }
+    return Result;
+}
+
+static void alignTo8(QByteArray &out)
+{
+    while(out.size() % 8 != 0)
+    {
+        out.append('\0');
+    }
+}
+
+template<class T>
+static void appendRaw(QByteArray &out, const T *data, std::size_t count)
+{
+    if(count > 0)
+    {
+        out.append(reinterpret_cast<const char *>(data), int(count * sizeof(T)));
+    }
+}
+
+QByteArray ProjectFile::serialize(const Peaks &peaks, const std::vector<int> &sceneChanges,
+                                  const std::vector<List> &lists, const ViewState &view)
+{
+    std::vector<Section> Sections;
+    QByteArray Out;
+
+    // Estimate the size, so that the buffer grows once
+    std::size_t Estimate = sizeof(Header) + (4 + lists.size()) * sizeof(Section) + 1024
+            + peaks.peaksNumber() * sizeof(Peak) + sceneChanges.size() * sizeof(qint32);
+    for(const List &L : lists)
+    {
+        Estimate += L.Subs->size() * (sizeof(Range) + sizeof(quint32) + sizeof(quint64) + 100);
+    }
+    Out.reserve(int(Estimate));
+    Out.fill('\0', sizeof(Header) + (4 + lists.size()) * sizeof(Section));
+
+    auto beginSection = [&](quint32 type, quint32 flags)
+    {
+        alignTo8(Out);
+        Section S;
+        S.Type = type;
+        S.Flags = flags;
+        S.Offset = Out.size();
+        S.Size = 0;
+        S.Checksum = 0;
+        Sections.push_back(S);
+    };
+    auto endSection = [&]()
+    {
+        Sections.back().Size = Out.size() - Sections.back().Offset;
+    };
+
+    beginSection(ViewSection, 0);
+    const qint32 ViewValues[4] = { view.PositionMs, view.PageSizeMs, view.VerticalScaling, 0 };
+    appendRaw(Out, ViewValues, 4);
+    endSection();
+
+    beginSection(PeaksSection, 0);
+    PeaksInfo Info = PeaksInfo();
+    Info.Count = peaks.peaksNumber();
+    if(Info.Count > 0)
+    {
+        Info.MinPeak = peaks.minPeak();
+        Info.MaxPeak = peaks.maxPeak();
+        Info.SamplesPerPeak = peaks.samplesPerPeak();
+        Info.SampleRate = peaks.sampleRate();
+    }
+    appendRaw(Out, &Info, 1);
+    if(Info.Count > 0)
+    {
+        appendRaw(Out, &peaks[0], Info.Count);
+    }
+    endSection();
+
+    beginSection(SceneChangesSection, 0);
+    appendRaw(Out, sceneChanges.data(), sceneChanges.size());
+    endSection();
+
+    // Texts of all the lists, one after the other
+    std::vector<std::vector<quint64>> TextOffsets(lists.size());
+    beginSection(TextSection, 0);
+    quint64 TextLength = 0;
+    for(std::size_t l = 0; l < lists.size(); ++l)
+    {
+        const RangeList &Subs = *lists[l].Subs;
+        TextOffsets[l].reserve(Subs.size() + 1);
+        for(auto Sub = Subs.cbegin(); Sub != Subs.cend(); ++Sub)
+        {
+            TextOffsets[l].push_back(TextLength);
+            appendRaw(Out, Sub->Text.utf16(), Sub->Text.size());
+            TextLength += Sub->Text.size();
+        }
+        TextOffsets[l].push_back(TextLength);
+    }
+    endSection();
+
+    for(std::size_t l = 0; l < lists.size(); ++l)
+    {
+        const RangeList &Subs = *lists[l].Subs;
+        std::vector<Range> Times;
+        std::vector<quint32> Numbers;
+        Times.reserve(Subs.size());
+        Numbers.reserve(Subs.size());
+        for(auto Sub = Subs.cbegin(); Sub != Subs.cend(); ++Sub)
+        {
+            Times.push_back(Sub->Time);
+            Numbers.push_back(Sub->Number);
+        }
+
+        beginSection(SubtitlesSection, lists[l].Editable ? 1 : 0);
+        SubtitlesInfo ListInfo;
+        ListInfo.Count = Subs.size();
+        appendRaw(Out, &ListInfo, 1);
+        appendRaw(Out, Times.data(), Times.size());
+        appendRaw(Out, Numbers.data(), Numbers.size());
+        alignTo8(Out);
+        appendRaw(Out, TextOffsets[l].data(), TextOffsets[l].size());
+        endSection();
+    }
+
+    for(Section &S : Sections)
+    {
+        S.Checksum = checksum(Out.constData() + S.Offset, S.Size);
+    }
+
+    Header H;
+    std::memcpy(H.Magic, Magic, sizeof(Magic));
+    H.Version = CurrentVersion;
+    H.SectionCount = Sections.size();
+    H.FileSize = Out.size();
+    H.TableChecksum = checksum(reinterpret_cast<const char *>(Sections.data()), Sections.size() * sizeof(Section));
+    char *Begin = Out.data();
+    std::memcpy(Begin, &H, sizeof(H));
+    std::memcpy(Begin + sizeof(H), Sections.data(), Sections.size() * sizeof(Section));
+    return Out;
+}
+
+bool ProjectFile::save(const QString &path, const Peaks &peaks, const std::vector<int> &sceneChanges,
+                       const std::vector<List> &lists, const ViewState &view, QString *error)
+{
+    return writeFileAtomically(path, serialize(peaks, sceneChanges, lists, view), error);
+}
+
+bool ProjectFile::open(const QString &path)
+{
+    close();
+    File.setFileName(path);
+    if(!File.open(QIODevice::ReadOnly))
+    {
+        return fail(File.errorString());
+    }
+
+    const qint64 Size = File.size();
+    Mapped = Size > 0 ? File.map(0, Size) : nullptr;
+    if(Mapped)
+    {
+        Data = reinterpret_cast<const char *>(Mapped);
+    }
+    else
+    {
+        Buffer = File.readAll();
+        Data = Buffer.constData();
+    }
+
+    if(!open(Data, Size))
+    {
+        QString Reason = Error;
+        close();
+        return fail(Reason);
+    }
+    return true;
+}
+
+bool ProjectFile::open(const char *data, std::size_t size)
+{
+    reset();
+    Data = data;
+
+    Header H;
+    if(size < sizeof(H)) return fail("Not a project file");
+    std::memcpy(&H, data, sizeof(H));
+    if(std::memcmp(H.Magic, Magic, sizeof(Magic)) != 0) return fail("Not a project file");
+    if(H.Version != CurrentVersion) return fail(QString("Unsupported project version %1").arg(H.Version));
+    if(H.FileSize != size) return fail("Truncated project file");
+    if(H.SectionCount > (size - sizeof(H)) / sizeof(Section)) return fail("Corrupt project file");
+
+    const Section *Table = reinterpret_cast<const Section *>(data + sizeof(H));
+    if(checksum(reinterpret_cast<const char *>(Table), H.SectionCount * sizeof(Section)) != H.TableChecksum)
+    {
+        return fail("Corrupt project file");
+    }
+
+    for(quint32 i = 0; i < H.SectionCount; ++i)
+    {
+        const Section &S = Table[i];
+        if(S.Offset % 8 != 0 || S.Offset > size || S.Size > size - S.Offset) return fail("Corrupt project file");
+        if(checksum(data + S.Offset, S.Size) != S.Checksum) return fail("Checksum mismatch in the project file");
+    }
+
+    // The texts must be known before the lists refer to them
+    for(quint32 i = 0; i < H.SectionCount; ++i)
+    {
+        const Section &S = Table[i];
+        const char *Begin = data + S.Offset;
+        switch(S.Type)
+        {
+        case ViewSection:
+        {
+            if(S.Size < 3 * sizeof(qint32)) return fail("Corrupt project file");
+            const qint32 *Values = reinterpret_cast<const qint32 *>(Begin);
+            View.PositionMs = Values[0];
+            View.PageSizeMs = Values[1];
+            View.VerticalScaling = Values[2];
+            break;
+        }
+        case PeaksSection:
+            if(S.Size < sizeof(PeaksInfo)) return fail("Corrupt project file");
+            std::memcpy(&PeakInfo, Begin, sizeof(PeaksInfo));
+            if(PeakInfo.Count > (S.Size - sizeof(PeaksInfo)) / sizeof(Peak)) return fail("Corrupt project file");
+            PeakData = reinterpret_cast<const Peak *>(Begin + sizeof(PeaksInfo));
+            PeakCount = PeakInfo.Count;
+            break;
+        case SceneChangesSection:
+            SceneChangeData = reinterpret_cast<const qint32 *>(Begin);
+            SceneChangeCount = S.Size / sizeof(qint32);
+            break;
+        case TextSection:
+            Text = reinterpret_cast<const ushort *>(Begin);
+            TextLength = S.Size / sizeof(ushort);
+            break;
+        default:
+            // Sections of other types are read later, or unknown
+            break;
+        }
+    }
+
+    for(quint32 i = 0; i < H.SectionCount; ++i)
+    {
+        if(Table[i].Type == SubtitlesSection && !readSubtitles(Table[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProjectFile::readSubtitles(const Section &section)
+{
+    const char *Begin = Data + section.Offset;
+    if(section.Size < sizeof(SubtitlesInfo)) return fail("Corrupt project file");
+
+    SubtitlesInfo Info;
+    std::memcpy(&Info, Begin, sizeof(Info));
+    // Each subtitle takes at least 20 bytes, checking this first avoids overflows below
+    if(Info.Count > section.Size / 20) return fail("Corrupt project file");
+
+    const std::size_t Count = Info.Count;
+    const std::size_t TimesOffset = sizeof(SubtitlesInfo);
+    const std::size_t NumbersOffset = TimesOffset + Count * sizeof(Range);
+    const std::size_t OffsetsOffset = (NumbersOffset + Count * sizeof(quint32) + 7) / 8 * 8;
+    if(OffsetsOffset + (Count + 1) * sizeof(quint64) > section.Size) return fail("Corrupt project file");
+
+    MappedList L;
+    L.Count = Count;
+    L.Times = reinterpret_cast<const Range *>(Begin + TimesOffset);
+    L.Numbers = reinterpret_cast<const quint32 *>(Begin + NumbersOffset);
+    L.TextOffsets = reinterpret_cast<const quint64 *>(Begin + OffsetsOffset);
+    L.Editable = section.Flags & 1;
+
+    // Texts must be inside the text section
+    if(L.TextOffsets[Count] > TextLength) return fail("Corrupt project file");
+    for(std::size_t i = 0; i < Count; ++i)
+    {
+        if(L.TextOffsets[i] > L.TextOffsets[i + 1]) return fail("Corrupt project file");
+    }
+
+    Lists.push_back(L);
+    return true;
+}
+
+void ProjectFile::reset()
+{
+    Error.clear();
+    View = ViewState();
+    PeakInfo = PeaksInfo();
+    PeakData = nullptr;
+    PeakCount = 0;
+    SceneChangeData = nullptr;
+    SceneChangeCount = 0;
+    Text = nullptr;
+    TextLength = 0;
+    Lists.clear();
+}
+
+void ProjectFile::close()
+{
+    reset();
+    if(Mapped)
+    {
+        File.unmap(Mapped);
+        Mapped = nullptr;
+    }
+    Buffer.clear();
+    Data = nullptr;
+    if(File.isOpen())
+    {
+        File.close();
+    }
+}
+
+Peaks ProjectFile::peaks() const
+{
+    return Peaks(std::vector<Peak>(PeakData, PeakData + PeakCount), PeakInfo.MinPeak, PeakInfo.MaxPeak,
+                 PeakInfo.SamplesPerPeak, PeakInfo.SampleRate);
+}
+
+std::vector<int> ProjectFile::sceneChanges() const
+{
+    return std::vector<int>(SceneChangeData, SceneChangeData + SceneChangeCount);
+}
+
+RangeList ProjectFile::list(int index) const
+{
+    const MappedList &L = Lists[index];
+    std::vector<Range> Times(L.Times, L.Times + L.Count);
+    std::vector<unsigned int> Numbers(L.Numbers, L.Numbers + L.Count);
+    std::vector<QString> Texts;
+    Texts.reserve(L.Count);
+    for(std::size_t i = 0; i < L.Count; ++i)
+    {
+        Texts.emplace_back(reinterpret_cast<const QChar *>(Text + L.TextOffsets[i]), int(L.TextOffsets[i + 1] - L.TextOffsets[i]));
+    }
+    return RangeList(std::move(Times), std::move(Numbers), std::move(Texts), L.Editable);
+}
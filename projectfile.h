@@ -0,0 +1,199 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <cstddef>
+#include <vector>
+
+#include "mediaProcessor/peaks.h"
+#include "rangelist.h"
+
+// Part of the view saved with a project
+struct ViewState
+{
+    int PositionMs = 0;
+    int PageSizeMs = 15000;
+    int VerticalScaling = 100;
+};
+
+// Binary project file, holding the peaks, the scene changes, the subtitle lists
+// and the view state, so that a session can be restored without parsing
+// the subtitles or extracting the peaks again.
+// The file is mapped in memory, and its arrays are used in place:
+// loading copies whole arrays, the text of each subtitle included, without parsing them.
+//
+// Layout, in native byte order, with every section aligned to 8 bytes:
+//   Header, with the file size and the checksum of the section table
+//   Section table, with the position, size and checksum of each section
+//   Sections: view state, peaks, scene changes, texts, and one for each subtitle list
+// Files of other versions, or with any checksum not matching, are refused
+class ProjectFile
+{
+public:
+    static const quint32 CurrentVersion = 1;
+
+    enum SectionType : quint32
+    {
+        ViewSection = 1,
+        PeaksSection,
+        SceneChangesSection,
+        TextSection, // UTF-16 texts of all the subtitles
+        SubtitlesSection // Flags tell whether the list is editable
+    };
+
+    struct Header
+    {
+        char Magic[8];
+        quint32 Version;
+        quint32 SectionCount;
+        quint64 FileSize;
+        quint64 TableChecksum;
+    };
+
+    struct Section
+    {
+        quint32 Type;
+        quint32 Flags;
+        quint64 Offset;
+        quint64 Size;
+        quint64 Checksum;
+    };
+
+    // Start of the peaks section, followed by the peaks
+    struct PeaksInfo
+    {
+        qint32 MinPeak;
+        qint32 MaxPeak;
+        qint32 SamplesPerPeak;
+        qint32 SampleRate;
+        quint64 Count;
+    };
+
+    // Start of a subtitles section, followed by Count times, Count numbers,
+    // then Count + 1 offsets of the texts in the text section, each array aligned to 8 bytes
+    struct SubtitlesInfo
+    {
+        quint64 Count;
+    };
+
+    // A subtitle list to save
+    struct List
+    {
+        const RangeList *Subs;
+        bool Editable;
+    };
+
+    ProjectFile() { }
+    ~ProjectFile()
+    {
+        close();
+    }
+
+    ProjectFile(const ProjectFile &) = delete;
+    ProjectFile &operator=(const ProjectFile &) = delete;
+
+    // Whole project in a single buffer
+    static QByteArray serialize(const Peaks &peaks, const std::vector<int> &sceneChanges,
+                                const std::vector<List> &lists, const ViewState &view);
+
+    // Write the project to path, replacing it only once written
+    static bool save(const QString &path, const Peaks &peaks, const std::vector<int> &sceneChanges,
+                     const std::vector<List> &lists, const ViewState &view, QString *error = nullptr);
+
+    // Map the project at path and check it, return false if it can't be used
+    bool open(const QString &path);
+
+    // Check a project already in memory, which must stay valid while it's used
+    bool open(const char *data, std::size_t size);
+
+    void close();
+
+    const QString &errorString() const
+    {
+        return Error;
+    }
+
+    const ViewState &view() const
+    {
+        return View;
+    }
+
+    // Arrays in place
+    const Peak *peakData() const
+    {
+        return PeakData;
+    }
+
+    std::size_t peakCount() const
+    {
+        return PeakCount;
+    }
+
+    const qint32 *sceneChangeData() const
+    {
+        return SceneChangeData;
+    }
+
+    std::size_t sceneChangeCount() const
+    {
+        return SceneChangeCount;
+    }
+
+    // Copies of the arrays
+    Peaks peaks() const;
+    std::vector<int> sceneChanges() const;
+
+    int listCount() const
+    {
+        return Lists.size();
+    }
+
+    bool listEditable(int index) const
+    {
+        return Lists[index].Editable;
+    }
+
+    RangeList list(int index) const;
+
+private:
+    bool fail(const QString &error)
+    {
+        Error = error;
+        return false;
+    }
+
+    bool readSubtitles(const Section &section);
+
+    // Forget what was read, without closing the file
+    void reset();
+
+    QFile File;
+    uchar *Mapped = nullptr;
+    QByteArray Buffer; // The file contents, when it can't be mapped
+    const char *Data = nullptr;
+
+    QString Error;
+    ViewState View;
+    PeaksInfo PeakInfo = PeaksInfo();
+    const Peak *PeakData = nullptr;
+    std::size_t PeakCount = 0;
+    const qint32 *SceneChangeData = nullptr;
+    std::size_t SceneChangeCount = 0;
+    const ushort *Text = nullptr;
+    std::size_t TextLength = 0;
+
+    struct MappedList
+    {
+        std::size_t Count;
+        const Range *Times;
+        const quint32 *Numbers;
+        const quint64 *TextOffsets;
+        bool Editable;
+    };
+    std::vector<MappedList> Lists;
+};
+
+#endif // PROJECTFILE_H
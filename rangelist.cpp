@@ -1,50 +1,597 @@
 #include "rangelist.h"
 
+#include <limits>
+
 RangeLookupIterator::RangeLookupIterator(RangeList &RL, int posMs, int expandBy) :
-    SearchStartAtMs(posMs),
-    ExpandBy(expandBy),
-    Cur(RL.subsAheadOf(SearchStartAtMs - ExpandBy)),
-    Begin(RL.begin()),
-    End(RL.end()),
-    Result(RL.end())
+    QueryStartMs(posMs - expandBy),
+    QueryEndMs(posMs + expandBy),
+    List(&RL),
+    Size(RL.size()),
+    Result(RL.size()),
+    StackSize(0),
+    ScanIndex(0),
+    ScanEnd(0)
 {
-    if(Cur == End)
-    {
-        --Cur;
-    }
-    while(Cur != Begin && Cur->Time.EndTime >= SearchStartAtMs + ExpandBy)
+    if(RL.RootLevel >= 0)
     {
-       --Cur;
+        push((1 << RL.RootLevel) - 1, RL.RootLevel, false);
     }
     ++(*this);
 }
 
 RangeLookupIterator::RangeLookupIterator(RangeList &RL) :
-    SearchStartAtMs(0),
-    ExpandBy(0),
-    Cur(RL.end()),
-    Begin(RL.begin()),
-    End(RL.end()),
-    Result(RL.end())
+    QueryStartMs(0),
+    QueryEndMs(0),
+    List(&RL),
+    Size(RL.size()),
+    Result(RL.size()),
+    StackSize(0),
+    ScanIndex(0),
+    ScanEnd(0)
 { }
 
 RangeLookupIterator &RangeLookupIterator::operator ++()
 {
-    Result = End;
-    while(Cur >= Begin && Cur != End)
+    const std::vector<Range> &Times = List->Times;
+    const std::vector<int> &MaxEnd = List->MaxEnd;
+    Result = Size;
+    while(true)
+    {
+        // Go on with the linear scan of a small subtree
+        while(ScanIndex < ScanEnd)
+        {
+            const Range &Tmp = Times[ScanIndex];
+            ++ScanIndex;
+            if(Tmp.StartTime > QueryEndMs)
+            {
+                ScanIndex = ScanEnd;
+            }
+            else if(Tmp.EndTime >= QueryStartMs)
+            {
+                Result = ScanIndex - 1;
+                return *this;
+            }
+        }
+
+        if(StackSize == 0)
+        {
+            return *this;
+        }
+
+        Node Curr = Stack[--StackSize];
+        if(Curr.Level <= 3)
+        {
+            // The subtree has at most 15 elements, scan it
+            ScanIndex = Curr.Index >> Curr.Level << Curr.Level;
+            ScanEnd = std::min(ScanIndex + (1 << (Curr.Level + 1)) - 1, Size);
+        }
+        else if(!Curr.LeftVisited)
+        {
+            // Visit the left subtree first, but only if it can contain overlapping ranges.
+            // The left child may be past the end, while some of its descendants are not
+            push(Curr.Index, Curr.Level, true);
+            int Left = Curr.Index - (1 << (Curr.Level - 1));
+            if(Left >= Size || MaxEnd[Left] >= QueryStartMs)
+            {
+                push(Left, Curr.Level - 1, false);
+            }
+        }
+        else if(Curr.Index < Size && Times[Curr.Index].StartTime <= QueryEndMs)
+        {
+            // Then the node itself, and its right subtree if it can contain overlapping ranges
+            int Right = Curr.Index + (1 << (Curr.Level - 1));
+            if(List->subtreeMaxEnd(Right, Curr.Level - 1) >= QueryStartMs)
+            {
+                push(Right, Curr.Level - 1, false);
+            }
+            if(Times[Curr.Index].EndTime >= QueryStartMs)
+            {
+                Result = Curr.Index;
+                return *this;
+            }
+        }
+    }
+}
+
+RangeList::RangeList(std::vector<SrtSubtitle> &&subs, bool editable) :
+    Editable(editable)
+{
+    Times.reserve(subs.size());
+    Numbers.reserve(subs.size());
+    Texts.reserve(subs.size());
+    SlotOf.reserve(subs.size());
+    for(SrtSubtitle &Sub : subs)
+    {
+        append(std::move(Sub));
+    }
+    subs.clear();
+    sortSubs();
+}
+
+RangeList::RangeList(std::vector<Range> &&times, std::vector<unsigned int> &&numbers, std::vector<QString> &&texts, bool editable) :
+    Times(std::move(times)),
+    Numbers(std::move(numbers)),
+    Texts(std::move(texts)),
+    Editable(editable)
+{
+    SlotOf.reserve(Times.size());
+    for(size_type i = 0; i < Times.size(); ++i)
+    {
+        SlotOf.push_back(allocateSlot(i));
+    }
+    if(std::is_sorted(Times.begin(), Times.end()))
+    {
+        updateIndexes();
+    }
+    else
+    {
+        sortSubs();
+    }
+}
+
+int RangeList::append(SrtSubtitle &&sub)
+{
+    int Index = Times.size();
+    Times.push_back(sub.Time);
+    Numbers.push_back(sub.Number);
+    Texts.push_back(std::move(sub.Text));
+    SlotOf.push_back(allocateSlot(Index));
+    return Index;
+}
+
+void RangeList::updateIndexes()
+{
+    updateEndIndex();
+    updateIntervalIndex(0, int(Times.size()) - 1);
+}
+
+void RangeList::updateEndIndex()
+{
+    SortedEnds.clear();
+    SortedEnds.reserve(Times.size());
+    TotalDurationMs = 0;
+    for(const Range &Time : Times)
+    {
+        SortedEnds.push_back(Time.EndTime);
+        TotalDurationMs += Time.duration();
+    }
+    std::sort(SortedEnds.begin(), SortedEnds.end());
+    AverageDurationMs = Times.empty() ? 0 : TotalDurationMs / Times.size();
+}
+
+int RangeList::subtreeMaxEnd(int Index, int Level) const
+{
+    // A node past the end has no value, but its left descendants may exist
+    const int Size = Times.size();
+    while(Index >= Size && Level > 0)
+    {
+        --Level;
+        Index -= 1 << Level;
+    }
+    return Index < Size ? MaxEnd[Index] : std::numeric_limits<int>::min();
+}
+
+void RangeList::updateIntervalIndex(int First, int Last)
+{
+    Gaps.update(Times, First, Last);
+
+    const int Size = Times.size();
+    MaxEnd.resize(Size);
+
+    if(Size == 0)
+    {
+        RootLevel = -1;
+        return;
+    }
+    RootLevel = 0;
+    while((2 << RootLevel) <= Size)
+    {
+        ++RootLevel;
+    }
+    if(First > Last)
+    {
+        return;
+    }
+
+    // Recompute, level by level, the nodes whose subtree contains any of the
+    // subtitles in [First, Last]. Nodes at level k are the indices with k trailing ones,
+    // their subtree spans [i - (2^k - 1), i + (2^k - 1)]
+    for(int Level = 0; Level <= RootLevel; ++Level)
+    {
+        int HalfSpan = 1 << Level;
+        int Step = HalfSpan << 1;
+        int FirstNode = HalfSpan - 1;
+        if(First - HalfSpan + 1 > FirstNode)
+        {
+            FirstNode += ((First - HalfSpan + 1 - FirstNode + Step - 1) / Step) * Step;
+        }
+        for(int i = FirstNode; i < Size && i - (HalfSpan - 1) <= Last; i += Step)
+        {
+            int Max = Times[i].EndTime;
+            if(Level > 0)
+            {
+                Max = std::max(Max, MaxEnd[i - (HalfSpan >> 1)]);
+                Max = std::max(Max, subtreeMaxEnd(i + (HalfSpan >> 1), Level - 1));
+            }
+            MaxEnd[i] = Max;
+        }
+    }
+}
+
+void RangeList::sortSubs()
+{
+    std::vector<int> Order(Times.size());
+    for(size_type i = 0; i < Order.size(); ++i)
+    {
+        Order[i] = i;
+    }
+    std::stable_sort(Order.begin(), Order.end(), [this](int i1, int i2)
+    {
+        return Times[i1] < Times[i2];
+    });
+    applyOrder(Order);
+}
+
+void RangeList::saveSlots(std::vector<std::uint32_t> &slotOf, std::vector<std::uint32_t> &generations) const
+{
+    slotOf = SlotOf;
+    generations.clear();
+    generations.reserve(Slots.size());
+    for(const Slot &S : Slots)
+    {
+        generations.push_back(S.Generation);
+    }
+}
+
+bool RangeList::restoreSlots(const std::vector<std::uint32_t> &slotOf, const std::vector<std::uint32_t> &generations)
+{
+    if(slotOf.size() != Times.size()) return false;
+
+    std::vector<Slot> NewSlots(generations.size());
+    for(std::size_t i = 0; i < generations.size(); ++i)
+    {
+        NewSlots[i] = Slot { -1, generations[i] };
+    }
+    for(std::size_t i = 0; i < slotOf.size(); ++i)
+    {
+        if(slotOf[i] >= NewSlots.size() || NewSlots[slotOf[i]].Index >= 0) return false;
+        NewSlots[slotOf[i]].Index = i;
+    }
+
+    Slots = std::move(NewSlots);
+    SlotOf = slotOf;
+    FreeSlots.clear();
+    for(std::size_t i = Slots.size(); i-- > 0;)
+    {
+        if(Slots[i].Index < 0) FreeSlots.push_back(i);
+    }
+    return true;
+}
+
+std::uint32_t RangeList::allocateSlot(int Index)
+{
+    while(!FreeSlots.empty())
+    {
+        std::uint32_t SlotIndex = FreeSlots.back();
+        FreeSlots.pop_back();
+        // Restored subtitles take their slot back without leaving the free list
+        if(Slots[SlotIndex].Index >= 0) continue;
+        Slots[SlotIndex].Index = Index;
+        return SlotIndex;
+    }
+    Slots.push_back(Slot { Index, 0 });
+    return Slots.size() - 1;
+}
+
+void RangeList::updateSlots(int First, int Last)
+{
+    for(int i = First; i <= Last; ++i)
+    {
+        Slots[SlotOf[i]].Index = i;
+    }
+}
+
+RangeList::iterator RangeList::setTiming(iterator sub, const Range &newTime)
+{
+    int From = sub.index();
+    Range OldTime = Times[From];
+    Times[From] = newTime;
+    ++Revision;
+
+    if(InBatch)
+    {
+        DirtyIndices.push_back(From);
+        return sub;
+    }
+
+    // Keep the end index and the statistics up to date
+    SortedEnds.erase(std::lower_bound(SortedEnds.begin(), SortedEnds.end(), OldTime.EndTime));
+    SortedEnds.insert(std::upper_bound(SortedEnds.begin(), SortedEnds.end(), newTime.EndTime), newTime.EndTime);
+    TotalDurationMs += newTime.duration() - OldTime.duration();
+    AverageDurationMs = TotalDurationMs / Times.size();
+
+    int To = From;
+    if(From > 0 && newTime < Times[From - 1])
+    {
+        // Move it back, after the last subtitle not greater than it
+        To = std::upper_bound(Times.begin(), Times.begin() + From, newTime) - Times.begin();
+        rotate(To, From, From + 1);
+    }
+    else if(From + 1 < int(Times.size()) && Times[From + 1] < newTime)
+    {
+        // Move it forward, before the first subtitle not less than it
+        To = (std::lower_bound(Times.begin() + From + 1, Times.end(), newTime) - Times.begin()) - 1;
+        rotate(From, From + 1, To + 1);
+    }
+
+    updateSlots(std::min(From, To), std::max(From, To));
+    updateIntervalIndex(std::min(From, To), std::max(From, To));
+    return iterator(this, To);
+}
+
+void RangeList::rotate(int First, int Middle, int Last)
+{
+    std::rotate(Times.begin() + First, Times.begin() + Middle, Times.begin() + Last);
+    std::rotate(Numbers.begin() + First, Numbers.begin() + Middle, Numbers.begin() + Last);
+    std::rotate(Texts.begin() + First, Texts.begin() + Middle, Texts.begin() + Last);
+    std::rotate(SlotOf.begin() + First, SlotOf.begin() + Middle, SlotOf.begin() + Last);
+}
+
+void RangeList::beginBatch()
+{
+    InBatch = true;
+    DirtyIndices.clear();
+}
+
+void RangeList::endBatch()
+{
+    InBatch = false;
+
+    std::vector<char> Dirty(Times.size(), false);
+    for(int Index : DirtyIndices)
+    {
+        Dirty[Index] = true;
+    }
+    DirtyIndices.clear();
+
+    mergeDirty(Dirty);
+}
+
+void RangeList::transformTimes(const TimeMap &map, int First, int Last)
+{
+    First = std::max(First, 0);
+    Last = std::min(Last, int(Times.size()) - 1);
+    if(First > Last) return;
+
+    map.apply(Times.data() + First, Times.data() + Last + 1);
+    ++Revision;
+
+    // Times reversed by the map, or by the rounding of a map that steps back
+    for(int i = First; i <= Last; ++i)
+    {
+        if(Times[i].EndTime < Times[i].StartTime)
+        {
+            std::swap(Times[i].StartTime, Times[i].EndTime);
+        }
+    }
+
+    if(InBatch)
+    {
+        for(int i = First; i <= Last; ++i)
+        {
+            DirtyIndices.push_back(i);
+        }
+        return;
+    }
+
+    // Even a monotonic map can make start times equal,
+    // and then subtitles are sorted by end time
+    const bool Sorted = map.isMonotonic() && std::is_sorted(Times.begin() + First, Times.begin() + Last + 1);
+
+    if(Sorted && First == 0 && Last == int(Times.size()) - 1)
+    {
+        // Nothing moves, and end times keep their order too
+        map.apply(SortedEnds.data(), SortedEnds.data() + SortedEnds.size());
+        TotalDurationMs = 0;
+        for(const Range &Time : Times)
+        {
+            TotalDurationMs += Time.duration();
+        }
+        AverageDurationMs = TotalDurationMs / Times.size();
+        updateIntervalIndex(0, Last);
+        return;
+    }
+
+    std::vector<char> Dirty(Times.size(), false);
+    std::fill(Dirty.begin() + First, Dirty.begin() + Last + 1, true);
+    mergeDirty(Dirty, Sorted);
+}
+
+void RangeList::mergeDirty(const std::vector<char> &Dirty, bool DirtySorted)
+{
+    const int Size = Times.size();
+
+    // Clean subtitles are still sorted among themselves,
+    // so sort only the dirty ones and merge the two sequences
+    std::vector<int> Order;
+    Order.reserve(Size);
+    for(int i = 0; i < Size; ++i)
+    {
+        if(!Dirty[i]) Order.push_back(i);
+    }
+    auto DirtyBegin = Order.size();
+    for(int i = 0; i < Size; ++i)
+    {
+        if(Dirty[i]) Order.push_back(i);
+    }
+
+    auto Less = [this](int i1, int i2)
+    {
+        return Times[i1] < Times[i2];
+    };
+    if(!DirtySorted)
+    {
+        std::stable_sort(Order.begin() + DirtyBegin, Order.end(), Less);
+    }
+    std::inplace_merge(Order.begin(), Order.begin() + DirtyBegin, Order.end(), Less);
+
+    applyOrder(Order);
+}
+
+// Permute Values so that Values[i] becomes the old Values[Order[i]]
+template<class T>
+static void permute(std::vector<T> &Values, const std::vector<int> &Order)
+{
+    std::vector<T> Sorted;
+    Sorted.reserve(Values.size());
+    for(int Index : Order)
+    {
+        Sorted.push_back(std::move(Values[Index]));
+    }
+    Values.swap(Sorted);
+}
+
+void RangeList::applyOrder(const std::vector<int> &Order)
+{
+    permute(Times, Order);
+    permute(Numbers, Order);
+    permute(Texts, Order);
+    permute(SlotOf, Order);
+    ++Revision;
+
+    updateSlots(0, int(Times.size()) - 1);
+    updateIndexes();
+}
+
+SubtitleHandle RangeList::addSubtitle(SrtSubtitle &&sub)
+{
+    int Pos = insertSorted(std::move(sub), allocateSlot(-1));
+    return handle(cbegin() + Pos);
+}
+
+bool RangeList::restoreSubtitle(SubtitleHandle h, SrtSubtitle &&sub)
+{
+    while(Slots.size() <= h.Slot)
     {
-        std::vector<SrtSubtitle>::iterator Tmp = Cur;
-        ++Cur;
-        if(Tmp->Time.StartTime > SearchStartAtMs + ExpandBy)
+        Slots.push_back(Slot { -1, 0 });
+        if(Slots.size() - 1 != h.Slot)
         {
-            break;
+            FreeSlots.push_back(Slots.size() - 1);
         }
-        else if(Tmp->Time.StartTime <= SearchStartAtMs + ExpandBy &&
-                Tmp->Time.EndTime >= SearchStartAtMs - ExpandBy)
+    }
+    if(Slots[h.Slot].Index >= 0) return false;
+
+    Slots[h.Slot].Generation = h.Generation;
+    insertSorted(std::move(sub), h.Slot);
+    return true;
+}
+
+int RangeList::insertSorted(SrtSubtitle &&sub, std::uint32_t SlotIndex)
+{
+    int Pos = std::upper_bound(Times.begin(), Times.end(), sub.Time) - Times.begin();
+    int EndTime = sub.Time.EndTime;
+
+    TotalDurationMs += sub.Time.duration();
+    Times.insert(Times.begin() + Pos, sub.Time);
+    Numbers.insert(Numbers.begin() + Pos, sub.Number);
+    Texts.insert(Texts.begin() + Pos, std::move(sub.Text));
+    SlotOf.insert(SlotOf.begin() + Pos, SlotIndex);
+    updateSlots(Pos, int(Times.size()) - 1);
+    ++Revision;
+
+    SortedEnds.insert(std::upper_bound(SortedEnds.begin(), SortedEnds.end(), EndTime), EndTime);
+    AverageDurationMs = TotalDurationMs / Times.size();
+    updateIntervalIndex(Pos, int(Times.size()) - 1);
+
+    return Pos;
+}
+
+std::vector<SubtitleHandle> RangeList::addSubtitles(std::vector<SrtSubtitle> &&subs)
+{
+    const int OldSize = Times.size();
+
+    std::vector<char> Dirty(OldSize, false);
+    std::vector<SubtitleHandle> Result;
+    Result.reserve(subs.size());
+    for(SrtSubtitle &Sub : subs)
+    {
+        int Index = append(std::move(Sub));
+        Result.push_back(handle(cbegin() + Index));
+        Dirty.push_back(true);
+    }
+
+    mergeDirty(Dirty);
+    return Result;
+}
+
+void RangeList::removeSubtitle(SubtitleHandle h)
+{
+    if(!contains(h)) return;
+
+    int Pos = Slots[h.Slot].Index;
+    int EndTime = Times[Pos].EndTime;
+
+    TotalDurationMs -= Times[Pos].duration();
+    Times.erase(Times.begin() + Pos);
+    Numbers.erase(Numbers.begin() + Pos);
+    Texts.erase(Texts.begin() + Pos);
+    SlotOf.erase(SlotOf.begin() + Pos);
+    ++Revision;
+    updateSlots(Pos, int(Times.size()) - 1);
+
+    // Free the slot, handles to it become stale
+    Slots[h.Slot].Index = -1;
+    ++Slots[h.Slot].Generation;
+    FreeSlots.push_back(h.Slot);
+
+    SortedEnds.erase(std::lower_bound(SortedEnds.begin(), SortedEnds.end(), EndTime));
+    AverageDurationMs = Times.empty() ? 0 : TotalDurationMs / Times.size();
+    // Ancestors of the removed position must be updated too, even if it was the last one
+    updateIntervalIndex(Pos, Times.size());
+}
+
+void RangeList::removeSubtitles(const std::vector<SubtitleHandle> &handles)
+{
+    std::vector<char> Removed(Times.size(), false);
+    bool Any = false;
+    for(SubtitleHandle h : handles)
+    {
+        if(!contains(h)) continue;
+        Removed[Slots[h.Slot].Index] = true;
+        Any = true;
+    }
+    if(!Any) return;
+
+    // Compact the kept subtitles in place, then rebuild the indexes once
+    const int OldSize = Times.size();
+    int Kept = 0;
+    for(int i = 0; i < int(Times.size()); ++i)
+    {
+        if(Removed[i])
         {
-            Result = Tmp;
-            break;
+            std::uint32_t SlotIndex = SlotOf[i];
+            Slots[SlotIndex].Index = -1;
+            ++Slots[SlotIndex].Generation;
+            FreeSlots.push_back(SlotIndex);
+            continue;
         }
+        if(Kept != i)
+        {
+            Times[Kept] = Times[i];
+            Numbers[Kept] = Numbers[i];
+            Texts[Kept] = std::move(Texts[i]);
+            SlotOf[Kept] = SlotOf[i];
+        }
+        ++Kept;
     }
-    return *this;
+    Times.resize(Kept);
+    Numbers.resize(Kept);
+    Texts.resize(Kept);
+    SlotOf.resize(Kept);
+    ++Revision;
+
+    updateSlots(0, Kept - 1);
+    updateEndIndex();
+    // Over the old size, so that the positions past the new end are cleared too
+    updateIntervalIndex(0, OldSize - 1);
 }
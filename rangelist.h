@@ -2,20 +2,283 @@
 #define RANGELIST_H
 
 #include "srtParser/srtsubtitle.h"
+#include "timemap.h"
+#include "gapindex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
 
 class RangeList;
 
+// Stable reference to a subtitle of a RangeList.
+// Unlike iterators, it stays valid across insertions, deletions and
+// reorderings of the list, and becomes stale once its subtitle is removed
+class SubtitleHandle
+{
+    static const std::uint32_t InvalidSlot = 0xffffffff;
+
+    std::uint32_t Slot;
+    std::uint32_t Generation;
+
+    SubtitleHandle(std::uint32_t slot, std::uint32_t generation) :
+        Slot(slot),
+        Generation(generation)
+    { }
+
+public:
+    // Create a handle referring to no subtitle
+    SubtitleHandle() :
+        Slot(InvalidSlot),
+        Generation(0)
+    { }
+
+    bool isNull() const
+    {
+        return Slot == InvalidSlot;
+    }
+
+    // Raw values, to save a handle and read it back
+    std::uint32_t slot() const
+    {
+        return Slot;
+    }
+
+    std::uint32_t generation() const
+    {
+        return Generation;
+    }
+
+    static SubtitleHandle fromRaw(std::uint32_t slot, std::uint32_t generation)
+    {
+        return SubtitleHandle(slot, generation);
+    }
+
+    bool operator==(const SubtitleHandle &other) const
+    {
+        return Slot == other.Slot && Generation == other.Generation;
+    }
+
+    bool operator!=(const SubtitleHandle &other) const
+    {
+        return !(*this == other);
+    }
+
+    friend class RangeList;
+};
+
+// Reference to the fields of a subtitle stored in a RangeList.
+// RangeList keeps each field in its own array, so iterators
+// give access to a subtitle through one of these
+template<bool IsConst>
+struct BasicSubtitleRef
+{
+    template<class T>
+    using Field = typename std::conditional<IsConst, const T, T>::type &;
+
+    Field<unsigned int> Number;
+    Field<Range> Time;
+    Field<QString> Text;
+
+    operator SrtSubtitle() const
+    {
+        SrtSubtitle Result;
+        Result.Number = Number;
+        Result.Time = Time;
+        Result.Text = Text;
+        return Result;
+    }
+};
+
+typedef BasicSubtitleRef<false> SubtitleRef;
+typedef BasicSubtitleRef<true> ConstSubtitleRef;
+
+// Iterator over the subtitles of a RangeList, with random access.
+// Dereferencing gives a proxy reference to the fields of a subtitle, not an SrtSubtitle &,
+// so it only claims the input category to the standard algorithms; C++20 ones
+// see the random access concept, which allows proxy references
+template<bool IsConst>
+class RangeListIterator
+{
+public:
+    typedef typename std::conditional<IsConst, const RangeList, RangeList>::type ListType;
+    typedef BasicSubtitleRef<IsConst> reference;
+    typedef SrtSubtitle value_type;
+    typedef int difference_type;
+    typedef std::input_iterator_tag iterator_category;
+    typedef std::random_access_iterator_tag iterator_concept;
+
+    // Makes it->Field work, even if there is no SrtSubtitle to point to
+    class pointer
+    {
+        reference Ref;
+    public:
+        pointer(const reference &ref) :
+            Ref(ref)
+        { }
+
+        reference *operator->()
+        {
+            return &Ref;
+        }
+    };
+
+private:
+    ListType *List;
+    int Index;
+
+public:
+    RangeListIterator() :
+        List(nullptr),
+        Index(0)
+    { }
+
+    RangeListIterator(ListType *list, int index) :
+        List(list),
+        Index(index)
+    { }
+
+    // Allow conversion from iterator to const_iterator
+    template<bool OtherConst, class = typename std::enable_if<IsConst && !OtherConst>::type>
+    RangeListIterator(const RangeListIterator<OtherConst> &other) :
+        List(other.list()),
+        Index(other.index())
+    { }
+
+    ListType *list() const
+    {
+        return List;
+    }
+
+    int index() const
+    {
+        return Index;
+    }
+
+    reference operator*() const
+    {
+        return reference { List->Numbers[Index], List->Times[Index], List->Texts[Index] };
+    }
+
+    pointer operator->() const
+    {
+        return pointer(**this);
+    }
+
+    RangeListIterator &operator++()
+    {
+        ++Index;
+        return *this;
+    }
+
+    RangeListIterator operator++(int)
+    {
+        RangeListIterator Result = *this;
+        ++Index;
+        return Result;
+    }
+
+    RangeListIterator &operator--()
+    {
+        --Index;
+        return *this;
+    }
+
+    RangeListIterator operator--(int)
+    {
+        RangeListIterator Result = *this;
+        --Index;
+        return Result;
+    }
+
+    RangeListIterator &operator+=(int n)
+    {
+        Index += n;
+        return *this;
+    }
+
+    RangeListIterator &operator-=(int n)
+    {
+        Index -= n;
+        return *this;
+    }
+
+    RangeListIterator operator+(int n) const
+    {
+        return RangeListIterator(List, Index + n);
+    }
+
+    RangeListIterator operator-(int n) const
+    {
+        return RangeListIterator(List, Index - n);
+    }
+
+    int operator-(const RangeListIterator &other) const
+    {
+        return Index - other.Index;
+    }
+
+    bool operator==(const RangeListIterator &other) const
+    {
+        return List == other.List && Index == other.Index;
+    }
+
+    bool operator!=(const RangeListIterator &other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator<(const RangeListIterator &other) const
+    {
+        return Index < other.Index;
+    }
+
+    bool operator>(const RangeListIterator &other) const
+    {
+        return Index > other.Index;
+    }
+
+    bool operator<=(const RangeListIterator &other) const
+    {
+        return Index <= other.Index;
+    }
+
+    bool operator>=(const RangeListIterator &other) const
+    {
+        return Index >= other.Index;
+    }
+};
+
+// Iterates, in time order, over the ranges overlapping [PosMs - expandBy, PosMs + expandBy].
+// The lookup walks the interval index of the RangeList, so that
+// finding k ranges costs O(log n + k)
 class RangeLookupIterator
 {
-    int SearchStartAtMs;
-    int ExpandBy;
-    std::vector<SrtSubtitle>::iterator Cur;
-    std::vector<SrtSubtitle>::iterator Begin;
-    std::vector<SrtSubtitle>::iterator End;
-    std::vector<SrtSubtitle>::iterator Result;
+    // Node of the implicit interval tree still to be visited
+    struct Node
+    {
+        int Index;
+        short Level;
+        bool LeftVisited;
+    };
+
+    int QueryStartMs;
+    int QueryEndMs;
+    RangeList *List;
+    int Size;
+    int Result;
+
+    Node Stack[64];
+    int StackSize;
+
+    // Small subtrees are scanned linearly, these are the bounds of the current scan
+    int ScanIndex;
+    int ScanEnd;
 
 public:
-    typedef std::vector<SrtSubtitle>::iterator iterator;
+    typedef RangeListIterator<false> iterator;
 
 private:
     // Create begin iterator
@@ -24,17 +287,22 @@ private:
     // Create end iterator
     RangeLookupIterator(RangeList &RL);
 
+    void push(int index, int level, bool leftVisited)
+    {
+        Stack[StackSize++] = Node { index, short(level), leftVisited };
+    }
+
 public:
     RangeLookupIterator &operator++();
 
-    std::vector<SrtSubtitle>::iterator::reference operator*()
+    iterator::reference operator*() const
     {
-        return *Result;
+        return *iterator(List, Result);
     }
 
-    std::vector<SrtSubtitle>::iterator::pointer operator->()
+    iterator::pointer operator->() const
     {
-        return Result.operator ->();
+        return iterator(List, Result).operator ->();
     }
 
     bool operator==(const RangeLookupIterator &other) const
@@ -47,48 +315,84 @@ public:
         return !(*this == other);
     }
 
-    operator iterator()
+    operator iterator() const
     {
-        return Result;
+        return iterator(List, Result);
     }
 
     friend class RangeList;
 };
 
+// Sorted list of subtitles.
+// Fields are stored in separate arrays, indexed by the position of the subtitle,
+// so that scans over timings don't have to stride over texts
 class RangeList
 {
-    std::vector<SrtSubtitle> Subs;
+    std::vector<Range> Times;
+    std::vector<unsigned int> Numbers;
+    std::vector<QString> Texts;
     bool Editable;
-public:
-    typedef std::vector<SrtSubtitle>::iterator iterator;
-    typedef std::vector<SrtSubtitle>::const_iterator const_iterator;
-    typedef std::vector<SrtSubtitle>::size_type size_type;
 
-    RangeList(std::vector<SrtSubtitle> &&subs, bool editable = true) :
-        Subs(std::move(subs)),
-        Editable(editable)
+    // End times, sorted, used to count ranges overlapping a time span
+    std::vector<int> SortedEnds;
+    long long TotalDurationMs = 0;
+    int AverageDurationMs = 0;
+
+    // Interval index: Times, sorted by start time, seen as an implicit binary tree
+    // where the node i at level k has children i -/+ 2^(k-1).
+    // MaxEnd[i] is the maximum end time in the subtree rooted at i
+    std::vector<int> MaxEnd;
+    int RootLevel = -1;
+
+    // Free time between subtitles, updated together with the interval index
+    GapIndex Gaps;
+
+    // Edits made in batch mode, not yet sorted
+    bool InBatch = false;
+    std::vector<int> DirtyIndices;
+
+    // Slot map giving handles to subtitles:
+    // a slot holds the position of its subtitle,
+    // SlotOf holds the slot of the subtitle at each position
+    struct Slot
     {
-        sortSubs();
-    }
+        int Index; // -1 if the slot is free
+        std::uint32_t Generation; // Incremented each time the slot is freed
+    };
+    std::vector<Slot> Slots;
+    std::vector<std::uint32_t> SlotOf;
+    std::vector<std::uint32_t> FreeSlots;
+
+    unsigned int Revision = 0; // Incremented on every change
+public:
+    typedef RangeListIterator<false> iterator;
+    typedef RangeListIterator<true> const_iterator;
+    typedef std::vector<Range>::size_type size_type;
+
+    RangeList(std::vector<SrtSubtitle> &&subs, bool editable = true);
+
+    // Build from the fields of each subtitle, e.g. loaded from a project file.
+    // If times are already sorted nothing is moved
+    RangeList(std::vector<Range> &&times, std::vector<unsigned int> &&numbers, std::vector<QString> &&texts, bool editable = true);
 
     iterator begin()
     {
-        return Subs.begin();
+        return iterator(this, 0);
     }
 
     const_iterator cbegin() const
     {
-        return Subs.cbegin();
+        return const_iterator(this, 0);
     }
 
     iterator end()
     {
-        return Subs.end();
+        return iterator(this, Times.size());
     }
 
     const_iterator cend() const
     {
-        return Subs.cend();
+        return const_iterator(this, Times.size());
     }
 
     RangeLookupIterator first_at(int PosMs, int expandBy = 0)
@@ -101,23 +405,92 @@ public:
         return RangeLookupIterator(*this);
     }
 
-    const SrtSubtitle &operator[](size_type index) const
+    ConstSubtitleRef operator[](size_type index) const
+    {
+        return *const_iterator(this, index);
+    }
+
+    size_type size() const
+    {
+        return Times.size();
+    }
+
+    // Timings of all the subtitles, in order, for fast scans
+    const std::vector<Range> &times() const
+    {
+        return Times;
+    }
+
+    // Handles --------------------------------------------------
+
+    SubtitleHandle handle(const_iterator sub) const
     {
-        return Subs[index];
+        std::uint32_t SlotIndex = SlotOf[sub.index()];
+        return SubtitleHandle(SlotIndex, Slots[SlotIndex].Generation);
     }
 
-    void addSubtitle(SrtSubtitle &&sub);
+    // Return the subtitle referred by h, or end() if h is null or stale, in O(1)
+    iterator find(SubtitleHandle h)
+    {
+        return contains(h) ? iterator(this, Slots[h.Slot].Index) : end();
+    }
+
+    const_iterator find(SubtitleHandle h) const
+    {
+        return contains(h) ? const_iterator(this, Slots[h.Slot].Index) : cend();
+    }
+
+    bool contains(SubtitleHandle h) const
+    {
+        return h.Slot < Slots.size() && Slots[h.Slot].Generation == h.Generation && Slots[h.Slot].Index >= 0;
+    }
+
+    // Save the handle slots: the slot of each subtitle and the generation of each slot.
+    // Restoring them on a list with the same subtitles, e.g. loaded from a file,
+    // makes the handles to the saved list valid on it
+    void saveSlots(std::vector<std::uint32_t> &slotOf, std::vector<std::uint32_t> &generations) const;
+
+    // Fails, leaving the slots unchanged, if they don't fit the subtitles of the list
+    bool restoreSlots(const std::vector<std::uint32_t> &slotOf, const std::vector<std::uint32_t> &generations);
+    // ----------------------------------------------------------
+
+    // Insert sub at its sorted position
+    SubtitleHandle addSubtitle(SrtSubtitle &&sub);
+
+    // Insert many subtitles at once: they are sorted among themselves
+    // and merged with the list, handles are returned in the same order as subs
+    std::vector<SubtitleHandle> addSubtitles(std::vector<SrtSubtitle> &&subs);
+
+    // Remove the subtitle referred by h, its handle becomes stale
+    void removeSubtitle(SubtitleHandle h);
+
+    // Remove many subtitles at once, in O(n). Null and stale handles are skipped
+    void removeSubtitles(const std::vector<SubtitleHandle> &handles);
+
+    // Insert sub back with the handle it had before being removed,
+    // so that handles to it become valid again.
+    // Slots past the end are created, e.g. when replaying changes made on a copy of the list.
+    // Fails if the slot of h is in use
+    bool restoreSubtitle(SubtitleHandle h, SrtSubtitle &&sub);
+
+    void setText(iterator sub, QString &&text)
+    {
+        Texts[sub.index()] = std::move(text);
+        ++Revision;
+    }
+
+    void setNumber(iterator sub, unsigned int number)
+    {
+        Numbers[sub.index()] = number;
+        ++Revision;
+    }
 
     void addSubtitleAtEnd(SrtSubtitle &&sub);
 
 
     iterator getInsertPos(const Range &R)
     {
-        return std::lower_bound(Subs.begin(), Subs.end(), R, [](const SrtSubtitle &Sub, const Range &r)
-        {
-            return Sub.Time.StartTime < r.StartTime ||
-                    (Sub.Time.StartTime == r.StartTime && Sub.Time.EndTime < r.EndTime);
-        });
+        return iterator(this, std::lower_bound(Times.begin(), Times.end(), R) - Times.begin());
     }
 
     iterator subsAheadOf(int StartPosMs)
@@ -134,36 +507,128 @@ public:
         return Editable;
     }
 
+    // Changes whenever subtitles are edited, added or removed,
+    // so that data derived from the list can tell when it is stale
+    unsigned int revision() const
+    {
+        return Revision;
+    }
+
     void setEditable(bool value)
     {
         Editable = value;
     }
 
-    void sortSubs()
+    void sortSubs();
+
+    // Number of ranges overlapping [StartMs, EndMs], in O(log n)
+    int countOverlapping(int StartMs, int EndMs) const
     {
-        std::sort(Subs.begin(), Subs.end(), [](const SrtSubtitle &s1, const SrtSubtitle &s2)
+        // Ranges starting after EndMs don't overlap,
+        // among the others, the ones not overlapping are those ending before StartMs
+        auto StartedBefore = std::upper_bound(Times.begin(), Times.end(), EndMs, [](int PosMs, const Range &R)
         {
-            if(s1.Time.StartTime < s2.Time.StartTime) return true;
-            else if(s1.Time.StartTime == s2.Time.StartTime) return s1.Time.EndTime < s2.Time.EndTime;
-            else return false;
+            return PosMs < R.StartTime;
         });
+        auto EndedBefore = std::lower_bound(SortedEnds.begin(), SortedEnds.end(), StartMs);
+        return (StartedBefore - Times.begin()) - (EndedBefore - SortedEnds.begin());
+    }
+
+    int averageDuration() const
+    {
+        return AverageDurationMs;
+    }
+
+    // Free time between subtitles, see GapIndex -----------
+
+    // Free span around PosMs, unbounded sides are INT_MIN and INT_MAX.
+    // If its StartTime >= PosMs, PosMs is covered by a subtitle
+    Range gapAt(int PosMs) const
+    {
+        return Gaps.gapAt(PosMs);
+    }
+
+    // First free span at least LengthMs long after PosMs, in O(log^2 n)
+    Range firstGap(int PosMs, int LengthMs) const
+    {
+        return Gaps.firstGap(PosMs, LengthMs);
     }
 
+    // Largest free span in [FromMs, ToMs], in O(log^2 n)
+    Range largestGap(int FromMs, int ToMs) const
+    {
+        return Gaps.largestGap(FromMs, ToMs);
+    }
+    // ------------------------------------------------------
+
+    // Editing ----------------------------------------------
+
+    // Change the timing of sub and move it to its sorted position,
+    // with a binary search and a single rotation.
+    // Returns the new position of sub, iterators are invalidated
+    // but handles are not. In batch mode the subtitle
+    // is not moved until endBatch()
+    iterator setTiming(iterator sub, const Range &newTime);
+
+    // Start a batch of edits: setTiming() only updates the timings,
+    // endBatch() then sorts the edited subtitles and merges them back
+    void beginBatch();
+    void endBatch();
+
+    bool inBatch() const
+    {
+        return InBatch;
+    }
+
+    // Map the timings of the subtitles in [First, Last] through map.
+    // When the transformed subtitles keep their relative order, as they
+    // usually do with monotonic maps, they are only merged back with the others,
+    // or not moved at all if the whole list is transformed. Handles stay valid
+    void transformTimes(const TimeMap &map, int First, int Last);
+
+    void transformTimes(const TimeMap &map)
+    {
+        transformTimes(map, 0, int(Times.size()) - 1);
+    }
+    // ------------------------------------------------------
+
+    // Return the first subtitle containing PosMs, or end() if there is none
     iterator getSubtitleAt(int PosMs)
     {
-        auto it = subsAheadOf(PosMs);
-        auto result = Subs.end();
-        while(it >= Subs.begin())
-        {
-            if(it->Time.StartTime <= PosMs && PosMs <= it->Time.EndTime)
-            {
-                result = it;
-            }
-            --it;
-        }
-        return result;
+        return first_at(PosMs);
     }
 
+
+private:
+    void updateIndexes();
+    void updateEndIndex();
+    void updateIntervalIndex(int First, int Last);
+    int subtreeMaxEnd(int Index, int Level) const;
+
+    std::uint32_t allocateSlot(int Index);
+
+    // Update the slots of the subtitles in [First, Last] after they moved
+    void updateSlots(int First, int Last);
+
+    // Rotate [First, Last) of every field array so that Middle becomes the first
+    void rotate(int First, int Middle, int Last);
+
+    // Sort the subtitles marked in Dirty, unless they are already sorted,
+    // and merge them with the others, which must be sorted
+    void mergeDirty(const std::vector<char> &Dirty, bool DirtySorted = false);
+
+    // Rearrange subtitles so that the subtitle at position Order[i] goes at position i
+    void applyOrder(const std::vector<int> &Order);
+
+    // Append sub without keeping the order, returns its position
+    int append(SrtSubtitle &&sub);
+
+    // Insert sub at its sorted position, in the given slot, returns its position
+    int insertSorted(SrtSubtitle &&sub, std::uint32_t SlotIndex);
+
+    friend class RangeLookupIterator;
+    friend class RangeListIterator<false>;
+    friend class RangeListIterator<true>;
 };
 
 enum MinBlankInfoPart
@@ -176,25 +641,29 @@ enum MinBlankInfoPart
 class MinBlankInfo
 {
     bool Exists;
-    RangeList::iterator R;
+    const RangeList *List;
+    SubtitleHandle R;
     MinBlankInfoPart Part;
 
 public:
 
     MinBlankInfo() :
-        Exists(false)
+        Exists(false),
+        List(nullptr),
+        Part(MinBlankInvalid)
     { }
 
     bool exists() const
     {
-        return Exists;
+        return Exists && List && List->contains(R);
     }
 
-    bool setInfo(RangeList::iterator NewRange, MinBlankInfoPart NewPart)
+    bool setInfo(const RangeList &NewList, SubtitleHandle NewRange, MinBlankInfoPart NewPart)
     {
         bool Res = false;
-        if(R != NewRange)
+        if(List != &NewList || R != NewRange)
         {
+            List = &NewList;
             R = NewRange;
             Res = true;
         }
@@ -0,0 +1,78 @@
+#include "renderscheduler.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWidget>
+
+#include <algorithm>
+#include <cmath>
+
+RenderScheduler::RenderScheduler(QWidget *target) :
+    QObject(target),
+    Target(target)
+{
+    QScreen *Screen = QGuiApplication::primaryScreen();
+    if(Screen && Screen->refreshRate() > 0)
+    {
+        FrameIntervalMs = std::floor(1000.0 / Screen->refreshRate());
+    }
+
+    FrameTimer.setSingleShot(true);
+    FrameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&FrameTimer, SIGNAL(timeout()), this, SLOT(emitFrame()));
+
+    SettleTimer.setSingleShot(true);
+    connect(&SettleTimer, SIGNAL(timeout()), this, SLOT(interactionSettled()));
+}
+
+void RenderScheduler::requestFrame()
+{
+    // A frame is already scheduled, this request is served by it
+    if(FrameTimer.isActive()) return;
+
+    int WaitMs = 0;
+    if(SinceLastFrame.isValid())
+    {
+        WaitMs = std::max<qint64>(0, FrameIntervalMs - SinceLastFrame.elapsed());
+    }
+    FrameTimer.start(WaitMs);
+}
+
+void RenderScheduler::notifyInteraction()
+{
+    CurrentQuality = DraftQuality;
+    SettleTimer.start(SettleTimeMs);
+}
+
+void RenderScheduler::frameStarted()
+{
+    SinceLastFrame.start();
+    FrameClock.start();
+}
+
+void RenderScheduler::frameFinished()
+{
+    LastFrameMs = FrameClock.nsecsElapsed() / 1000000.0;
+    TotalFrameMs += LastFrameMs;
+    MaxFrameMs = std::max(MaxFrameMs, LastFrameMs);
+    ++FrameCount;
+}
+
+void RenderScheduler::resetStatistics()
+{
+    FrameCount = 0;
+    LastFrameMs = 0.0;
+    TotalFrameMs = 0.0;
+    MaxFrameMs = 0.0;
+}
+
+void RenderScheduler::emitFrame()
+{
+    Target->update();
+}
+
+void RenderScheduler::interactionSettled()
+{
+    CurrentQuality = FullQuality;
+    requestFrame();
+}
@@ -0,0 +1,90 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QWidget;
+
+// Coalesces the repaint requests of a widget so that at most one frame
+// per display refresh is drawn, and keeps statistics about frame times.
+// While the user is interacting (scrolling, dragging) frames are drawn
+// at draft quality, full quality is restored once input settles
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Quality
+    {
+        FullQuality,
+        DraftQuality
+    };
+
+    RenderScheduler(QWidget *target);
+
+    // Schedule a repaint of the target, requests made before
+    // the repaint happens are merged into it
+    void requestFrame();
+
+    // Switch to draft quality until no interaction happens for a while
+    void notifyInteraction();
+
+    Quality quality() const
+    {
+        return CurrentQuality;
+    }
+
+    // To be called at the beginning and at the end of the painting of each frame
+    void frameStarted();
+    void frameFinished();
+
+    // Frame time statistics, in milliseconds ------
+    double lastFrameMs() const
+    {
+        return LastFrameMs;
+    }
+
+    double averageFrameMs() const
+    {
+        return FrameCount ? TotalFrameMs / FrameCount : 0.0;
+    }
+
+    double maxFrameMs() const
+    {
+        return MaxFrameMs;
+    }
+
+    unsigned long frameCount() const
+    {
+        return FrameCount;
+    }
+
+    void resetStatistics();
+    // ---------------------------------------------
+
+private slots:
+    void emitFrame();
+    void interactionSettled();
+
+private:
+    QWidget *Target;
+
+    QTimer FrameTimer; // Fires when the next frame can be drawn
+    QTimer SettleTimer; // Fires when the interaction is over
+    QElapsedTimer SinceLastFrame; // Time elapsed since the beginning of the last frame
+    QElapsedTimer FrameClock; // Time elapsed since the beginning of the current frame
+
+    int FrameIntervalMs = 16; // Time between two display refreshes
+    int SettleTimeMs = 150; // Time without interaction after which full quality is restored
+
+    Quality CurrentQuality = FullQuality;
+
+    unsigned long FrameCount = 0;
+    double LastFrameMs = 0.0;
+    double TotalFrameMs = 0.0;
+    double MaxFrameMs = 0.0;
+};
+
+#endif // RENDERSCHEDULER_H
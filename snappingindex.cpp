@@ -0,0 +1,130 @@
+#include "snappingindex.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+// Return whether TimeMs of source is excluded, and not yet skipped.
+// Skipped exclusions are marked in SkippedMask
+static bool skipExcluded(SnappingIndex::SourceId source, int TimeMs, std::initializer_list<SnappingIndex::Exclusion> excluded, unsigned int &SkippedMask)
+{
+    unsigned int Bit = 1;
+    for(const SnappingIndex::Exclusion &E : excluded)
+    {
+        if(!(SkippedMask & Bit) && E.Source == source && E.TimeMs == TimeMs)
+        {
+            SkippedMask |= Bit;
+            return true;
+        }
+        Bit <<= 1;
+    }
+    return false;
+}
+
+std::size_t SnappingIndex::size() const
+{
+    std::size_t Result = 0;
+    for(const Source &S : Sources)
+    {
+        Result += S.Points.size();
+    }
+    return Result;
+}
+
+void SnappingIndex::setPoints(SourceId source, std::vector<int> &&timesMs)
+{
+    std::vector<int> &Points = Sources[source].Points;
+    Points = std::move(timesMs);
+    std::sort(Points.begin(), Points.end());
+}
+
+void SnappingIndex::insertPoint(SourceId source, int timeMs)
+{
+    std::vector<int> &Points = Sources[source].Points;
+    Points.insert(std::upper_bound(Points.begin(), Points.end(), timeMs), timeMs);
+}
+
+void SnappingIndex::removePoint(SourceId source, int timeMs)
+{
+    std::vector<int> &Points = Sources[source].Points;
+    auto it = std::lower_bound(Points.begin(), Points.end(), timeMs);
+    if(it != Points.end() && *it == timeMs)
+    {
+        Points.erase(it);
+    }
+}
+
+void SnappingIndex::movePoint(SourceId source, int oldMs, int newMs)
+{
+    std::vector<int> &Points = Sources[source].Points;
+    auto Old = std::lower_bound(Points.begin(), Points.end(), oldMs);
+    if(Old == Points.end() || *Old != oldMs)
+    {
+        insertPoint(source, newMs);
+        return;
+    }
+
+    if(newMs < oldMs)
+    {
+        auto New = std::lower_bound(Points.begin(), Old, newMs);
+        std::rotate(New, Old, Old + 1);
+        *New = newMs;
+    }
+    else
+    {
+        auto New = std::upper_bound(Old + 1, Points.end(), newMs);
+        std::rotate(Old, Old + 1, New);
+        *(New - 1) = newMs;
+    }
+}
+
+SnappingPoint SnappingIndex::nearest(int posMs, int maxDistanceMs, std::initializer_list<Exclusion> excluded) const
+{
+    SnappingPoint Result { false, 0, SnapSubtitleStart, 0 };
+    int ResultDistance = 0;
+
+    auto consider = [&](const Source &S, int TimeMs)
+    {
+        int Distance = std::abs(TimeMs - posMs);
+        if(!Result.Exists || S.Priority > Result.Priority ||
+                (S.Priority == Result.Priority && Distance < ResultDistance))
+        {
+            Result = SnappingPoint { true, TimeMs, S.Kind, S.Priority };
+            ResultDistance = Distance;
+        }
+    };
+
+    for(SourceId i = 0; i < SourceId(Sources.size()); ++i)
+    {
+        const Source &S = Sources[i];
+        if(!S.Enabled) continue;
+
+        const std::vector<int> &Points = S.Points;
+        auto Pivot = std::lower_bound(Points.begin(), Points.end(), posMs);
+
+        // Points after posMs and points before it can't be equal,
+        // so each side skips its own exclusions
+        unsigned int SkippedMask = 0;
+        for(auto it = Pivot; it != Points.end() && *it - posMs <= maxDistanceMs; ++it)
+        {
+            if(!skipExcluded(i, *it, excluded, SkippedMask))
+            {
+                consider(S, *it);
+                break;
+            }
+        }
+
+        SkippedMask = 0;
+        for(auto it = Pivot; it != Points.begin();)
+        {
+            --it;
+            if(posMs - *it > maxDistanceMs) break;
+            if(!skipExcluded(i, *it, excluded, SkippedMask))
+            {
+                consider(S, *it);
+                break;
+            }
+        }
+    }
+
+    return Result;
+}
@@ -0,0 +1,91 @@
+#ifndef SNAPPINGINDEX_H
+#define SNAPPINGINDEX_H
+
+#include <vector>
+#include <initializer_list>
+#include <cstddef>
+
+// What a snapping point marks
+enum SnappingKind
+{
+    SnapSubtitleStart,
+    SnapSubtitleEnd,
+    SnapMinBlank,
+    SnapSceneChange,
+    SnapSpeechOnset,
+    SnapPlayCursor
+};
+
+struct SnappingPoint
+{
+    bool Exists;
+    int TimeMs;
+    SnappingKind Kind;
+    int Priority;
+};
+
+// Times the cursor can snap to, grouped by source.
+// Each source keeps its points sorted, so that it can be updated
+// on its own, and the nearest point is found in O(s log n), s being
+// the number of sources
+class SnappingIndex
+{
+public:
+    typedef int SourceId;
+
+    // A point to ignore in queries, e.g. the boundary being dragged.
+    // Only one occurrence of TimeMs is ignored
+    struct Exclusion
+    {
+        SourceId Source;
+        int TimeMs;
+    };
+
+private:
+    struct Source
+    {
+        SnappingKind Kind;
+        int Priority;
+        bool Enabled;
+        std::vector<int> Points; // Sorted
+    };
+
+    std::vector<Source> Sources;
+
+public:
+    // Points of sources with higher priority win over nearer ones of lower priority
+    SourceId addSource(SnappingKind kind, int priority)
+    {
+        Sources.push_back(Source { kind, priority, true, std::vector<int>() });
+        return Sources.size() - 1;
+    }
+
+    void setEnabled(SourceId source, bool enabled)
+    {
+        Sources[source].Enabled = enabled;
+    }
+
+    const std::vector<int> &points(SourceId source) const
+    {
+        return Sources[source].Points;
+    }
+
+    // Total number of points
+    std::size_t size() const;
+
+    // Replace all the points of source
+    void setPoints(SourceId source, std::vector<int> &&timesMs);
+
+    void insertPoint(SourceId source, int timeMs);
+    void removePoint(SourceId source, int timeMs);
+
+    // Move a point of source, shifting only the points in between
+    void movePoint(SourceId source, int oldMs, int newMs);
+
+    // Return the point within maxDistanceMs from posMs with the highest priority,
+    // the nearest one among those with the same priority.
+    // At most 32 exclusions are supported
+    SnappingPoint nearest(int posMs, int maxDistanceMs, std::initializer_list<Exclusion> excluded = {}) const;
+};
+
+#endif // SNAPPINGINDEX_H
@@ -0,0 +1,212 @@
+#ifndef ASSPARSER_H
+#define ASSPARSER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+#include "parsedsubtitles.h"
+#include "subtitlelexer.h"
+
+// ASS/SSA reader working on UTF-8 bytes.
+// Dialogue events become subtitles, numbered in file order, with "\N" as line breaks.
+// Override tags, like "{\an8}", are taken out of the text, which is kept whole
+// in the formatting table together with the style and the other fields of the event.
+// The sections before the events, with the styles, are kept in the header
+class AssParser : public SubtitleLexer
+{
+    // Fields of the events, in the order of the Format line
+    int FieldCount = 0;
+    int StartField = -1;
+    int EndField = -1;
+    int StyleField = -1;
+    int TextField = -1;
+
+    struct Field
+    {
+        const char *Begin;
+        const char *End;
+    };
+    std::vector<Field> Fields;
+    QByteArray TextBuffer;
+
+public:
+    // data must stay valid while parsing. A UTF-8 byte order mark is skipped
+    AssParser(const char *data, std::size_t size) :
+        SubtitleLexer(data, size)
+    {
+        // Events without a Format line use the ASS one
+        static const char DefaultFormat[] = "Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text";
+        parseFormat(DefaultFormat, DefaultFormat + sizeof(DefaultFormat) - 1);
+    }
+
+    ParsedSubtitles parse()
+    {
+        ParsedSubtitles Result;
+        Result.Format = SubtitleFormat::Ass;
+        Result.Subs.reserve((End - Pos) / 96);
+
+        const char *HeaderBegin = Pos;
+        const char *HeaderEnd = nullptr;
+        bool InEvents = false;
+        while(nextLine())
+        {
+            if(lineEmpty()) continue;
+            if(*LineBegin == '[')
+            {
+                InEvents = lineStartsWith("[Events]");
+                if(InEvents && !HeaderEnd)
+                {
+                    HeaderEnd = LineBegin;
+                }
+                continue;
+            }
+            if(!InEvents) continue;
+
+            if(lineStartsWith("Format:"))
+            {
+                parseFormat(LineBegin + 7, LineEnd);
+            }
+            else if(lineStartsWith("Dialogue:"))
+            {
+                parseDialogue(skipSpaces(LineBegin + 9, LineEnd), Result);
+            }
+            // Comments and other events aren't shown
+        }
+        if(!HeaderEnd) fail("Expected [Events] section");
+        Result.Header = makeText(HeaderBegin, HeaderEnd);
+        return Result;
+    }
+
+private:
+    static const char *trimEnd(const char *begin, const char *end)
+    {
+        while(end != begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+        return end;
+    }
+
+    static bool fieldIs(const Field &field, const char *name)
+    {
+        const std::size_t Length = std::strlen(name);
+        return std::size_t(field.End - field.Begin) == Length && std::memcmp(field.Begin, name, Length) == 0;
+    }
+
+    void parseFormat(const char *c, const char *end)
+    {
+        FieldCount = 0;
+        StartField = EndField = StyleField = TextField = -1;
+        while(true)
+        {
+            const char *Comma = static_cast<const char *>(std::memchr(c, ',', end - c));
+            const char *FieldEnd = Comma ? Comma : end;
+            Field Name { skipSpaces(c, FieldEnd), trimEnd(c, FieldEnd) };
+            if(fieldIs(Name, "Start")) StartField = FieldCount;
+            else if(fieldIs(Name, "End")) EndField = FieldCount;
+            else if(fieldIs(Name, "Style")) StyleField = FieldCount;
+            else if(fieldIs(Name, "Text")) TextField = FieldCount;
+            ++FieldCount;
+            if(!Comma) break;
+            c = Comma + 1;
+        }
+        // The text can contain commas, so it must be the last field
+        if(StartField < 0 || EndField < 0 || TextField != FieldCount - 1) fail("Invalid event format");
+    }
+
+    int parseTime(const Field &field) const
+    {
+        int Result;
+        const char *c = skipSpaces(field.Begin, field.End);
+        if(!decodeTimestamp(c, field.End, Result) || skipSpaces(c, field.End) != field.End) fail("Expected timestamp");
+        return Result;
+    }
+
+    void parseDialogue(const char *c, ParsedSubtitles &result)
+    {
+        // Every field but the text ends at a comma
+        Fields.clear();
+        for(int i = 0; i < FieldCount - 1; ++i)
+        {
+            const char *Comma = static_cast<const char *>(std::memchr(c, ',', LineEnd - c));
+            if(!Comma) fail("Expected field");
+            Fields.push_back(Field { c, Comma });
+            c = Comma + 1;
+        }
+        Fields.push_back(Field { c, LineEnd });
+
+        SrtSubtitle Sub;
+        Sub.Number = result.Subs.size() + 1;
+        Sub.Time.StartTime = parseTime(Fields[StartField]);
+        Sub.Time.EndTime = parseTime(Fields[EndField]);
+
+        SubtitleFormatting Formatting;
+        Formatting.Index = result.Subs.size();
+        if(StyleField >= 0)
+        {
+            const Field &Style = Fields[StyleField];
+            Formatting.Style = makeText(Style.Begin, Style.End);
+        }
+
+        // The other fields, joined back as they were
+        TextBuffer.clear();
+        for(int i = 0; i < FieldCount - 1; ++i)
+        {
+            if(i == StartField || i == EndField || i == StyleField) continue;
+            if(!TextBuffer.isEmpty()) TextBuffer.append(',');
+            TextBuffer.append(Fields[i].Begin, Fields[i].End - Fields[i].Begin);
+        }
+        Formatting.Settings = QString::fromUtf8(TextBuffer.constData(), TextBuffer.size());
+
+        const Field &Text = Fields[TextField];
+        if(decodeText(Text.Begin, Text.End))
+        {
+            Formatting.RawText = QString::fromUtf8(Text.Begin, Text.End - Text.Begin);
+        }
+        Sub.Text = makeText(TextBuffer.constData(), TextBuffer.constData() + TextBuffer.size());
+
+        result.Formatting.push_back(std::move(Formatting));
+        result.Subs.push_back(std::move(Sub));
+    }
+
+    // Put the text of [c, end) in TextBuffer, with the line breaks and hard spaces
+    // replaced and without override tags. Returns whether there were any tags
+    bool decodeText(const char *c, const char *end)
+    {
+        bool HadTags = false;
+        TextBuffer.clear();
+        while(c != end)
+        {
+            if(*c == '{')
+            {
+                const char *Close = static_cast<const char *>(std::memchr(c, '}', end - c));
+                if(Close)
+                {
+                    HadTags = true;
+                    c = Close + 1;
+                    continue;
+                }
+            }
+            else if(*c == '\\' && c + 1 != end)
+            {
+                if(c[1] == 'N' || c[1] == 'n')
+                {
+                    TextBuffer.append('\n');
+                    c += 2;
+                    continue;
+                }
+                if(c[1] == 'h')
+                {
+                    TextBuffer.append("\xC2\xA0", 2); // No-break space
+                    c += 2;
+                    continue;
+                }
+            }
+            TextBuffer.append(*c++);
+        }
+        return HadTags;
+    }
+};
+
+#endif // ASSPARSER_H
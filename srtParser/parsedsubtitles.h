@@ -0,0 +1,44 @@
+#ifndef PARSEDSUBTITLES_H
+#define PARSEDSUBTITLES_H
+
+#include <QString>
+
+#include <cstddef>
+#include <vector>
+
+#include "srtsubtitle.h"
+
+enum class SubtitleFormat
+{
+    Srt,
+    WebVtt,
+    Ass // ASS and SSA
+};
+
+// Styling and positioning of a subtitle, which SrtSubtitle has no room for
+struct SubtitleFormatting
+{
+    std::size_t Index; // Of the subtitle in ParsedSubtitles::Subs
+    QString Id; // WebVTT cue identifier
+    QString Style; // ASS style name
+    // WebVTT cue settings, e.g. "position:10% align:start",
+    // or the ASS fields other than Start, End, Style and Text, as written
+    QString Settings;
+    QString RawText; // ASS text with its override tags, when they were taken out of the subtitle text
+};
+
+// Subtitles read from a file of any format.
+// Formatting is a side table, sorted by Index, with entries only for the subtitles
+// having some, so that the subtitles themselves stay as compact as SRT ones.
+// Index is a position in the file, which sorting the subtitles changes, e.g. ASS events
+// out of time order: SubtitleData keeps the table by handle instead
+struct ParsedSubtitles
+{
+    SubtitleFormat Format = SubtitleFormat::Srt;
+    std::vector<SrtSubtitle> Subs;
+    std::vector<SubtitleFormatting> Formatting;
+    // WebVTT header, STYLE and REGION blocks, or the ASS sections before the events
+    QString Header;
+};
+
+#endif // PARSEDSUBTITLES_H
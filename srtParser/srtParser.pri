@@ -1 +1,2 @@
-HEADERS += srtParser/srtsubtitle.h srtParser/srtparser.h
+HEADERS += srtParser/srtsubtitle.h srtParser/srtparser.h srtParser/srtbyteparser.h \
+    srtParser/subtitlelexer.h srtParser/parsedsubtitles.h srtParser/vttparser.h srtParser/assparser.h srtParser/subtitlereader.h
@@ -0,0 +1,320 @@
+#ifndef SRTBYTEPARSER_H
+#define SRTBYTEPARSER_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "srtsubtitle.h"
+#include "srtparser.h"
+#include "subtitlelexer.h"
+
+// SRT parser working directly on UTF-8 bytes, e.g. of a memory-mapped file.
+// The text of each subtitle is decoded once, from a single slice of the input.
+// It accepts what SrtParser accepts, plus blank lines between subtitles,
+// and reports the same errors, with their line numbers.
+// Large inputs can be parsed by many threads, with the same results
+class SrtByteParser : public SubtitleLexer
+{
+    // Parser starting at pos, with lineNumber lines before it
+    SrtByteParser(const char *pos, const char *end, int lineNumber) :
+        SubtitleLexer(pos, end, lineNumber)
+    { }
+
+public:
+    // data must stay valid while parsing. A UTF-8 byte order mark is skipped
+    SrtByteParser(const char *data, std::size_t size) :
+        SubtitleLexer(data, size)
+    { }
+
+    // Parse all of file, which must be open for reading.
+    // The file is mapped in memory when possible, read otherwise.
+    // Large files are parsed in parallel
+    static std::vector<SrtSubtitle> parseFile(QFile &file)
+    {
+        return parseFileBytes(file, [](const char *data, std::size_t size)
+        {
+            return SrtByteParser(data, size).parseSubsParallel();
+        });
+    }
+
+    std::vector<SrtSubtitle> parseSubs()
+    {
+        std::vector<SrtSubtitle> Result;
+        // Typical subtitles take 50 to 100 bytes
+        Result.reserve((End - Pos) / 64);
+
+        SrtSubtitle Sub;
+        while(parseSub(Sub))
+        {
+            Result.push_back(std::move(Sub));
+        }
+        return Result;
+    }
+
+    // Parse the rest of the input on up to threadCount threads, one for each hardware thread if 0.
+    // The input is split where subtitles seem to start, each part is parsed on its own,
+    // then the parts are checked against each other: where a part didn't start
+    // at a subtitle, it is parsed again sequentially until it meets the subtitles of
+    // that part. Results and errors are the same as with parseSubs()
+    std::vector<SrtSubtitle> parseSubsParallel(int threadCount = 0);
+
+    // Parse the next subtitle into sub, return false if there are no more
+    bool parseSub(SrtSubtitle &sub)
+    {
+        if(!skipBlankLines()) return false;
+        parseCue(sub);
+        return true;
+    }
+
+private:
+    // Parse a subtitle starting at the current position
+    void parseCue(SrtSubtitle &sub)
+    {
+        nextLine();
+        sub.Number = parseNumber();
+        if(!nextLine()) fail("Expected timing signature");
+        parseTimeSignature(sub.Time.StartTime, sub.Time.EndTime);
+        sub.Text = parseContent();
+    }
+
+    // Subtitles parsed by a thread, from Begin to the first subtitle starting at or after Limit
+    struct Chunk
+    {
+        const char *Begin;
+        const char *Limit;
+        std::vector<SrtSubtitle> Subs;
+        std::vector<const char *> Starts; // Where each subtitle starts, the failed one included
+        const char *Stop = nullptr; // Start of the first subtitle after the chunk, or the end
+        int StopLine = 0; // Lines from Begin to Stop
+        int Lines = 0; // Lines from Begin to Limit
+        const char *Error = nullptr;
+        int ErrorLine = 0; // Counting from Begin
+
+        const char *firstStart() const
+        {
+            return Starts.empty() ? Stop : Starts.front();
+        }
+    };
+
+    static void parseChunk(Chunk &chunk, const char *end)
+    {
+        SrtByteParser Parser(chunk.Begin, end, 0);
+        try
+        {
+            while(Parser.skipBlankLines() && Parser.Pos < chunk.Limit)
+            {
+                chunk.Starts.push_back(Parser.Pos);
+                SrtSubtitle Sub;
+                Parser.parseCue(Sub);
+                chunk.Subs.push_back(std::move(Sub));
+            }
+        }
+        catch(const SrtParseError &Error)
+        {
+            chunk.Error = Error.what();
+            chunk.ErrorLine = Error.line();
+        }
+        chunk.Stop = Parser.Pos;
+        chunk.StopLine = Parser.LineNumber;
+        chunk.Lines = std::count(chunk.Begin, chunk.Limit, '\n');
+    }
+
+    // End of the line starting at c
+    static const char *lineEnd(const char *c, const char *end)
+    {
+        const char *NewLine = static_cast<const char *>(std::memchr(c, '\n', end - c));
+        return NewLine ? NewLine : end;
+    }
+
+    // First line at or after from that looks like the start of a subtitle:
+    // after an empty line, a number and then a timing signature.
+    // It may still be a part of a text, so it is only a guess
+    static const char *findCueStart(const char *from, const char *end)
+    {
+        // Start from the next line
+        const char *c = lineEnd(from, end);
+        bool PreviousBlank = false;
+        while(c != end)
+        {
+            ++c;
+            const char *NumberEnd = lineEnd(c, end);
+            const char *NumberStop = NumberEnd != c && NumberEnd[-1] == '\r' ? NumberEnd - 1 : NumberEnd;
+            const bool Blank = NumberStop == c;
+            if(PreviousBlank && !Blank && NumberEnd != end &&
+                    std::all_of(c, NumberStop, isDigit))
+            {
+                const char *Timing = NumberEnd + 1;
+                const char *TimingEnd = lineEnd(Timing, end);
+                if(TimingEnd - Timing >= 29 && std::memcmp(Timing + 12, " --> ", 5) == 0)
+                {
+                    return c;
+                }
+            }
+            PreviousBlank = Blank;
+            c = NumberEnd;
+        }
+        return end;
+    }
+
+    unsigned int parseNumber()
+    {
+        unsigned int Result = 0;
+        for(const char *c = LineBegin; c != LineEnd; ++c)
+        {
+            unsigned int Digit = static_cast<unsigned char>(*c) - '0';
+            if(Digit > 9) fail("Expected number");
+            Result = Result * 10 + Digit;
+        }
+        return Result;
+    }
+
+    void parseTimeSignature(int &start, int &end)
+    {
+        // The signature has a fixed layout, d stands for a digit
+        static const char Layout[] = "dd:dd:dd,ddd --> dd:dd:dd,ddd";
+        const int LayoutLength = sizeof(Layout) - 1;
+        const int EndOffset = 17;
+
+        const int Length = LineEnd - LineBegin;
+        for(int i = 0; i < LayoutLength; ++i)
+        {
+            const bool IsDigit = Layout[i] == 'd';
+            if(i >= Length) fail(IsDigit ? "Expected digit but could not get it" : "Expected char but could not get it");
+
+            const char c = LineBegin[i];
+            if(IsDigit && !isDigit(c)) fail("Expected digit but could not get it");
+            if(!IsDigit && c != Layout[i]) fail("Expected char but could not get it");
+        }
+        if(Length > LayoutLength) fail("Unexpected chars after time signature");
+
+        // Already checked, so they can't fail
+        const char *StartTime = LineBegin;
+        const char *EndTime = LineBegin + EndOffset;
+        decodeTimestamp(StartTime, LineEnd, start);
+        decodeTimestamp(EndTime, LineEnd, end);
+    }
+
+    // Text lines go up to an empty line, the first line can be empty
+    QString parseContent()
+    {
+        if(!nextLine()) return QString();
+        if(lineEmpty() && !nextLine()) return QString();
+
+        const char *TextBegin = LineBegin;
+        const char *TextEnd = LineBegin;
+        for(; HasLine && !lineEmpty(); nextLine())
+        {
+            TextEnd = LineEnd;
+        }
+        return makeText(TextBegin, TextEnd);
+    }
+
+};
+
+inline std::vector<SrtSubtitle> SrtByteParser::parseSubsParallel(int threadCount)
+{
+    // Parts smaller than this aren't worth a thread
+    const std::ptrdiff_t MinChunkBytes = 256 * 1024;
+
+    if(threadCount <= 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    const std::ptrdiff_t Size = End - Pos;
+    const int ChunkCount = std::min<std::ptrdiff_t>(threadCount, Size / MinChunkBytes);
+    if(ChunkCount < 2)
+    {
+        return parseSubs();
+    }
+
+    std::vector<Chunk> Chunks;
+    Chunks.emplace_back();
+    Chunks.back().Begin = Pos;
+    for(int i = 1; i < ChunkCount; ++i)
+    {
+        const char *Begin = findCueStart(std::max(Pos + Size * i / ChunkCount, Chunks.back().Begin), End);
+        if(Begin == End) break;
+        Chunks.back().Limit = Begin;
+        Chunks.emplace_back();
+        Chunks.back().Begin = Begin;
+    }
+    Chunks.back().Limit = End;
+
+    std::vector<std::thread> Workers;
+    for(std::size_t i = 1; i < Chunks.size(); ++i)
+    {
+        Workers.emplace_back(&SrtByteParser::parseChunk, std::ref(Chunks[i]), End);
+    }
+    parseChunk(Chunks[0], End);
+    for(std::thread &Worker : Workers)
+    {
+        Worker.join();
+    }
+
+    // Join the chunks in order. Where the previous chunk didn't stop where this one started,
+    // parse sequentially until meeting a subtitle this chunk parsed too
+    std::vector<SrtSubtitle> Result;
+    std::size_t Total = 0;
+    for(const Chunk &C : Chunks)
+    {
+        Total += C.Subs.size();
+    }
+    Result.reserve(Total);
+
+    const char *Next = Chunks[0].Begin; // Where the next subtitle starts
+    int NextLine = LineNumber; // Lines before Next
+    int BaseLine = LineNumber; // Lines before the current chunk
+    for(std::size_t k = 0; k < Chunks.size(); ++k)
+    {
+        Chunk &C = Chunks[k];
+        std::size_t First = 0;
+        if(k > 0 && Next != C.firstStart())
+        {
+            SrtByteParser Sequential(Next, End, NextLine);
+            bool Synced = false;
+            while(Sequential.skipBlankLines() && Sequential.Pos < C.Limit)
+            {
+                auto Start = std::lower_bound(C.Starts.begin(), C.Starts.end(), Sequential.Pos);
+                if(Start != C.Starts.end() && *Start == Sequential.Pos)
+                {
+                    First = Start - C.Starts.begin();
+                    Synced = true;
+                    break;
+                }
+                SrtSubtitle Sub;
+                Sequential.parseCue(Sub);
+                Result.push_back(std::move(Sub));
+            }
+
+            if(!Synced)
+            {
+                Next = Sequential.Pos;
+                NextLine = Sequential.LineNumber;
+                BaseLine += C.Lines;
+                continue;
+            }
+        }
+
+        std::move(C.Subs.begin() + First, C.Subs.end(), std::back_inserter(Result));
+        if(C.Error)
+        {
+            throw SrtParseError(C.Error, BaseLine + C.ErrorLine);
+        }
+        Next = C.Stop;
+        NextLine = BaseLine + C.StopLine;
+        BaseLine += C.Lines;
+    }
+
+    Pos = End;
+    LineNumber = NextLine;
+    return Result;
+}
+
+#endif // SRTBYTEPARSER_H
@@ -14,15 +14,23 @@
 class SrtParseError
 {
     const char *What;
+    int Line;
 public:
-    SrtParseError(const char *what) :
-        What(what)
+    SrtParseError(const char *what, int line = 0) :
+        What(what),
+        Line(line)
     { }
 
     const char *what() const
     {
         return What;
     }
+
+    // Line where the error was found, counting from 1, or 0 if unknown
+    int line() const
+    {
+        return Line;
+    }
 };
 
 class SrtParser
@@ -31,10 +39,12 @@ class SrtParser
     QString CurrLine;
     QString::iterator CurrLineChar;
     QString::iterator CurrLineEnd;
+    int LineNumber = 0;
 
     void nextLine()
     {
         CurrLine = InputStream.readLine();
+        ++LineNumber;
         CurrLineChar = CurrLine.begin();
         CurrLineEnd = CurrLine.end();
     }
@@ -81,11 +91,11 @@ private:
         unsigned int Result = 0;
         if(CurrLine.isNull())
         {
-            throw SrtParseError("Expected subtitle number, got nothing");
+            throw SrtParseError("Expected subtitle number, got nothing", LineNumber);
         }
         for(; CurrLineChar != CurrLineEnd; ++CurrLineChar)
         {
-            if(!CurrLineChar->isDigit()) throw SrtParseError("Expected number");
+            if(!CurrLineChar->isDigit()) throw SrtParseError("Expected number", LineNumber);
             else
             {
                 Result *= 10;
@@ -99,12 +109,12 @@ private:
     {
         if(CurrLine.isNull())
         {
-            throw SrtParseError("Expected timing signature");
+            throw SrtParseError("Expected timing signature", LineNumber);
         }
         start = parseTime();
         expect(" --> ");
         end = parseTime();
-        if(moreCharsOnLine()) throw SrtParseError("Unexpected chars after time signature");
+        if(moreCharsOnLine()) throw SrtParseError("Unexpected chars after time signature", LineNumber);
     }
 
     int parseTime()
@@ -125,7 +135,7 @@ private:
         unsigned int result = 0;
         for(int i = 0; i < numDigits; i++)
         {
-           if(!moreCharsOnLine() || !CurrLineChar->isDigit()) throw SrtParseError("Expected digit but could not get it");
+           if(!moreCharsOnLine() || !CurrLineChar->isDigit()) throw SrtParseError("Expected digit but could not get it", LineNumber);
            result *= 10;
            result += CurrLineChar->digitValue();
            advanceOnLine();
@@ -143,7 +153,7 @@ private:
 
     void expect(char ch)
     {
-        if(!moreCharsOnLine() || *CurrLineChar != ch) throw SrtParseError("Expected char but could not get it");
+        if(!moreCharsOnLine() || *CurrLineChar != ch) throw SrtParseError("Expected char but could not get it", LineNumber);
         else advanceOnLine();
     }
 
@@ -0,0 +1,205 @@
+#ifndef SUBTITLELEXER_H
+#define SUBTITLELEXER_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+
+#include <cstring>
+#include <cstddef>
+
+#include "srtparser.h"
+
+// Line scanner over UTF-8 bytes, e.g. of a memory-mapped file, shared by the readers
+// of the subtitle formats. Lines are found with memchr, which scans many bytes at a time,
+// and accept both "\n" and "\r\n" terminators
+class SubtitleLexer
+{
+protected:
+    const char *Pos;
+    const char *End;
+    int LineNumber = 0; // Of the current line, counting from 1
+
+    // Current line, without its line terminator
+    const char *LineBegin = nullptr;
+    const char *LineEnd = nullptr;
+    bool HasLine = false;
+
+    // Lexer starting at pos, with lineNumber lines before it
+    SubtitleLexer(const char *pos, const char *end, int lineNumber) :
+        Pos(pos),
+        End(end),
+        LineNumber(lineNumber)
+    { }
+
+    // data must stay valid while reading. A UTF-8 byte order mark is skipped
+    SubtitleLexer(const char *data, std::size_t size) :
+        Pos(data),
+        End(data + size)
+    {
+        if(size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        {
+            Pos += 3;
+        }
+    }
+
+    bool nextLine()
+    {
+        if(Pos == End)
+        {
+            HasLine = false;
+            LineBegin = LineEnd = End;
+            return false;
+        }
+
+        ++LineNumber;
+        const char *NewLine = static_cast<const char *>(std::memchr(Pos, '\n', End - Pos));
+        LineBegin = Pos;
+        LineEnd = NewLine ? NewLine : End;
+        Pos = NewLine ? NewLine + 1 : End;
+        if(LineEnd != LineBegin && LineEnd[-1] == '\r')
+        {
+            --LineEnd;
+        }
+        HasLine = true;
+        return true;
+    }
+
+    bool lineEmpty() const
+    {
+        return LineBegin == LineEnd;
+    }
+
+    // Whether the current line starts with prefix
+    bool lineStartsWith(const char *prefix) const
+    {
+        const std::size_t Length = std::strlen(prefix);
+        return std::size_t(LineEnd - LineBegin) >= Length && std::memcmp(LineBegin, prefix, Length) == 0;
+    }
+
+    void fail(const char *what) const
+    {
+        throw SrtParseError(what, LineNumber);
+    }
+
+    // Skip empty lines, return false at the end of the input
+    bool skipBlankLines()
+    {
+        while(Pos != End)
+        {
+            const char *c = *Pos == '\r' ? Pos + 1 : Pos;
+            if(c != End && *c != '\n') break;
+            ++LineNumber;
+            Pos = c == End ? End : c + 1;
+        }
+        return Pos != End;
+    }
+
+    static bool isDigit(char c)
+    {
+        return static_cast<unsigned int>(static_cast<unsigned char>(c) - '0') <= 9u;
+    }
+
+    static bool isAsciiSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    static const char *skipSpaces(const char *c, const char *end)
+    {
+        while(c != end && (*c == ' ' || *c == '\t')) ++c;
+        return c;
+    }
+
+    // Decode a timestamp at c, as [hours:]minutes:seconds[.fraction], moving c past it.
+    // The fraction can be separated by '.' or ',', and is read as tenths, hundredths or
+    // thousandths of a second depending on its digits, further digits are ignored.
+    // This covers SRT "00:01:02,500", WebVTT "01:02.500" and ASS "0:01:02.50".
+    // Returns false if there is no timestamp at c
+    static bool decodeTimestamp(const char *&c, const char *end, int &ms)
+    {
+        int Groups[3];
+        int GroupCount = 0;
+        const char *p = c;
+        while(GroupCount < 3)
+        {
+            // Hours can have any number of digits, minutes and seconds at most two
+            const char *GroupBegin = p;
+            int Value = 0;
+            while(p != end && isDigit(*p) && p - GroupBegin < 6)
+            {
+                Value = Value * 10 + (*p++ - '0');
+            }
+            if(p == GroupBegin || (GroupCount > 0 && p - GroupBegin > 2)) return false;
+            Groups[GroupCount++] = Value;
+            if(p == end || *p != ':') break;
+            ++p;
+        }
+        if(GroupCount < 2) return false;
+
+        int Result = GroupCount == 3 ? (Groups[0] * 60 + Groups[1]) * 60 + Groups[2] : Groups[0] * 60 + Groups[1];
+        Result *= 1000;
+        if(p != end && (*p == '.' || *p == ',') && p + 1 != end && isDigit(p[1]))
+        {
+            ++p;
+            int Scale = 100;
+            for(; p != end && isDigit(*p); ++p)
+            {
+                Result += (*p - '0') * Scale;
+                Scale /= 10;
+            }
+        }
+        ms = Result;
+        c = p;
+        return true;
+    }
+
+    // Decode [first, last), with its lines joined by '\n' and trimmed, like SrtParser does
+    static QString makeText(const char *first, const char *last)
+    {
+        while(first != last && isAsciiSpace(*first)) ++first;
+        while(last != first && isAsciiSpace(last[-1])) --last;
+
+        QString Result = QString::fromUtf8(first, last - first);
+        if(std::memchr(first, '\r', last - first))
+        {
+            Result.remove(QLatin1Char('\r'));
+        }
+        // Other Unicode spaces are rare, let QString find them
+        if(!Result.isEmpty() && (Result.at(0).isSpace() || Result.at(Result.size() - 1).isSpace()))
+        {
+            Result = Result.trimmed();
+        }
+        return Result;
+    }
+
+public:
+    // Call parse(data, size) on the bytes of file, which must be open for reading.
+    // The file is mapped in memory when possible, read otherwise
+    template<class Parse>
+    static auto parseFileBytes(QFile &file, Parse parse) -> decltype(parse(nullptr, 0))
+    {
+        const qint64 Size = file.size();
+        if(Size <= 0) return parse("", 0);
+
+        uchar *Data = file.map(0, Size);
+        if(!Data)
+        {
+            QByteArray Bytes = file.readAll();
+            return parse(Bytes.constData(), Bytes.size());
+        }
+
+        struct Unmap
+        {
+            QFile &File;
+            uchar *Data;
+            ~Unmap()
+            {
+                File.unmap(Data);
+            }
+        } Mapping { file, Data };
+        return parse(reinterpret_cast<const char *>(Data), Size);
+    }
+};
+
+#endif // SUBTITLELEXER_H
@@ -0,0 +1,63 @@
+#ifndef SUBTITLEREADER_H
+#define SUBTITLEREADER_H
+
+#include <QFile>
+
+#include <cstring>
+#include <cstddef>
+
+#include "parsedsubtitles.h"
+#include "srtbyteparser.h"
+#include "vttparser.h"
+#include "assparser.h"
+
+// Format of the subtitles in data, from their first bytes
+inline SubtitleFormat detectSubtitleFormat(const char *data, std::size_t size)
+{
+    const char *End = data + size;
+    if(size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    {
+        data += 3;
+    }
+    while(data != End && (*data == ' ' || *data == '\t' || *data == '\r' || *data == '\n'))
+    {
+        ++data;
+    }
+
+    auto startsWith = [data, End](const char *prefix)
+    {
+        const std::size_t Length = std::strlen(prefix);
+        return std::size_t(End - data) >= Length && std::memcmp(data, prefix, Length) == 0;
+    };
+    if(startsWith("WEBVTT")) return SubtitleFormat::WebVtt;
+    // SRT files start with a number, ASS ones with a section
+    if(startsWith("[Script Info]") || startsWith("[V4") || startsWith("[Events]")) return SubtitleFormat::Ass;
+    return SubtitleFormat::Srt;
+}
+
+// Parse subtitles of any format, detected from data
+inline ParsedSubtitles parseSubtitles(const char *data, std::size_t size)
+{
+    switch(detectSubtitleFormat(data, size))
+    {
+    case SubtitleFormat::WebVtt:
+        return VttParser(data, size).parse();
+    case SubtitleFormat::Ass:
+        return AssParser(data, size).parse();
+    case SubtitleFormat::Srt:
+        break;
+    }
+
+    ParsedSubtitles Result;
+    Result.Subs = SrtByteParser(data, size).parseSubsParallel();
+    return Result;
+}
+
+// Parse all of file, which must be open for reading, in any format.
+// The file is mapped in memory when possible, read otherwise
+inline ParsedSubtitles parseSubtitleFile(QFile &file)
+{
+    return SubtitleLexer::parseFileBytes(file, parseSubtitles);
+}
+
+#endif // SUBTITLEREADER_H
@@ -0,0 +1,140 @@
+#ifndef VTTPARSER_H
+#define VTTPARSER_H
+
+#include <QString>
+
+#include <cstring>
+#include <cstddef>
+
+#include "parsedsubtitles.h"
+#include "subtitlelexer.h"
+
+// WebVTT reader working on UTF-8 bytes.
+// Cue text keeps its markup, like SRT text does, while cue identifiers and settings
+// go to the formatting table. NOTE blocks are skipped, STYLE and REGION blocks are
+// kept in the header. Subtitles are numbered in file order
+class VttParser : public SubtitleLexer
+{
+public:
+    // data must stay valid while parsing. A UTF-8 byte order mark is skipped
+    VttParser(const char *data, std::size_t size) :
+        SubtitleLexer(data, size)
+    { }
+
+    ParsedSubtitles parse()
+    {
+        ParsedSubtitles Result;
+        Result.Format = SubtitleFormat::WebVtt;
+        Result.Subs.reserve((End - Pos) / 64);
+
+        // "WEBVTT", optionally followed by a space or a tab and a title
+        if(!nextLine() || !lineStartsWith("WEBVTT") ||
+                (LineEnd - LineBegin > 6 && LineBegin[6] != ' ' && LineBegin[6] != '\t'))
+        {
+            fail("Expected WEBVTT header");
+        }
+        const char *HeaderBegin = LineBegin;
+        while(nextLine() && !lineEmpty()) { }
+        Result.Header = makeText(HeaderBegin, LineBegin);
+
+        while(skipBlankLines())
+        {
+            nextLine();
+            parseBlock(Result);
+        }
+        return Result;
+    }
+
+private:
+    // Whether the current line is the keyword starting a block of the given kind
+    bool isBlockStart(const char *keyword) const
+    {
+        const std::size_t Length = std::strlen(keyword);
+        return lineStartsWith(keyword) && (std::size_t(LineEnd - LineBegin) == Length ||
+                                           LineBegin[Length] == ' ' || LineBegin[Length] == '\t');
+    }
+
+    bool lineHasArrow() const
+    {
+        for(const char *c = LineBegin; LineEnd - c >= 3; ++c)
+        {
+            c = static_cast<const char *>(std::memchr(c, '-', LineEnd - c - 2));
+            if(!c) return false;
+            if(c[1] == '-' && c[2] == '>') return true;
+        }
+        return false;
+    }
+
+    // Skip to the end of the block, return its end
+    const char *skipBlock()
+    {
+        const char *BlockEnd = LineEnd;
+        while(nextLine() && !lineEmpty())
+        {
+            BlockEnd = LineEnd;
+        }
+        return BlockEnd;
+    }
+
+    void parseBlock(ParsedSubtitles &result)
+    {
+        if(!lineHasArrow())
+        {
+            if(isBlockStart("NOTE"))
+            {
+                skipBlock();
+                return;
+            }
+            if(isBlockStart("STYLE") || isBlockStart("REGION"))
+            {
+                const char *BlockBegin = LineBegin;
+                result.Header += "\n\n" + makeText(BlockBegin, skipBlock());
+                return;
+            }
+        }
+
+        SubtitleFormatting Formatting;
+        Formatting.Index = result.Subs.size();
+
+        // A cue may start with an identifier line
+        if(!lineHasArrow())
+        {
+            Formatting.Id = makeText(LineBegin, LineEnd);
+            if(!nextLine() || lineEmpty()) fail("Expected timing signature");
+        }
+
+        SrtSubtitle Sub;
+        Sub.Number = result.Subs.size() + 1;
+
+        const char *c = LineBegin;
+        if(!decodeTimestamp(c, LineEnd, Sub.Time.StartTime) || (c != LineEnd && *c != ' ' && *c != '\t' && *c != '-'))
+        {
+            fail("Expected timestamp");
+        }
+        c = skipSpaces(c, LineEnd);
+        if(LineEnd - c < 3 || std::memcmp(c, "-->", 3) != 0) fail("Expected char but could not get it");
+        c = skipSpaces(c + 3, LineEnd);
+        if(!decodeTimestamp(c, LineEnd, Sub.Time.EndTime) || (c != LineEnd && *c != ' ' && *c != '\t'))
+        {
+            fail("Expected timestamp");
+        }
+        Formatting.Settings = makeText(c, LineEnd);
+
+        // The payload goes up to an empty line
+        const char *TextBegin = Pos;
+        const char *TextEnd = Pos;
+        while(nextLine() && !lineEmpty())
+        {
+            TextEnd = LineEnd;
+        }
+        Sub.Text = makeText(TextBegin, TextEnd);
+
+        if(!Formatting.Id.isEmpty() || !Formatting.Settings.isEmpty())
+        {
+            result.Formatting.push_back(std::move(Formatting));
+        }
+        result.Subs.push_back(std::move(Sub));
+    }
+};
+
+#endif // VTTPARSER_H
@@ -0,0 +1,150 @@
+#include "srtwriter.h"
+
+#include <QSaveFile>
+
+#include <algorithm>
+
+SrtSnapshot::SrtSnapshot(const RangeList &RL)
+{
+    Numbers.reserve(RL.size());
+    Times.reserve(RL.size());
+    Texts.reserve(RL.size());
+    for(auto Sub = RL.cbegin(); Sub != RL.cend(); ++Sub)
+    {
+        Numbers.push_back(Sub->Number);
+        Times.push_back(Sub->Time);
+        Texts.push_back(Sub->Text);
+    }
+}
+
+// Longest cue without its text: a 10 digit number, the timing line with
+// hours up to 10 digits, and the newlines
+static const int MaxCueOverhead = 10 + 1 + 2 * 19 + 5 + 1 + 2;
+
+static char *writeNumber(char *out, unsigned int value)
+{
+    char Digits[10];
+    int Count = 0;
+    do
+    {
+        Digits[Count++] = '0' + value % 10;
+        value /= 10;
+    }
+    while(value != 0);
+
+    while(Count > 0)
+    {
+        *out++ = Digits[--Count];
+    }
+    return out;
+}
+
+static char *writeDigits(char *out, unsigned int value, int count)
+{
+    for(int i = count - 1; i >= 0; --i)
+    {
+        out[i] = '0' + value % 10;
+        value /= 10;
+    }
+    return out + count;
+}
+
+// hh:mm:ss,mmm, with more digits if the hours don't fit in two
+static char *writeTime(char *out, int ms)
+{
+    unsigned int Time = std::max(ms, 0);
+    unsigned int Hours = Time / 3600000;
+    out = Hours < 100 ? writeDigits(out, Hours, 2) : writeNumber(out, Hours);
+    *out++ = ':';
+    out = writeDigits(out, Time / 60000 % 60, 2);
+    *out++ = ':';
+    out = writeDigits(out, Time / 1000 % 60, 2);
+    *out++ = ',';
+    return writeDigits(out, Time % 1000, 3);
+}
+
+// Encode UTF-16 text as UTF-8, at most 3 bytes for each code unit.
+// Unpaired surrogates become U+FFFD, like QString::toUtf8()
+static char *writeUtf8(char *out, const QString &text)
+{
+    const ushort *Chars = reinterpret_cast<const ushort *>(text.constData());
+    const int Size = text.size();
+    for(int i = 0; i < Size; ++i)
+    {
+        unsigned int C = Chars[i];
+        if(C < 0x80)
+        {
+            *out++ = char(C);
+            continue;
+        }
+        if(C < 0x800)
+        {
+            *out++ = char(0xC0 | (C >> 6));
+            *out++ = char(0x80 | (C & 0x3F));
+            continue;
+        }
+        if(C >= 0xD800 && C < 0xE000)
+        {
+            if(C < 0xDC00 && i + 1 < Size && Chars[i + 1] >= 0xDC00 && Chars[i + 1] < 0xE000)
+            {
+                C = 0x10000 + ((C - 0xD800) << 10) + (Chars[++i] - 0xDC00);
+                *out++ = char(0xF0 | (C >> 18));
+                *out++ = char(0x80 | ((C >> 12) & 0x3F));
+                *out++ = char(0x80 | ((C >> 6) & 0x3F));
+                *out++ = char(0x80 | (C & 0x3F));
+                continue;
+            }
+            C = 0xFFFD;
+        }
+        *out++ = char(0xE0 | (C >> 12));
+        *out++ = char(0x80 | ((C >> 6) & 0x3F));
+        *out++ = char(0x80 | (C & 0x3F));
+    }
+    return out;
+}
+
+QByteArray serializeSrt(const SrtSnapshot &snapshot)
+{
+    const std::size_t Count = snapshot.Times.size();
+
+    // Allocate once for the worst case, then cut to the written size
+    qint64 Capacity = 0;
+    for(const QString &Text : snapshot.Texts)
+    {
+        Capacity += MaxCueOverhead + 3 * qint64(Text.size());
+    }
+
+    QByteArray Result;
+    Result.resize(int(Capacity));
+    char *Begin = Result.data();
+    char *Out = Begin;
+    for(std::size_t i = 0; i < Count; ++i)
+    {
+        Out = writeNumber(Out, snapshot.Numbers[i]);
+        *Out++ = '\n';
+        Out = writeTime(Out, snapshot.Times[i].StartTime);
+        std::copy_n(" --> ", 5, Out);
+        Out += 5;
+        Out = writeTime(Out, snapshot.Times[i].EndTime);
+        *Out++ = '\n';
+        Out = writeUtf8(Out, snapshot.Texts[i]);
+        *Out++ = '\n';
+        *Out++ = '\n';
+    }
+    Result.resize(int(Out - Begin));
+    return Result;
+}
+
+bool writeFileAtomically(const QString &path, const QByteArray &data, QString *error)
+{
+    QSaveFile File(path);
+    // Unbuffered, so that the data goes to the file in one write
+    bool Ok = File.open(QIODevice::WriteOnly | QIODevice::Unbuffered)
+            && File.write(data) == data.size()
+            && File.commit();
+    if(!Ok && error)
+    {
+        *error = File.errorString();
+    }
+    return Ok;
+}
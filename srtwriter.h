@@ -0,0 +1,90 @@
+#ifndef SRTWRITER_H
+#define SRTWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QString>
+#include <QThread>
+
+#include <vector>
+
+#include "rangelist.h"
+
+// Copy of the subtitles of a RangeList, to save them while the list keeps changing.
+// Texts are implicitly shared, so taking one only copies pointers
+struct SrtSnapshot
+{
+    std::vector<unsigned int> Numbers;
+    std::vector<Range> Times;
+    std::vector<QString> Texts;
+
+    explicit SrtSnapshot(const RangeList &RL);
+};
+
+// Whole file in SRT format, encoded as UTF-8 in a single buffer
+QByteArray serializeSrt(const SrtSnapshot &snapshot);
+
+// Write data to path with a single write to a temporary file,
+// which then replaces path, so that path is never left half written
+bool writeFileAtomically(const QString &path, const QByteArray &data, QString *error = nullptr);
+
+// Saves a snapshot in background
+class SrtSaver : public QThread
+{
+    Q_OBJECT
+
+public:
+    SrtSaver(SrtSnapshot &&snapshot, const QString &path, QObject *parent = nullptr) :
+        QThread(parent),
+        Snapshot(std::move(snapshot)),
+        Path(path)
+    { }
+
+    virtual void run() override
+    {
+        Succeeded = writeFileAtomically(Path, serializeSrt(Snapshot), &Error);
+        if(Succeeded)
+        {
+            // Right after writing, so that later changes by other programs can be told from ours
+            const QFileInfo Info(Path);
+            WrittenSize = Info.size();
+            WrittenTime = Info.lastModified();
+        }
+        emit saved(Succeeded);
+    }
+
+    bool succeeded() const
+    {
+        return Succeeded;
+    }
+
+    const QString &errorString() const
+    {
+        return Error;
+    }
+
+    // Size and modification time of the file as written, if it succeeded
+    qint64 writtenSize() const
+    {
+        return WrittenSize;
+    }
+
+    const QDateTime &writtenTime() const
+    {
+        return WrittenTime;
+    }
+
+Q_SIGNALS:
+    void saved(bool succeeded);
+
+private:
+    const SrtSnapshot Snapshot;
+    const QString Path;
+    bool Succeeded = false;
+    QString Error;
+    qint64 WrittenSize = -1;
+    QDateTime WrittenTime;
+};
+
+#endif // SRTWRITER_H
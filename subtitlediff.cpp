@@ -0,0 +1,256 @@
+#include "subtitlediff.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+// FNV-1a over the UTF-16 code units of text
+static std::uint64_t textHash(const QString &text)
+{
+    std::uint64_t Hash = 14695981039346656037ULL;
+    const ushort *Chars = text.utf16();
+    for(int i = 0; i < text.size(); ++i)
+    {
+        Hash = (Hash ^ Chars[i]) * 1099511628211ULL;
+    }
+    return Hash;
+}
+
+static std::uint64_t timeHash(const Range &time)
+{
+    std::uint64_t Hash = (std::uint64_t(std::uint32_t(time.StartTime)) << 32) | std::uint32_t(time.EndTime);
+    // Mix the bits, so that the hash can be combined with others
+    Hash ^= Hash >> 33;
+    Hash *= 0xff51afd7ed558ccdULL;
+    Hash ^= Hash >> 33;
+    return Hash;
+}
+
+namespace
+{
+
+// Pairs the subtitles left unmatched in the old and in the new list, pass after pass
+class SubtitleMatcher
+{
+    const RangeList &Old;
+    const std::vector<SrtSubtitle> &New;
+
+public:
+    // Unmatched subtitles, by index, in time order
+    std::vector<int> OldLeft;
+    std::vector<int> NewLeft;
+    // Hashes of the texts, by index, only for the subtitles that were unmatched at first
+    std::vector<std::uint64_t> OldTextHashes;
+    std::vector<std::uint64_t> NewTextHashes;
+
+    std::vector<std::pair<int, int>> Pairs; // Matched old and new indices
+
+    SubtitleMatcher(const RangeList &old, const std::vector<SrtSubtitle> &updated) :
+        Old(old),
+        New(updated)
+    { }
+
+    // Pair subtitles with the same key, in order, if equal() confirms it
+    template<class Key, class Equal>
+    void matchKeys(Key key, Equal equal)
+    {
+        std::vector<std::pair<std::uint64_t, int>> OldKeys, NewKeys;
+        OldKeys.reserve(OldLeft.size());
+        NewKeys.reserve(NewLeft.size());
+        for(std::size_t i = 0; i < OldLeft.size(); ++i)
+        {
+            OldKeys.emplace_back(key(Old[OldLeft[i]].Time, OldTextHashes[OldLeft[i]]), OldLeft[i]);
+        }
+        for(std::size_t i = 0; i < NewLeft.size(); ++i)
+        {
+            NewKeys.emplace_back(key(New[NewLeft[i]].Time, NewTextHashes[NewLeft[i]]), NewLeft[i]);
+        }
+        std::sort(OldKeys.begin(), OldKeys.end());
+        std::sort(NewKeys.begin(), NewKeys.end());
+
+        std::vector<char> OldMatched(Old.size(), false);
+        std::vector<char> NewMatched(New.size(), false);
+        std::size_t i = 0, j = 0;
+        while(i < OldKeys.size() && j < NewKeys.size())
+        {
+            if(OldKeys[i].first < NewKeys[j].first)
+            {
+                ++i;
+            }
+            else if(NewKeys[j].first < OldKeys[i].first)
+            {
+                ++j;
+            }
+            else
+            {
+                const int OldIndex = OldKeys[i].second;
+                const int NewIndex = NewKeys[j].second;
+                // Different subtitles with the same hash are rare, they are left for the next passes
+                if(equal(Old[OldIndex], New[NewIndex]))
+                {
+                    Pairs.emplace_back(OldIndex, NewIndex);
+                    OldMatched[OldIndex] = true;
+                    NewMatched[NewIndex] = true;
+                    ++i;
+                }
+                ++j;
+            }
+        }
+
+        removeMatched(OldLeft, OldMatched);
+        removeMatched(NewLeft, NewMatched);
+    }
+
+    // Pair subtitles whose timings overlap, walking both lists in time order
+    void matchOverlapping()
+    {
+        std::size_t i = 0, j = 0;
+        while(i < OldLeft.size() && j < NewLeft.size())
+        {
+            const Range &OldTime = Old[OldLeft[i]].Time;
+            const Range &NewTime = New[NewLeft[j]].Time;
+            if(OldTime.StartTime < NewTime.EndTime && NewTime.StartTime < OldTime.EndTime)
+            {
+                Pairs.emplace_back(OldLeft[i++], NewLeft[j++]);
+            }
+            else if(OldTime.EndTime <= NewTime.StartTime)
+            {
+                ++i;
+            }
+            else
+            {
+                ++j;
+            }
+        }
+
+        std::vector<char> OldMatched(Old.size(), false);
+        std::vector<char> NewMatched(New.size(), false);
+        for(const std::pair<int, int> &Pair : Pairs)
+        {
+            OldMatched[Pair.first] = true;
+            NewMatched[Pair.second] = true;
+        }
+        removeMatched(OldLeft, OldMatched);
+        removeMatched(NewLeft, NewMatched);
+    }
+
+private:
+    static void removeMatched(std::vector<int> &left, const std::vector<char> &matched)
+    {
+        left.erase(std::remove_if(left.begin(), left.end(), [&matched](int Index)
+        {
+            return matched[Index];
+        }), left.end());
+    }
+};
+
+}
+
+template<class Sub>
+static bool sameSubtitle(ConstSubtitleRef a, const Sub &b)
+{
+    return a.Time == b.Time && a.Number == b.Number && a.Text == b.Text;
+}
+
+SubtitleDiff diffSubtitles(const RangeList &current, std::vector<SrtSubtitle> &&updated)
+{
+    SubtitleDiff Result;
+    if(!std::is_sorted(updated.begin(), updated.end(), [](const SrtSubtitle &a, const SrtSubtitle &b) { return a.Time < b.Time; }))
+    {
+        std::stable_sort(updated.begin(), updated.end(), [](const SrtSubtitle &a, const SrtSubtitle &b)
+        {
+            return a.Time < b.Time;
+        });
+    }
+
+    const int OldCount = current.size();
+    const int NewCount = updated.size();
+
+    // Most reloads change a few subtitles, skip the equal ones around them
+    int Prefix = 0;
+    while(Prefix < OldCount && Prefix < NewCount && sameSubtitle(current[Prefix], updated[Prefix]))
+    {
+        ++Prefix;
+    }
+    int Suffix = 0;
+    while(Suffix < OldCount - Prefix && Suffix < NewCount - Prefix &&
+          sameSubtitle(current[OldCount - 1 - Suffix], updated[NewCount - 1 - Suffix]))
+    {
+        ++Suffix;
+    }
+    if(Prefix + Suffix == OldCount && Prefix + Suffix == NewCount)
+    {
+        return Result;
+    }
+
+    SubtitleMatcher Matcher(current, updated);
+    Matcher.OldTextHashes.resize(OldCount);
+    Matcher.NewTextHashes.resize(NewCount);
+    for(int i = Prefix; i < OldCount - Suffix; ++i)
+    {
+        Matcher.OldLeft.push_back(i);
+        Matcher.OldTextHashes[i] = textHash(current[i].Text);
+    }
+    for(int i = Prefix; i < NewCount - Suffix; ++i)
+    {
+        Matcher.NewLeft.push_back(i);
+        Matcher.NewTextHashes[i] = textHash(updated[i].Text);
+    }
+
+    // Unchanged, or renumbered
+    Matcher.matchKeys([](const Range &Time, std::uint64_t TextHash)
+    {
+        return timeHash(Time) ^ TextHash;
+    }, [](ConstSubtitleRef a, const SrtSubtitle &b)
+    {
+        return a.Time == b.Time && a.Text == b.Text;
+    });
+    // Moved
+    Matcher.matchKeys([](const Range &, std::uint64_t TextHash)
+    {
+        return TextHash;
+    }, [](ConstSubtitleRef a, const SrtSubtitle &b)
+    {
+        return a.Text == b.Text;
+    });
+    // Text changed
+    Matcher.matchKeys([](const Range &Time, std::uint64_t)
+    {
+        return timeHash(Time);
+    }, [](ConstSubtitleRef a, const SrtSubtitle &b)
+    {
+        return a.Time == b.Time;
+    });
+    // Both changed, but still in the same place
+    Matcher.matchOverlapping();
+
+    std::sort(Matcher.Pairs.begin(), Matcher.Pairs.end());
+    for(const std::pair<int, int> &Pair : Matcher.Pairs)
+    {
+        ConstSubtitleRef Sub = current[Pair.first];
+        SrtSubtitle &Updated = updated[Pair.second];
+        const SubtitleHandle Handle = current.handle(current.cbegin() + Pair.first);
+        if(Sub.Time != Updated.Time)
+        {
+            Result.Changes.push_back(EditDelta { EditDelta::Timing, Handle, 0, Sub.Time, Updated.Time, QString(), QString(), 0 });
+        }
+        if(Sub.Text != Updated.Text)
+        {
+            Result.Changes.push_back(EditDelta { EditDelta::Text, Handle, 0, Updated.Time, Updated.Time, Sub.Text, std::move(Updated.Text), 0 });
+        }
+        if(Sub.Number != Updated.Number)
+        {
+            Result.Changes.push_back(EditDelta { EditDelta::Renumber, Handle, Updated.Number, Range(), Range(), QString(), QString(), Sub.Number });
+        }
+    }
+
+    for(int Index : Matcher.OldLeft)
+    {
+        Result.Removed.push_back(current.handle(current.cbegin() + Index));
+    }
+    for(int Index : Matcher.NewLeft)
+    {
+        Result.Added.push_back(std::move(updated[Index]));
+    }
+    return Result;
+}
@@ -0,0 +1,30 @@
+#ifndef SUBTITLEDIFF_H
+#define SUBTITLEDIFF_H
+
+#include <vector>
+
+#include "editjournal.h"
+#include "rangelist.h"
+
+// Changes turning the subtitles of a RangeList into a newer version of them,
+// e.g. read again from their file after another program changed it
+struct SubtitleDiff
+{
+    std::vector<EditDelta> Changes; // Timing, Text and Renumber deltas of the subtitles kept
+    std::vector<SubtitleHandle> Removed;
+    std::vector<SrtSubtitle> Added;
+
+    bool empty() const
+    {
+        return Changes.empty() && Removed.empty() && Added.empty();
+    }
+};
+
+// Match the subtitles of current with updated, in any order, and return the differences.
+// Subtitles equal at the start and at the end are skipped, the others are matched
+// by hashes of timing and text together, then of text only, then of timing only,
+// and the ones left by overlapping timings. A matched subtitle keeps its handle,
+// the others are removed and added. Runs in O(n) plus O(k log k) for k changed subtitles
+SubtitleDiff diffSubtitles(const RangeList &current, std::vector<SrtSubtitle> &&updated);
+
+#endif // SUBTITLEDIFF_H
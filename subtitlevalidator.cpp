@@ -0,0 +1,141 @@
+#include "subtitlevalidator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+void SubtitleValidator::revalidate(RangeList &RL)
+{
+    States.clear();
+    Violating.clear();
+
+    // Ranges are sorted by start time, so a range overlaps an earlier one
+    // if it starts before the maximum end so far, and a later one
+    // if the next range starts before its end
+    const std::vector<Range> &Times = RL.times();
+    const int Size = Times.size();
+    int MaxEndMs = std::numeric_limits<int>::min();
+    for(int i = 0; i < Size; ++i)
+    {
+        bool Overlaps = Times[i].StartTime <= MaxEndMs || (i + 1 < Size && Times[i + 1].StartTime <= Times[i].EndTime);
+        MaxEndMs = std::max(MaxEndMs, Times[i].EndTime);
+
+        RangeList::const_iterator Sub = RL.cbegin() + i;
+        setState(RL.handle(Sub), check(RL, Sub, Overlaps), Times[i]);
+    }
+}
+
+void SubtitleValidator::timingChanged(RangeList &RL, SubtitleHandle sub, const Range &oldTime)
+{
+    updateAround(RL, oldTime);
+    updateAround(RL, RL.find(sub)->Time);
+}
+
+void SubtitleValidator::textChanged(RangeList &RL, SubtitleHandle sub)
+{
+    update(RL, RL.find(sub));
+}
+
+void SubtitleValidator::subtitleInserted(RangeList &RL, SubtitleHandle sub)
+{
+    updateAround(RL, RL.find(sub)->Time);
+}
+
+void SubtitleValidator::subtitleRemoved(RangeList &RL, SubtitleHandle sub, const Range &oldTime)
+{
+    // The slot may already belong to another subtitle
+    if(!RL.contains(sub) && sub.slot() < States.size() && States[sub.slot()].Sub == sub)
+    {
+        setState(sub, 0, oldTime);
+    }
+    updateAround(RL, oldTime);
+}
+
+SubtitleHandle SubtitleValidator::next(int PosMs) const
+{
+    auto it = Violating.upper_bound(Key { Range { PosMs, std::numeric_limits<int>::max() }, std::numeric_limits<std::uint32_t>::max() });
+    return it == Violating.end() ? SubtitleHandle() : States[it->Slot].Sub;
+}
+
+SubtitleHandle SubtitleValidator::previous(int PosMs) const
+{
+    auto it = Violating.lower_bound(Key { Range { PosMs, std::numeric_limits<int>::min() }, 0 });
+    return it == Violating.begin() ? SubtitleHandle() : States[std::prev(it)->Slot].Sub;
+}
+
+unsigned char SubtitleValidator::check(const RangeList &RL, RangeList::const_iterator sub, bool Overlaps) const
+{
+    const Range &Time = sub->Time;
+    unsigned char Flags = Overlaps ? ViolationOverlap : 0;
+
+    auto Next = sub + 1;
+    if(Next != RL.cend() && Next->Time.StartTime > Time.EndTime && Next->Time.StartTime < Time.EndTime + Rules.MinimumBlankMs)
+    {
+        Flags |= ViolationMinBlank;
+    }
+
+    if(Time.duration() < Rules.MinimumDurationMs)
+    {
+        Flags |= ViolationTooShort;
+    }
+
+    int Chars = 0;
+    for(QChar c : sub->Text)
+    {
+        if(c != QLatin1Char('\n')) ++Chars;
+    }
+    if(Chars > 0 && (Time.duration() <= 0 || Chars * 1000.0 / Time.duration() > Rules.MaxCharsPerSecond))
+    {
+        Flags |= ViolationReadingSpeed;
+    }
+
+    return Flags;
+}
+
+void SubtitleValidator::update(const RangeList &RL, RangeList::const_iterator sub)
+{
+    const Range &Time = sub->Time;
+    // The range itself is counted too
+    bool Overlaps = RL.countOverlapping(Time.StartTime, Time.EndTime) > 1;
+    setState(RL.handle(sub), check(RL, sub, Overlaps), Time);
+}
+
+void SubtitleValidator::setState(SubtitleHandle Sub, unsigned char Flags, const Range &Time)
+{
+    const std::uint32_t Slot = Sub.slot();
+    if(Slot >= States.size())
+    {
+        States.resize(Slot + 1, SlotState { SubtitleHandle(), 0, Range { 0, 0 } });
+    }
+
+    SlotState &State = States[Slot];
+    if(State.Flags)
+    {
+        Violating.erase(Key { State.Time, Slot });
+    }
+    State = SlotState { Sub, Flags, Time };
+    if(Flags)
+    {
+        Violating.insert(Key { Time, Slot });
+    }
+}
+
+void SubtitleValidator::updateAround(RangeList &RL, const Range &Time)
+{
+    // Subtitles overlapping Time may have started, or stopped, overlapping
+    const int HalfSpanMs = std::max(0, Time.duration()) / 2 + 1;
+    for(auto it = RL.first_at(Time.StartTime + HalfSpanMs - 1, HalfSpanMs); it != RL.end_search(); ++it)
+    {
+        update(RL, RangeList::iterator(it));
+    }
+
+    // The subtitle before Time may have a different next one
+    RangeList::iterator Pos = RL.getInsertPos(Time);
+    for(RangeList::iterator it = Pos - 1; it <= Pos + 1; ++it)
+    {
+        if(it >= RL.begin() && it < RL.end())
+        {
+            update(RL, it);
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef SUBTITLEVALIDATOR_H
+#define SUBTITLEVALIDATOR_H
+
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "rangelist.h"
+
+// Problems a subtitle can have, as bit flags
+enum ViolationFlag : unsigned char
+{
+    ViolationOverlap = 1, // Overlaps another subtitle
+    ViolationMinBlank = 2, // The blank before the next subtitle is too short
+    ViolationTooShort = 4,
+    ViolationReadingSpeed = 8 // Too many characters per second
+};
+
+struct ValidationRules
+{
+    int MinimumBlankMs = 1;
+    int MinimumDurationMs = 700;
+    double MaxCharsPerSecond = 25.0;
+};
+
+// Keeps the violations of every subtitle of a RangeList.
+// Everything is checked in a linear pass by revalidate(), then each edit
+// only rechecks the subtitles around the changed one, in O(log n)
+// (plus the subtitles overlapping it, usually none).
+// The list is passed to every call, so that it can be moved around with its validator
+class SubtitleValidator
+{
+    ValidationRules Rules;
+
+    // State of each handle slot of the list
+    struct SlotState
+    {
+        SubtitleHandle Sub;
+        unsigned char Flags;
+        Range Time; // Time when the flags were computed, the key in Violating
+    };
+    std::vector<SlotState> States;
+
+    // Subtitles with any violation, in time order, for navigation
+    struct Key
+    {
+        Range Time;
+        std::uint32_t Slot;
+
+        bool operator<(const Key &other) const
+        {
+            return Time < other.Time || (!(other.Time < Time) && Slot < other.Slot);
+        }
+    };
+    std::set<Key> Violating;
+
+public:
+    const ValidationRules &rules() const
+    {
+        return Rules;
+    }
+
+    void setRules(RangeList &RL, const ValidationRules &rules)
+    {
+        Rules = rules;
+        revalidate(RL);
+    }
+
+    // Check every subtitle of RL from scratch
+    void revalidate(RangeList &RL);
+
+    // Update after an edit. oldTime is the timing before the change
+    void timingChanged(RangeList &RL, SubtitleHandle sub, const Range &oldTime);
+    void textChanged(RangeList &RL, SubtitleHandle sub);
+    void subtitleInserted(RangeList &RL, SubtitleHandle sub);
+    void subtitleRemoved(RangeList &RL, SubtitleHandle sub, const Range &oldTime);
+
+    // Violations of sub, 0 if it has none
+    unsigned char flags(SubtitleHandle sub) const
+    {
+        return sub.slot() < States.size() ? States[sub.slot()].Flags : 0;
+    }
+
+    // Number of subtitles with violations
+    std::size_t count() const
+    {
+        return Violating.size();
+    }
+
+    // First subtitle with violations starting after PosMs, or a null handle
+    SubtitleHandle next(int PosMs) const;
+
+    // Last subtitle with violations starting before PosMs, or a null handle
+    SubtitleHandle previous(int PosMs) const;
+
+private:
+    // Violations of sub, Overlaps tells whether it overlaps another subtitle
+    unsigned char check(const RangeList &RL, RangeList::const_iterator sub, bool Overlaps) const;
+
+    // Recheck sub and update its state
+    void update(const RangeList &RL, RangeList::const_iterator sub);
+
+    void setState(SubtitleHandle Sub, unsigned char Flags, const Range &Time);
+
+    // Recheck the subtitles whose relations with their neighbours may have
+    // changed because of a subtitle that is, or was, at Time
+    void updateAround(RangeList &RL, const Range &Time);
+};
+
+#endif // SUBTITLEVALIDATOR_H
@@ -0,0 +1,338 @@
+#include "textindex.h"
+
+#include <algorithm>
+#include <utility>
+
+static void foldChar(QChar c, QString &out)
+{
+    const ushort Code = c.unicode();
+    if(Code < 0x80)
+    {
+        if(Code >= 'A' && Code <= 'Z')
+        {
+            out += QChar(ushort(Code - 'A' + 'a'));
+        }
+        else if(Code == '\n' || Code == '\t')
+        {
+            out += QChar(' ');
+        }
+        else if(Code != '\r')
+        {
+            out += c;
+        }
+        return;
+    }
+
+    // Accents and other combining marks are dropped, composed characters are split into
+    // their base and their marks, e.g. é into e and an acute accent
+    if(c.isMark()) return;
+    if(c.decompositionTag() != QChar::NoDecomposition)
+    {
+        const QString Parts = c.decomposition();
+        for(QChar Part : Parts)
+        {
+            foldChar(Part, out);
+        }
+        return;
+    }
+    out += c.toCaseFolded();
+}
+
+QString TextIndex::fold(const QString &text)
+{
+    QString Result;
+    Result.reserve(text.size());
+    for(QChar c : text)
+    {
+        foldChar(c, Result);
+    }
+    return Result;
+}
+
+std::uint64_t TextIndex::gramKey(const ushort *chars, int length)
+{
+    std::uint64_t Key = std::uint64_t(length) << 48;
+    for(int i = 0; i < length; ++i)
+    {
+        Key |= std::uint64_t(chars[i]) << (16 * (length - 1 - i));
+    }
+    return Key;
+}
+
+std::vector<std::uint64_t> TextIndex::grams(const QString &folded)
+{
+    std::vector<std::uint64_t> Result;
+    const ushort *Chars = folded.utf16();
+    const int Size = folded.size();
+    Result.reserve(3 * Size);
+    for(int i = 0; i < Size; ++i)
+    {
+        for(int Length = 1; Length <= MaxGram && i + Length <= Size; ++Length)
+        {
+            Result.push_back(gramKey(Chars + i, Length));
+        }
+    }
+    std::sort(Result.begin(), Result.end());
+    Result.erase(std::unique(Result.begin(), Result.end()), Result.end());
+    return Result;
+}
+
+void TextIndex::rebuild(const RangeList &RL)
+{
+    States.clear();
+    Postings.clear();
+    Built = true;
+
+    // Most n-grams appear in many texts, so they are looked up in an open addressing table
+    // with their lists stored apart, much faster than in Postings, where they are moved at the end
+    std::vector<std::uint64_t> Keys(1 << 12, 0); // 0 is never a key, its length would be 0
+    std::vector<std::uint32_t> Ids(Keys.size());
+    std::vector<std::vector<std::uint32_t>> Lists;
+    int Shift = 64 - 12;
+
+    for(auto Sub = RL.cbegin(); Sub != RL.cend(); ++Sub)
+    {
+        const SubtitleHandle Handle = RL.handle(Sub);
+        if(Handle.slot() >= States.size())
+        {
+            States.resize(Handle.slot() + 1);
+        }
+        SlotState &State = States[Handle.slot()];
+        State.Sub = Handle;
+        State.Folded = fold(Sub->Text);
+        const ushort *Chars = State.Folded.utf16();
+        const int Size = State.Folded.size();
+        for(int i = 0; i < Size; ++i)
+        {
+            for(int Length = 1; Length <= MaxGram && i + Length <= Size; ++Length)
+            {
+                const std::uint64_t Key = gramKey(Chars + i, Length);
+                std::size_t Pos = (Key * 0x9e3779b97f4a7c15ULL) >> Shift;
+                while(Keys[Pos] != 0 && Keys[Pos] != Key)
+                {
+                    Pos = (Pos + 1) & (Keys.size() - 1);
+                }
+                if(Keys[Pos] == 0)
+                {
+                    Keys[Pos] = Key;
+                    Ids[Pos] = Lists.size();
+                    Lists.emplace_back();
+                }
+
+                // The same n-gram can appear again in a text, but not after another text
+                std::vector<std::uint32_t> &Slots = Lists[Ids[Pos]];
+                if(Slots.empty() || Slots.back() != Handle.slot())
+                {
+                    Slots.push_back(Handle.slot());
+                }
+
+                // Keep the table at most half full
+                if(Lists.size() * 2 > Keys.size())
+                {
+                    std::vector<std::uint64_t> OldKeys(Keys.size() * 2, 0);
+                    std::vector<std::uint32_t> OldIds(OldKeys.size());
+                    OldKeys.swap(Keys);
+                    OldIds.swap(Ids);
+                    --Shift;
+                    for(std::size_t k = 0; k < OldKeys.size(); ++k)
+                    {
+                        if(OldKeys[k] == 0) continue;
+                        std::size_t NewPos = (OldKeys[k] * 0x9e3779b97f4a7c15ULL) >> Shift;
+                        while(Keys[NewPos] != 0)
+                        {
+                            NewPos = (NewPos + 1) & (Keys.size() - 1);
+                        }
+                        Keys[NewPos] = OldKeys[k];
+                        Ids[NewPos] = OldIds[k];
+                    }
+                }
+            }
+        }
+    }
+
+    // Subtitles were visited in time order, which is the slot order unless the list was edited
+    Postings.reserve(Lists.size());
+    for(std::size_t k = 0; k < Keys.size(); ++k)
+    {
+        if(Keys[k] == 0) continue;
+        std::vector<std::uint32_t> &Slots = Lists[Ids[k]];
+        if(!std::is_sorted(Slots.begin(), Slots.end()))
+        {
+            std::sort(Slots.begin(), Slots.end());
+        }
+        Postings[Keys[k]] = std::move(Slots);
+    }
+}
+
+void TextIndex::update(const RangeList &RL, SubtitleHandle sub)
+{
+    if(!Built) return;
+
+    const std::uint32_t Slot = sub.slot();
+    const bool Indexed = Slot < States.size() && !States[Slot].Sub.isNull();
+    auto Sub = RL.find(sub);
+    if(Sub == RL.cend())
+    {
+        if(Indexed && States[Slot].Sub == sub)
+        {
+            change(Slot, SubtitleHandle(), QString());
+        }
+        return;
+    }
+
+    QString Folded = fold(Sub->Text);
+    if(Indexed && States[Slot].Sub == sub && States[Slot].Folded == Folded) return;
+    change(Slot, sub, std::move(Folded));
+}
+
+void TextIndex::change(std::uint32_t slot, SubtitleHandle sub, QString &&folded)
+{
+    if(slot >= States.size())
+    {
+        States.resize(slot + 1);
+    }
+    SlotState &State = States[slot];
+    const std::vector<std::uint64_t> Old = State.Sub.isNull() ? std::vector<std::uint64_t>() : grams(State.Folded);
+    const std::vector<std::uint64_t> New = sub.isNull() ? std::vector<std::uint64_t>() : grams(folded);
+
+    // An edit usually changes a few words, the n-grams of the rest are left alone
+    auto OldGram = Old.begin();
+    auto NewGram = New.begin();
+    while(OldGram != Old.end() || NewGram != New.end())
+    {
+        if(NewGram == New.end() || (OldGram != Old.end() && *OldGram < *NewGram))
+        {
+            auto Posting = Postings.find(*OldGram++);
+            if(Posting == Postings.end()) continue;
+            std::vector<std::uint32_t> &Slots = Posting->second;
+            auto It = std::lower_bound(Slots.begin(), Slots.end(), slot);
+            if(It != Slots.end() && *It == slot)
+            {
+                Slots.erase(It);
+            }
+            if(Slots.empty())
+            {
+                Postings.erase(Posting);
+            }
+        }
+        else if(OldGram == Old.end() || *NewGram < *OldGram)
+        {
+            std::vector<std::uint32_t> &Slots = Postings[*NewGram++];
+            Slots.insert(std::lower_bound(Slots.begin(), Slots.end(), slot), slot);
+        }
+        else
+        {
+            ++OldGram;
+            ++NewGram;
+        }
+    }
+
+    State.Sub = sub;
+    State.Folded = std::move(folded);
+}
+
+std::vector<SubtitleHandle> TextIndex::find(const RangeList &RL, const QString &query) const
+{
+    std::vector<SubtitleHandle> Result;
+    const QString Folded = fold(query);
+    if(Folded.isEmpty()) return Result;
+
+    // Short queries are n-grams themselves, longer ones need all of their trigrams
+    std::vector<const std::vector<std::uint32_t> *> Lists;
+    const ushort *Chars = Folded.utf16();
+    const int GramLength = std::min(int(Folded.size()), int(MaxGram));
+    for(int i = 0; i + GramLength <= Folded.size(); ++i)
+    {
+        auto Posting = Postings.find(gramKey(Chars + i, GramLength));
+        if(Posting == Postings.end()) return Result;
+        Lists.push_back(&Posting->second);
+    }
+    std::sort(Lists.begin(), Lists.end(), [](const std::vector<std::uint32_t> *a, const std::vector<std::uint32_t> *b)
+    {
+        return a->size() < b->size() || (a->size() == b->size() && a < b);
+    });
+    // Repeated trigrams
+    Lists.erase(std::unique(Lists.begin(), Lists.end()), Lists.end());
+
+    // Intersect from the shortest list, the candidates can only get fewer
+    std::vector<std::uint32_t> Candidates = *Lists.front();
+    for(std::size_t i = 1; i < Lists.size() && !Candidates.empty(); ++i)
+    {
+        const std::vector<std::uint32_t> &List = *Lists[i];
+        auto Kept = Candidates.begin();
+        if(List.size() > 16 * Candidates.size())
+        {
+            // Much longer lists are searched instead of walked
+            for(std::uint32_t Slot : Candidates)
+            {
+                if(std::binary_search(List.begin(), List.end(), Slot)) *Kept++ = Slot;
+            }
+        }
+        else
+        {
+            Kept = std::set_intersection(Candidates.begin(), Candidates.end(), List.begin(), List.end(), Candidates.begin());
+        }
+        Candidates.erase(Kept, Candidates.end());
+    }
+
+    // Containing all the trigrams doesn't mean containing them in sequence
+    const bool Verify = Folded.size() > MaxGram;
+    Result.reserve(Candidates.size());
+    for(std::uint32_t Slot : Candidates)
+    {
+        if(!Verify || States[Slot].Folded.contains(Folded))
+        {
+            Result.push_back(States[Slot].Sub);
+        }
+    }
+    sortByTime(RL, Result);
+    return Result;
+}
+
+std::vector<SubtitleHandle> TextIndex::refine(const RangeList &RL, const std::vector<SubtitleHandle> &previous, const QString &query) const
+{
+    std::vector<SubtitleHandle> Result;
+    const QString Folded = fold(query);
+    for(SubtitleHandle Sub : previous)
+    {
+        if(RL.contains(Sub) && Sub.slot() < States.size() && States[Sub.slot()].Folded.contains(Folded))
+        {
+            Result.push_back(Sub);
+        }
+    }
+    return Result;
+}
+
+void TextIndex::sortByTime(const RangeList &RL, std::vector<SubtitleHandle> &subs)
+{
+    // Many results are put in order by marking their positions, in O(n)
+    if(subs.size() > RL.size() / 16)
+    {
+        std::vector<char> Found(RL.size(), false);
+        for(SubtitleHandle Sub : subs)
+        {
+            Found[RL.find(Sub).index()] = true;
+        }
+        subs.clear();
+        for(std::size_t i = 0; i < Found.size(); ++i)
+        {
+            if(Found[i]) subs.push_back(RL.handle(RL.cbegin() + i));
+        }
+        return;
+    }
+
+    std::vector<std::pair<int, SubtitleHandle>> Positions;
+    Positions.reserve(subs.size());
+    for(SubtitleHandle Sub : subs)
+    {
+        Positions.emplace_back(RL.find(Sub).index(), Sub);
+    }
+    std::sort(Positions.begin(), Positions.end(), [](const std::pair<int, SubtitleHandle> &a, const std::pair<int, SubtitleHandle> &b)
+    {
+        return a.first < b.first;
+    });
+    for(std::size_t i = 0; i < Positions.size(); ++i)
+    {
+        subs[i] = Positions[i].second;
+    }
+}
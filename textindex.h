@@ -0,0 +1,84 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QString>
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "rangelist.h"
+
+// N-gram index over the texts of a RangeList, for search as you type.
+// Texts are folded first: case folded, without diacritics, with line breaks as spaces.
+// Each sequence of 1 to 3 characters of the folded texts maps to the sorted slots of the
+// subtitles containing it. A query of up to 3 characters is looked up directly, a longer one
+// intersects the lists of its trigrams, starting from the shortest, and checks only
+// the subtitles left against their folded text.
+// Like SubtitleValidator, it is kept up to date with each edit, and the list
+// is passed to every call
+class TextIndex
+{
+    // State of each handle slot of the list
+    struct SlotState
+    {
+        SubtitleHandle Sub; // Null if the slot isn't indexed
+        QString Folded;
+    };
+    std::vector<SlotState> States;
+
+    static const int MaxGram = 3;
+
+    // Slots containing each n-gram, sorted
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> Postings;
+
+    bool Built = false;
+
+public:
+    // Lower case, without diacritics and with any line break or tab as a space,
+    // so that "Café" and "CAFE" match
+    static QString fold(const QString &text);
+
+    // Index every subtitle of RL from scratch
+    void rebuild(const RangeList &RL);
+
+    // Whether rebuild() was called, until then updates are ignored,
+    // so that lists never searched don't pay for the index
+    bool isBuilt() const
+    {
+        return Built;
+    }
+
+    // Index sub again after its text changed, it was inserted or it was removed.
+    // A sub no longer in RL is removed from the index
+    void update(const RangeList &RL, SubtitleHandle sub);
+
+    // Subtitles containing query, folded like the texts, in time order
+    std::vector<SubtitleHandle> find(const RangeList &RL, const QString &query) const;
+
+    // Subtitles of previous, the results of a query contained in query, that also contain query.
+    // As the user types, each result set is filtered from the previous one instead of searched again.
+    // previous must be up to date with RL
+    std::vector<SubtitleHandle> refine(const RangeList &RL, const std::vector<SubtitleHandle> &previous, const QString &query) const;
+
+    std::size_t gramCount() const
+    {
+        return Postings.size();
+    }
+
+private:
+    // Index slot as holding sub, with its folded text, or as empty if sub is null
+    void change(std::uint32_t slot, SubtitleHandle sub, QString &&folded);
+
+    // Key of an n-gram, its length goes in the high bits
+    static std::uint64_t gramKey(const ushort *chars, int length);
+
+    // Distinct n-grams of folded, sorted
+    static std::vector<std::uint64_t> grams(const QString &folded);
+
+    // Put subs in the order of RL
+    static void sortByTime(const RangeList &RL, std::vector<SubtitleHandle> &subs);
+};
+
+#endif // TEXTINDEX_H
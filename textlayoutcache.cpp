@@ -0,0 +1,50 @@
+#include "textlayoutcache.h"
+
+#include <QFontMetrics>
+#include <QHash>
+#include <QTransform>
+
+#include <cmath>
+
+uint qHash(const TextLayoutCache::Key &key, uint seed)
+{
+    seed ^= qHash(key.Text, seed);
+    seed ^= qHash(key.Font, seed) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= uint(key.WidthBucket) * 31u + uint(key.Height) * 17u + uint(key.AlignBottom);
+    return seed;
+}
+
+const TextLayoutCache::Entry *TextLayoutCache::layout(const QString &text, const QFont &font, int width, int height, bool alignBottom)
+{
+    int WidthBucket = width / WidthBucketSize;
+    if(WidthBucket <= 0) return nullptr;
+
+    Key K { text, font, WidthBucket, height, alignBottom };
+    Entry *Cached = Cache.object(K);
+    if(Cached) return Cached;
+
+    int Width = WidthBucket * WidthBucketSize;
+
+    Entry *NewEntry = new Entry;
+    NewEntry->Text.setTextFormat(Qt::PlainText);
+    NewEntry->Text.setTextWidth(Width);
+    NewEntry->Text.setText(text);
+    NewEntry->Text.prepare(QTransform(), font);
+
+    if(NewEntry->Text.size().height() > height)
+    {
+        // The wrapped text doesn't fit the range,
+        // show as much as possible of it on a single line
+        QString SingleLine = text;
+        SingleLine.replace(QLatin1Char('\n'), QLatin1Char(' '));
+        NewEntry->Text.setTextWidth(-1);
+        NewEntry->Text.setText(QFontMetrics(font).elidedText(SingleLine, Qt::ElideRight, Width));
+        NewEntry->Text.prepare(QTransform(), font);
+    }
+
+    int TextHeight = std::ceil(NewEntry->Text.size().height());
+    NewEntry->Offset = QPoint(0, alignBottom ? height - TextHeight : 0);
+
+    Cache.insert(K, NewEntry);
+    return NewEntry;
+}
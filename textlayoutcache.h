@@ -0,0 +1,65 @@
+#ifndef TEXTLAYOUTCACHE_H
+#define TEXTLAYOUTCACHE_H
+
+#include <QCache>
+#include <QFont>
+#include <QPoint>
+#include <QStaticText>
+#include <QString>
+
+// Cache of the laid out texts drawn inside ranges.
+// Text is shaped again only when the text itself, the font,
+// or the room available to draw it changes
+class TextLayoutCache
+{
+public:
+    struct Key
+    {
+        QString Text;
+        QFont Font;
+        int WidthBucket;
+        int Height;
+        bool AlignBottom;
+
+        bool operator==(const Key &other) const
+        {
+            return WidthBucket == other.WidthBucket &&
+                    Height == other.Height &&
+                    AlignBottom == other.AlignBottom &&
+                    Text == other.Text &&
+                    Font == other.Font;
+        }
+    };
+
+    struct Entry
+    {
+        QStaticText Text;
+        QPoint Offset; // Position of the text relative to the top left corner of its box
+    };
+
+    // Widths are rounded down to a multiple of this, so that
+    // dragging a range doesn't relayout its text on every pixel
+    static const int WidthBucketSize = 8;
+
+    TextLayoutCache(int maxEntries = 4096) :
+        Cache(maxEntries)
+    { }
+
+    // Return the layout of text wrapped in a box of the given size,
+    // if the text doesn't fit, it is elided on a single line.
+    // Returns nullptr if the box is too narrow to hold any text.
+    // The returned pointer is valid until the next call
+    const Entry *layout(const QString &text, const QFont &font, int width, int height, bool alignBottom);
+
+    void clear()
+    {
+        Cache.clear();
+    }
+
+private:
+    QCache<Key, Entry> Cache;
+};
+
+uint qHash(const TextLayoutCache::Key &key, uint seed = 0);
+
+#endif // TEXTLAYOUTCACHE_H
@@ -0,0 +1,150 @@
+#include "timemap.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+// Arrays shorter than this are mapped by a single thread
+static const std::ptrdiff_t ParallelThreshold = 1 << 18;
+
+// Call f on chunks of [first, last), one for each hardware thread
+template<class T, class F>
+static void parallelChunks(T *first, T *last, F f)
+{
+    const std::ptrdiff_t Count = last - first;
+    const unsigned int Threads = std::thread::hardware_concurrency();
+    if(Count < ParallelThreshold || Threads < 2)
+    {
+        f(first, last);
+        return;
+    }
+
+    const std::ptrdiff_t Chunk = (Count + Threads - 1) / Threads;
+    std::vector<std::thread> Workers;
+    for(T *Begin = first + Chunk; Begin < last; Begin += Chunk)
+    {
+        Workers.emplace_back(f, Begin, std::min(Begin + Chunk, last));
+    }
+    f(first, first + Chunk);
+    for(std::thread &Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+TimeMap TimeMap::affine(double scale, double offsetMs)
+{
+    TimeMap Result;
+    Result.Segments.push_back(Segment { -std::numeric_limits<double>::infinity(), scale, offsetMs });
+    return Result;
+}
+
+TimeMap TimeMap::twoPoint(int src1Ms, int dst1Ms, int src2Ms, int dst2Ms)
+{
+    return piecewise({ std::make_pair(src1Ms, dst1Ms), std::make_pair(src2Ms, dst2Ms) });
+}
+
+TimeMap TimeMap::piecewise(const std::vector<std::pair<int, int>> &points)
+{
+    if(points.empty())
+    {
+        return shift(0);
+    }
+
+    TimeMap Result;
+    for(std::size_t i = 0; i + 1 < points.size(); ++i)
+    {
+        double SrcSpan = points[i + 1].first - points[i].first;
+        if(SrcSpan <= 0) continue;
+
+        double Scale = (points[i + 1].second - points[i].second) / SrcSpan;
+        double OffsetMs = points[i].second - points[i].first * Scale;
+        double SrcMs = Result.Segments.empty() ? -std::numeric_limits<double>::infinity() : points[i].first;
+        Result.Segments.push_back(Segment { SrcMs, Scale, OffsetMs });
+    }
+
+    if(Result.Segments.empty())
+    {
+        return shift(points.front().second - points.front().first);
+    }
+    return Result;
+}
+
+bool TimeMap::isMonotonic() const
+{
+    for(std::size_t i = 0; i < Segments.size(); ++i)
+    {
+        const Segment &S = Segments[i];
+        if(S.Scale < 0.0) return false;
+
+        // Nor may a segment start below where the previous one ends
+        if(i > 0)
+        {
+            const Segment &Previous = Segments[i - 1];
+            if(S.SrcMs * S.Scale + S.OffsetMs < S.SrcMs * Previous.Scale + Previous.OffsetMs) return false;
+        }
+    }
+    return true;
+}
+
+const TimeMap::Segment &TimeMap::segmentOf(int TimeMs) const
+{
+    auto Next = std::upper_bound(Segments.begin() + 1, Segments.end(), double(TimeMs), [](double t, const Segment &S)
+    {
+        return t < S.SrcMs;
+    });
+    return *(Next - 1);
+}
+
+void TimeMap::apply(Range *first, Range *last) const
+{
+    parallelChunks(first, last, [this](Range *Begin, Range *End)
+    {
+        applySerial(Begin, End);
+    });
+}
+
+void TimeMap::apply(int *first, int *last) const
+{
+    parallelChunks(first, last, [this](int *Begin, int *End)
+    {
+        applySerial(Begin, End);
+    });
+}
+
+void TimeMap::applySerial(Range *first, Range *last) const
+{
+    if(isAffine())
+    {
+        const Segment S = Segments.front();
+        for(Range *R = first; R != last; ++R)
+        {
+            R->StartTime = mapSegment(S, R->StartTime);
+            R->EndTime = mapSegment(S, R->EndTime);
+        }
+        return;
+    }
+
+    for(Range *R = first; R != last; ++R)
+    {
+        *R = map(*R);
+    }
+}
+
+void TimeMap::applySerial(int *first, int *last) const
+{
+    if(isAffine())
+    {
+        const Segment S = Segments.front();
+        for(int *T = first; T != last; ++T)
+        {
+            *T = mapSegment(S, *T);
+        }
+        return;
+    }
+
+    for(int *T = first; T != last; ++T)
+    {
+        *T = map(*T);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef TIMEMAP_H
+#define TIMEMAP_H
+
+#include "srtParser/srtsubtitle.h"
+
+#include <utility>
+#include <vector>
+
+// Piecewise-linear map of times, to shift, stretch or resync subtitles.
+// The first and the last segments extend to infinity,
+// mapped times are rounded to the nearest millisecond and clamped at 0
+class TimeMap
+{
+    // Segment starting at SrcMs, mapping t to t * Scale + OffsetMs
+    struct Segment
+    {
+        double SrcMs;
+        double Scale;
+        double OffsetMs;
+    };
+
+    std::vector<Segment> Segments; // Sorted by SrcMs, the first one starts at -infinity
+
+    static int round(double TimeMs)
+    {
+        // Written to be vectorized: no calls, no branches
+        TimeMs = TimeMs < 0.0 ? 0.0 : TimeMs;
+        return int(TimeMs + 0.5);
+    }
+
+    int mapSegment(const Segment &S, int TimeMs) const
+    {
+        return round(TimeMs * S.Scale + S.OffsetMs);
+    }
+
+    const Segment &segmentOf(int TimeMs) const;
+
+public:
+    static TimeMap affine(double scale, double offsetMs);
+
+    static TimeMap shift(int offsetMs)
+    {
+        return affine(1.0, offsetMs);
+    }
+
+    // Move each time where the same frame is at the new frame rate, e.g. from 23.976 to 25 fps
+    static TimeMap frameRate(double fromFps, double toFps)
+    {
+        return affine(fromFps / toFps, 0.0);
+    }
+
+    // Linear resync, moving src1Ms to dst1Ms and src2Ms to dst2Ms
+    static TimeMap twoPoint(int src1Ms, int dst1Ms, int src2Ms, int dst2Ms);
+
+    // Map through the given (source, destination) points, sorted by source time.
+    // With a single point it is a shift
+    static TimeMap piecewise(const std::vector<std::pair<int, int>> &points);
+
+    bool isAffine() const
+    {
+        return Segments.size() == 1;
+    }
+
+    // Whether the map never reverses the order of two times
+    bool isMonotonic() const;
+
+    int map(int TimeMs) const
+    {
+        return mapSegment(segmentOf(TimeMs), TimeMs);
+    }
+
+    Range map(const Range &R) const
+    {
+        return Range { map(R.StartTime), map(R.EndTime) };
+    }
+
+    // Map every time in [first, last), in place.
+    // Large arrays are split among threads
+    void apply(Range *first, Range *last) const;
+    void apply(int *first, int *last) const;
+
+private:
+    void applySerial(Range *first, Range *last) const;
+    void applySerial(int *first, int *last) const;
+};
+
+#endif // TIMEMAP_H
@@ -0,0 +1,277 @@
+#include "trackalignment.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+// How the best paths into a cell got there, as bit flags.
+// Each cell has two paths: the best one ending with a match, and the best one ending with a skip
+enum : unsigned char
+{
+    MatchAfterSkip = 1, // The match path was on a skip path before
+    SkipTrack = 2, // The skip path leaves the previous cue of the track unmatched
+    SkipVO = 4, // The skip path leaves the previous cue of the VO unmatched
+    SkipAfterSkip = 8 // The skip path was on a skip path before
+};
+
+// 1 for equal values, 0.5 at a distance of scale, towards 0 further away
+static double closeness(int distance, int scale)
+{
+    return double(scale) / (scale + std::abs(distance));
+}
+
+static double durationSimilarity(const Range &a, const Range &b)
+{
+    const int A = std::max(1, a.EndTime - a.StartTime);
+    const int B = std::max(1, b.EndTime - b.StartTime);
+    return double(std::min(A, B)) / std::max(A, B);
+}
+
+namespace
+{
+
+// Cells (i, j) of the alignment, i cues of the track and j of the VO consumed,
+// with j within Width of the diagonal
+class Band
+{
+    int TrackCount;
+    int VOCount;
+    int Width;
+    std::vector<std::size_t> RowStart;
+
+public:
+    Band(int trackCount, int voCount, int width) :
+        TrackCount(trackCount),
+        VOCount(voCount),
+        Width(width),
+        RowStart(trackCount + 2)
+    {
+        for(int i = 0; i <= TrackCount; ++i)
+        {
+            RowStart[i + 1] = RowStart[i] + (last(i) - first(i) + 1);
+        }
+    }
+
+    int first(int i) const
+    {
+        return std::max(0, centre(i) - Width);
+    }
+
+    int last(int i) const
+    {
+        return std::min(VOCount, centre(i) + Width);
+    }
+
+    bool contains(int i, int j) const
+    {
+        return j >= first(i) && j <= last(i);
+    }
+
+    std::size_t cell(int i, int j) const
+    {
+        return RowStart[i] + (j - first(i));
+    }
+
+    std::size_t size() const
+    {
+        return RowStart.back();
+    }
+
+    int rowWidth() const
+    {
+        return 2 * Width + 1;
+    }
+
+private:
+    int centre(int i) const
+    {
+        return int(std::int64_t(i) * VOCount / TrackCount);
+    }
+};
+
+}
+
+TrackAlignment alignTracks(const RangeList &track, const RangeList &vo, TimingTransfer transfer, const AlignmentOptions &options)
+{
+    TrackAlignment Result;
+    const int N = track.size();
+    const int M = vo.size();
+
+    std::vector<Range> TrackTimes, VOTimes;
+    TrackTimes.reserve(N);
+    VOTimes.reserve(M);
+    for(auto Sub = track.cbegin(); Sub != track.cend(); ++Sub)
+    {
+        TrackTimes.push_back(Sub->Time);
+    }
+    for(auto Sub = vo.cbegin(); Sub != vo.cend(); ++Sub)
+    {
+        VOTimes.push_back(Sub->Time);
+    }
+
+    std::vector<std::pair<int, int>> Pairs; // Matched track and VO indices
+    if(N > 0 && M > 0)
+    {
+        const Band B(N, M, std::abs(N - M) + options.MinBandWidth);
+        std::vector<unsigned char> Moves(B.size(), 0);
+
+        // Best scores of the cells of the previous and of the current row, ending with a match or a skip.
+        // The offset of the last match is known from the cell of a match path, so comparing it to the
+        // offset of the next match keeps the alignment exact; after a skip the next match gets a neutral score
+        const double Unreachable = -std::numeric_limits<double>::infinity();
+        std::vector<double> PrevMatch(B.rowWidth(), Unreachable), Match(B.rowWidth(), Unreachable);
+        std::vector<double> PrevSkip(B.rowWidth(), Unreachable), Skip(B.rowWidth(), Unreachable);
+
+        for(int i = 0; i <= N; ++i)
+        {
+            const int First = B.first(i);
+            const int Last = B.last(i);
+            const int PrevFirst = i > 0 ? B.first(i - 1) : 0;
+            for(int j = First; j <= Last; ++j)
+            {
+                unsigned char Move = 0;
+                double BestMatch = Unreachable;
+                double BestSkip = i == 0 && j == 0 ? 0.0 : Unreachable;
+
+                if(i > 0 && j > 0 && B.contains(i - 1, j - 1))
+                {
+                    const Range &A = TrackTimes[i - 1];
+                    const Range &V = VOTimes[j - 1];
+                    const int Offset = V.StartTime - A.StartTime;
+                    const double Score = durationSimilarity(A, V) + 0.25 * closeness(Offset, options.DriftMs) - options.MatchThreshold;
+                    const int k = j - 1 - PrevFirst;
+                    if(PrevMatch[k] != Unreachable)
+                    {
+                        const int LastOffset = VOTimes[j - 2].StartTime - TrackTimes[i - 2].StartTime;
+                        BestMatch = PrevMatch[k] + Score + closeness(Offset - LastOffset, options.ContinuityMs);
+                    }
+                    if(PrevSkip[k] + Score + 0.5 > BestMatch)
+                    {
+                        BestMatch = PrevSkip[k] + Score + 0.5;
+                        Move |= MatchAfterSkip;
+                    }
+                }
+                if(i > 0 && B.contains(i - 1, j))
+                {
+                    const int k = j - PrevFirst;
+                    const bool AfterSkip = PrevSkip[k] > PrevMatch[k];
+                    const double Score = std::max(PrevSkip[k], PrevMatch[k]) - options.SkipPenalty;
+                    if(Score > BestSkip)
+                    {
+                        BestSkip = Score;
+                        Move = (Move & MatchAfterSkip) | SkipTrack | (AfterSkip ? SkipAfterSkip : 0);
+                    }
+                }
+                if(j > First)
+                {
+                    const int k = j - 1 - First;
+                    const bool AfterSkip = Skip[k] > Match[k];
+                    const double Score = std::max(Skip[k], Match[k]) - options.SkipPenalty;
+                    if(Score > BestSkip)
+                    {
+                        BestSkip = Score;
+                        Move = (Move & MatchAfterSkip) | SkipVO | (AfterSkip ? SkipAfterSkip : 0);
+                    }
+                }
+
+                Match[j - First] = BestMatch;
+                Skip[j - First] = BestSkip;
+                Moves[B.cell(i, j)] = Move;
+            }
+            Match.swap(PrevMatch);
+            Skip.swap(PrevSkip);
+            std::fill(Match.begin(), Match.end(), Unreachable);
+            std::fill(Skip.begin(), Skip.end(), Unreachable);
+        }
+
+        // Follow the moves back from the end, which is always in the band
+        int i = N, j = M;
+        bool OnMatch = PrevMatch[M - B.first(N)] > PrevSkip[M - B.first(N)];
+        while(i > 0 || j > 0)
+        {
+            const unsigned char Move = Moves[B.cell(i, j)];
+            if(OnMatch)
+            {
+                Pairs.emplace_back(--i, --j);
+                OnMatch = !(Move & MatchAfterSkip);
+            }
+            else
+            {
+                if(Move & SkipTrack)
+                {
+                    --i;
+                }
+                else
+                {
+                    --j;
+                }
+                OnMatch = !(Move & SkipAfterSkip);
+            }
+        }
+        std::reverse(Pairs.begin(), Pairs.end());
+    }
+
+    // A match is trusted when its offset agrees with one of the neighbouring matches,
+    // which holds for all but isolated matches, even at a cut
+    std::vector<char> Matched(N, false);
+    double ConfidenceSum = 0.0;
+    Result.Matches.reserve(Pairs.size());
+    for(std::size_t k = 0; k < Pairs.size(); ++k)
+    {
+        const Range &From = TrackTimes[Pairs[k].first];
+        const Range &To = VOTimes[Pairs[k].second];
+        const int Offset = To.StartTime - From.StartTime;
+        double Agreement = 0.0;
+        if(k > 0)
+        {
+            const int Previous = VOTimes[Pairs[k - 1].second].StartTime - TrackTimes[Pairs[k - 1].first].StartTime;
+            Agreement = closeness(Offset - Previous, options.ContinuityMs);
+        }
+        if(k + 1 < Pairs.size())
+        {
+            const int Next = VOTimes[Pairs[k + 1].second].StartTime - TrackTimes[Pairs[k + 1].first].StartTime;
+            Agreement = std::max(Agreement, closeness(Offset - Next, options.ContinuityMs));
+        }
+
+        CueMatch Match;
+        Match.Sub = track.handle(track.cbegin() + Pairs[k].first);
+        Match.VO = vo.handle(vo.cbegin() + Pairs[k].second);
+        Match.From = From;
+        if(transfer == TimingTransfer::Copy)
+        {
+            Match.To = To;
+        }
+        else
+        {
+            Match.To = Range { To.StartTime, To.StartTime + (From.EndTime - From.StartTime) };
+        }
+        Match.Confidence = durationSimilarity(From, To) * Agreement;
+        ConfidenceSum += Match.Confidence;
+        Result.Matches.push_back(Match);
+        Matched[Pairs[k].first] = true;
+    }
+    if(!Pairs.empty())
+    {
+        Result.MeanConfidence = ConfidenceSum / Pairs.size();
+    }
+
+    for(int i = 0; i < N; ++i)
+    {
+        if(!Matched[i]) Result.Unmatched.push_back(track.handle(track.cbegin() + i));
+    }
+    return Result;
+}
+
+SubtitleDiff TrackAlignment::changes(double minConfidence) const
+{
+    SubtitleDiff Result;
+    for(const CueMatch &Match : Matches)
+    {
+        if(Match.Confidence >= minConfidence && Match.To != Match.From)
+        {
+            Result.Changes.push_back(EditDelta { EditDelta::Timing, Match.Sub, 0, Match.From, Match.To, QString(), QString(), 0 });
+        }
+    }
+    return Result;
+}
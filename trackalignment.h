@@ -0,0 +1,56 @@
+#ifndef TRACKALIGNMENT_H
+#define TRACKALIGNMENT_H
+
+#include <vector>
+
+#include "rangelist.h"
+#include "subtitlediff.h"
+
+struct AlignmentOptions
+{
+    int ContinuityMs = 250; // Offset change, between consecutive matches, that halves their continuity score
+    int DriftMs = 10000; // Offset from the original timing that halves the score of a match
+    double SkipPenalty = 0.5; // Cost of leaving a cue of either track unmatched
+    double MatchThreshold = 1.0; // Score a match needs to be better than leaving both cues unmatched
+    int MinBandWidth = 64; // Cues searched on each side of the diagonal, besides the difference in cue count
+};
+
+// How the timing of the VO cue is transferred to the matched cue
+enum class TimingTransfer
+{
+    Copy, // Take the timing of the VO cue
+    Shift // Keep the duration, move to the start of the VO cue
+};
+
+struct CueMatch
+{
+    SubtitleHandle Sub;
+    SubtitleHandle VO;
+    Range From; // Timing of Sub
+    Range To; // Timing proposed for Sub
+    double Confidence; // From 0 to 1
+};
+
+struct TrackAlignment
+{
+    std::vector<CueMatch> Matches; // In time order
+    std::vector<SubtitleHandle> Unmatched; // Cues of the track without a VO cue
+    double MeanConfidence = 0.0;
+
+    // Timing changes of the matches with at least minConfidence, to apply with SubtitleData::applyDiff()
+    SubtitleDiff changes(double minConfidence) const;
+};
+
+// Match the cues of track with the cues of vo, e.g. a translation with a VO that was cut again.
+// Both tracks are walked in order with dynamic programming: a pair of cues scores for similar
+// durations, for keeping the offset between the tracks of the previous match, since cuts
+// shift whole scenes, and a little for staying near the original timing.
+// Cues can be left unmatched on both sides, at a cost.
+// Only the pairs within a band around the diagonal are scored, as wide as the difference
+// in cue count plus a margin, so the time is O(n w) instead of O(n m).
+// The confidence of a match combines its duration similarity with how well its offset
+// agrees with the neighbouring matches
+TrackAlignment alignTracks(const RangeList &track, const RangeList &vo, TimingTransfer transfer = TimingTransfer::Copy,
+                           const AlignmentOptions &options = AlignmentOptions());
+
+#endif // TRACKALIGNMENT_H
@@ -24,7 +24,22 @@ SOURCES += main.cpp\
     waveformutils.cpp \
     renderer.cpp \
     rangelist.cpp \
-    minblank.cpp
+    minblank.cpp \
+    textlayoutcache.cpp \
+    waveformoverview.cpp \
+    renderscheduler.cpp \
+    snappingindex.cpp \
+    editjournal.cpp \
+    timemap.cpp \
+    subtitlevalidator.cpp \
+    gapindex.cpp \
+    srtwriter.cpp \
+    projectfile.cpp \
+    autosavelog.cpp \
+    subtitlediff.cpp \
+    textindex.cpp \
+    trackalignment.cpp \
+    audiooffset.cpp
 
 HEADERS  += mainwindow.h \
     waveformview.h \
@@ -32,7 +47,22 @@ HEADERS  += mainwindow.h \
     model.h \
     constrain.h \
     renderer.h \
-    rangelist.h
+    rangelist.h \
+    textlayoutcache.h \
+    waveformoverview.h \
+    renderscheduler.h \
+    snappingindex.h \
+    editjournal.h \
+    timemap.h \
+    subtitlevalidator.h \
+    gapindex.h \
+    srtwriter.h \
+    projectfile.h \
+    autosavelog.h \
+    subtitlediff.h \
+    textindex.h \
+    trackalignment.h \
+    audiooffset.h
 
 FORMS    += mainwindow.ui
 
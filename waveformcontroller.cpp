@@ -7,6 +7,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <limits>
 
 void WaveformViewport::wheelEvent(QWheelEvent *ev)
 {
@@ -54,7 +55,7 @@ void WaveformViewport::wheelEvent(QWheelEvent *ev)
             setPosition(PositionMs - ScrollAmount);
         }
     }
-    update();
+    requestInteractiveFrame();
 }
 
 void WaveformViewport::mouseDoubleClickEvent(QMouseEvent *ev)
@@ -78,7 +79,7 @@ void WaveformViewport::mouseDoubleClickEvent(QMouseEvent *ev)
 
     Selection.StartTime = sub->Time.StartTime;
     Selection.EndTime = sub->Time.EndTime;
-    update();
+    requestFrame();
 }
 
 void WaveformViewport::mousePressEvent(QMouseEvent *ev)
@@ -87,9 +88,11 @@ void WaveformViewport::mousePressEvent(QMouseEvent *ev)
     if(ev->pos().y() >= height() - RulerHeight) return;
 
     MouseDown = true;
+    // Everything changed until the button is released is undone at once
+    SData.journal().beginGroup();
     RangeList &RangeListClicked = getRangeListFromPos(ev->pos().y());
     mousePressCoolEdit(ev, RangeListClicked);
-    update();
+    requestFrame();
 }
 
 void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListClicked)
@@ -129,7 +132,7 @@ void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListC
             if(hasFocusedSubtitle())
             {
                 SData.setSelectedSubtitle(FocusedSubtitle);
-                Selection = FocusedSubtitle->Time;
+                Selection = SData.selectedSubtitle()->Time;
             }
             if(!hasSelection())
             {
@@ -167,10 +170,7 @@ void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListC
                 // Update it and schedule sorting
                 if(SData.hasSelected())
                 {
-                    // Schedule update
-                    SubChanged = true;
-                    SData.selectedSubtitle()->Time.StartTime = Selection.StartTime;
-                    SData.selectedSubtitle()->Time.EndTime = Selection.EndTime;
+                    setSelectedTiming(Selection);
                 }
             }
         }
@@ -179,7 +179,7 @@ void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListC
             // Invalidate selection
             Selection.StartTime = -1;
             SelectionOriginMs = NewCursorPosMs;
-            SData.setSelectedSubtitle(SData.end());
+            SData.clearSelectedSubtitle();
         }
 
         if(EnableMouseAntiOverlapping)
@@ -188,46 +188,45 @@ void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListC
             MinSelTime = -1;
             MaxSelTime = -1;
 
-            auto insertPos = RangeListClicked.subsAheadOf(NewCursorPosMs);
-            if(insertPos >= RangeListClicked.begin())
+            // Free time around the click, bounded by the subtitles starting before it
+            // and the first one starting after it, overlapping subtitles included
+            Range Gap = RangeListClicked.gapAt(NewCursorPosMs);
+            const bool HasPrevious = Gap.StartTime != std::numeric_limits<int>::min();
+            const bool HasNext = Gap.EndTime != std::numeric_limits<int>::max();
+            if(SData.hasSelected())
             {
-                if(SData.hasSelected())
+                if(NewCursorPosMs == SData.selectedSubtitle()->Time.StartTime)
                 {
-                    if(NewCursorPosMs == SData.selectedSubtitle()->Time.StartTime)
+                    if(HasPrevious)
                     {
-                        if(insertPos != RangeListClicked.begin())
-                        {
-                            MinSelTime = (insertPos - 1)->Time.EndTime + 1;
-                        }
-                        MaxSelTime = SData.selectedSubtitle()->Time.EndTime - 1;
+                        MinSelTime = Gap.StartTime + 1;
                     }
-                    else
+                    MaxSelTime = SData.selectedSubtitle()->Time.EndTime - 1;
+                }
+                else
+                {
+                    MinSelTime = SData.selectedSubtitle()->Time.StartTime + 1;
+                    if(HasNext)
                     {
-                        MinSelTime = SData.selectedSubtitle()->Time.StartTime + 1;
-                        if(insertPos != SData.end())
-                        {
-                            MaxSelTime = insertPos->Time.StartTime - 1;
-                        }
+                        MaxSelTime = Gap.EndTime - 1;
                     }
                 }
+            }
+            else
+            {
+                if(HasPrevious && Gap.StartTime >= NewCursorPosMs)
+                {
+                    // Selection only inside subtitle range
+                }
                 else
                 {
-                    if(insertPos != RangeListClicked.begin() &&
-                            NewCursorPosMs >= (insertPos - 1)->Time.StartTime &&
-                            NewCursorPosMs <= (insertPos -1)->Time.EndTime)
+                    if(HasPrevious)
                     {
-                        // Selection only inside subtitle range
+                        MinSelTime = Gap.StartTime + 1;
                     }
-                    else
+                    if(HasNext)
                     {
-                        if(insertPos != RangeListClicked.begin())
-                        {
-                            MinSelTime = (insertPos - 1)->Time.EndTime + 1;
-                        }
-                        if(insertPos != RangeListClicked.end())
-                        {
-                            MaxSelTime = insertPos->Time.StartTime - 1;
-                        }
+                        MaxSelTime = Gap.EndTime - 1;
                     }
                 }
             }
@@ -241,7 +240,7 @@ void WaveformViewport::mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListC
         {
             CursorMs = NewCursorPosMs;
         }
-        update();
+        requestFrame();
     }
 
 }
@@ -294,8 +293,7 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
                 if(SData.hasSelected())
                 {
                     // We have changed a subtitle
-                    SubChanged = true;
-                    SData.selectedSubtitle()->Time = Selection;
+                    setSelectedTiming(Selection);
                 }
             }
 
@@ -304,7 +302,7 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
                 CursorMs = NewCursorPosMs;
             }
 
-            update();
+            requestInteractiveFrame();
         }
     }
     else if(RangeListFocused.editable())
@@ -317,54 +315,36 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
         if(mousePos.y() <= 0 || mousePos.y() > height() - RulerHeight - 1)
             return;
 
-        // Have a tolerance of 4ms
-        int ToleranceFromBorder = pixelToRelTime(4);
-
-        // First search for subtitle under the mouse
-        if(!findFocusingSubtitle(CursorPosMs, RangeListFocused, ToleranceFromBorder, 0))
+        // Look for a subtitle boundary near the mouse
+        if(findFocusingSubtitle(Xpos, RangeListFocused))
         {
-            // If no subtitle is under the mouse
-
-            // Have a tolerance of 2ms
-            ToleranceFromBorder = pixelToRelTime(2);
+            return;
+        }
 
-            // Find subtitles that are at most 2ms away from the mouse cursor
-            int ToleranceFromPosition = pixelToRelTime(2);
-            if(ToleranceFromPosition < 1) ToleranceFromPosition = 1;
+        // If no subtitle is near the mouse cursor
+        // Check if there is selection
+        if(hasSelection())
+        {
+            // Check if we're near the selection
+            int ToleranceFromBorder = pixelToRelTime(4);
 
-            if(!findFocusingSubtitle(CursorPosMs, RangeListFocused, ToleranceFromBorder, ToleranceFromPosition))
+            FocusingMode NewMode;
+            int NewTime;
+            if(checkRangeForFocusing(Selection, CursorPosMs, ToleranceFromBorder, NewMode, NewTime))
             {
-                // If no subtitle is near the mouse cursor
-                // Check if there is selection
-                if(hasSelection())
+                setCursor(Qt::SizeHorCursor);
+                FocusMode = NewMode;
+                FocusedTimeMs = NewTime;
+                // Invalidate focused subtitle,
+                // there is no subtitle focused
+                OldFocusedSubtitle = FocusedSubtitle;
+                FocusedSubtitle = SubtitleHandle();
+                if(OldFocusedSubtitle != FocusedSubtitle)
                 {
-                    // Check if we're near the selection
-                    ToleranceFromBorder = pixelToRelTime(4);
-
-                    FocusingMode NewMode;
-                    int NewTime;
-                    if(checkRangeForFocusing(Selection, CursorPosMs, ToleranceFromBorder, NewMode, NewTime))
-                    {
-                        setCursor(Qt::SizeHorCursor);
-                        FocusMode = NewMode;
-                        FocusedTimeMs = NewTime;
-                        // Invalidate focused subtitle,
-                        // there is no subtitle focused
-                        OldFocusedSubtitle = FocusedSubtitle;
-                        FocusedSubtitle = SData.end();
-                        if(OldFocusedSubtitle != FocusedSubtitle)
-                        {
-                            update();
-                        }
-                        return;
-                    }
+                    requestFrame();
                 }
+                return;
             }
-            else return;
-        }
-        else
-        {
-            return;
         }
 
         // Set MinBlank
@@ -374,10 +354,10 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
         setCursor(Qt::ArrowCursor);
         FocusMode = FocusNone;
         OldFocusedSubtitle = FocusedSubtitle;
-        FocusedSubtitle = SData.end();
+        FocusedSubtitle = SubtitleHandle();
         if(OldFocusedSubtitle != FocusedSubtitle)
         {
-            update();
+            requestFrame();
         }
 
     }
@@ -387,10 +367,10 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
         setCursor(Qt::ArrowCursor);
         FocusMode = FocusNone;
         OldFocusedSubtitle = FocusedSubtitle;
-        FocusedSubtitle = SData.end();
+        FocusedSubtitle = SubtitleHandle();
         if(OldFocusedSubtitle != FocusedSubtitle)
         {
-            update();
+            requestFrame();
         }
 
     }
@@ -398,19 +378,22 @@ void WaveformViewport::mouseMoveEvent(QMouseEvent *ev)
 
 void WaveformViewport::mouseReleaseEvent(QMouseEvent *ev)
 {
-    RangeList &RL = getRangeListFromPos(ev->pos().y());
+    Q_UNUSED(ev)
 
     if(Selection.duration() < 40 && !SData.hasSelected() && !hasFocusedSubtitle())
     {
         // Clear selection
         Selection.StartTime = -1;
-        update();
+        requestFrame();
     }
 
+    SData.journal().endGroup();
+
+    // Edited subtitles have already been moved to their sorted position
     if(SubChanged)
     {
-        RL.sortSubs();
         SubChanged = false;
+        emit subtitlesChanged();
     }
 
     // Invalidate everything
@@ -418,7 +401,7 @@ void WaveformViewport::mouseReleaseEvent(QMouseEvent *ev)
     setCursor(Qt::ArrowCursor);
     MouseDown = false;
     FocusMode = FocusNone;
-    FocusedSubtitle = SData.end();
+    FocusedSubtitle = SubtitleHandle();
     MinSelTime = -1;
     MaxSelTime = -1;
 }
@@ -436,7 +419,176 @@ void WaveformViewport::updatePlayCursorPos(int PosMs)
     // 10ms away from previous value in order to avoid too rapid updates
     if(std::abs(PosMs - PlayCursorMs) >= 10)
     {
+        Snapping.movePoint(PlayCursorSnapping, PlayCursorMs, PosMs);
         PlayCursorMs = PosMs;
-        update();
+        requestFrame();
+    }
+}
+
+void WaveformViewport::undo()
+{
+    if(MouseDown) return;
+
+    const EditJournal::Entry *Entry = SData.undo();
+    if(Entry)
+    {
+        journalEntryApplied(*Entry, true);
+    }
+}
+
+void WaveformViewport::redo()
+{
+    if(MouseDown) return;
+
+    const EditJournal::Entry *Entry = SData.redo();
+    if(Entry)
+    {
+        journalEntryApplied(*Entry, false);
+    }
+}
+
+bool WaveformViewport::applySubtitleDiff(SubtitleDiff &&diff)
+{
+    if(MouseDown) return false;
+
+    const EditJournal::Entry *Entry = SData.applyDiff(std::move(diff));
+    if(Entry)
+    {
+        journalEntryApplied(*Entry, false);
+    }
+    return true;
+}
+
+TrackAlignment WaveformViewport::alignToVO(double minConfidence, TimingTransfer transfer)
+{
+    if(!SData.hasVO() || MouseDown) return TrackAlignment();
+
+    TrackAlignment Alignment = alignTracks(*SData.subs(), *SData.vo(), transfer);
+    applySubtitleDiff(Alignment.changes(minConfidence));
+    return Alignment;
+}
+
+void WaveformViewport::nextViolation()
+{
+    int FromMs = SData.hasSelected() ? SData.selectedSubtitle()->Time.StartTime : CursorMs;
+    selectViolation(SData.validator().next(FromMs));
+}
+
+void WaveformViewport::previousViolation()
+{
+    int FromMs = SData.hasSelected() ? SData.selectedSubtitle()->Time.StartTime : CursorMs;
+    selectViolation(SData.validator().previous(FromMs));
+}
+
+void WaveformViewport::nextGap()
+{
+    if(MouseDown) return;
+
+    // Skip the free span the cursor is already in
+    const RangeList &Subs = *SData.subs();
+    Range Current = Subs.gapAt(CursorMs);
+    if(Current.EndTime == std::numeric_limits<int>::max() && Current.StartTime < CursorMs) return;
+    int FromMs = Current.StartTime < CursorMs ? Current.EndTime : CursorMs;
+
+    // A subtitle in the gap needs the minimum blank on both sides
+    const int BlankMs = std::max(MinimumBlankMs, 0);
+    Range Gap = Subs.firstGap(FromMs, MinimumGapMs + 2 * BlankMs);
+    int StartMs = Gap.StartTime + BlankMs;
+    int EndMs = Gap.EndTime == std::numeric_limits<int>::max() ? StartMs + MinimumGapMs : Gap.EndTime - BlankMs;
+
+    SData.clearSelectedSubtitle();
+    CursorMs = StartMs;
+    Selection = Range { StartMs, EndMs };
+    if(!isPositionVisible(StartMs))
+    {
+        emit positionRequested(std::max(0, StartMs - PageSizeMs / 4));
+    }
+    requestFrame();
+}
+
+void WaveformViewport::findText(const QString &text)
+{
+    const TextIndex &Index = SData.textIndex();
+    const RangeList &Subs = *SData.subs();
+    // While typing, each text usually contains the previous one, whose matches are filtered
+    const QString Previous = TextIndex::fold(SearchText);
+    if(!Previous.isEmpty() && SearchRevision == Subs.revision() && TextIndex::fold(text).contains(Previous))
+    {
+        SearchMatches = Index.refine(Subs, SearchMatches, text);
+    }
+    else
+    {
+        SearchMatches = Index.find(Subs, text);
+    }
+    SearchText = text;
+    SearchRevision = Subs.revision();
+
+    // Stay on the current match, if it still matches
+    const SubtitleHandle Selected = SData.selectedHandle();
+    if(std::find(SearchMatches.begin(), SearchMatches.end(), Selected) == SearchMatches.end())
+    {
+        nextMatch();
+    }
+}
+
+void WaveformViewport::updateMatches()
+{
+    if(SearchRevision != SData.subs()->revision())
+    {
+        SearchMatches = SData.textIndex().find(*SData.subs(), SearchText);
+        SearchRevision = SData.subs()->revision();
+    }
+}
+
+void WaveformViewport::nextMatch()
+{
+    updateMatches();
+    if(SearchMatches.empty()) return;
+
+    // First match starting after the selected subtitle, or the cursor, wrapping around
+    const RangeList &Subs = *SData.subs();
+    const int FromMs = SData.hasSelected() ? SData.selectedSubtitle()->Time.StartTime : CursorMs - 1;
+    auto Next = std::upper_bound(SearchMatches.begin(), SearchMatches.end(), FromMs, [&Subs](int PosMs, SubtitleHandle Sub)
+    {
+        return PosMs < Subs.find(Sub)->Time.StartTime;
+    });
+    selectMatch(Next == SearchMatches.end() ? SearchMatches.front() : *Next);
+}
+
+void WaveformViewport::previousMatch()
+{
+    updateMatches();
+    if(SearchMatches.empty()) return;
+
+    const RangeList &Subs = *SData.subs();
+    const int FromMs = SData.hasSelected() ? SData.selectedSubtitle()->Time.StartTime : CursorMs;
+    auto Previous = std::lower_bound(SearchMatches.begin(), SearchMatches.end(), FromMs, [&Subs](SubtitleHandle Sub, int PosMs)
+    {
+        return Subs.find(Sub)->Time.StartTime < PosMs;
+    });
+    selectMatch(Previous == SearchMatches.begin() ? SearchMatches.back() : *(Previous - 1));
+}
+
+void WaveformViewport::selectMatch(SubtitleHandle sub)
+{
+    if(MouseDown || !SData.subs()->contains(sub)) return;
+
+    SData.setSelectedSubtitle(sub);
+    Selection = SData.selectedSubtitle()->Time;
+    const int CentreMs = Selection.StartTime + Selection.duration() / 2;
+    emit positionRequested(std::max(0, CentreMs - PageSizeMs / 2));
+    requestFrame();
+}
+
+void WaveformViewport::selectViolation(SubtitleHandle sub)
+{
+    if(MouseDown || !SData.subs()->contains(sub)) return;
+
+    SData.setSelectedSubtitle(sub);
+    Selection = SData.selectedSubtitle()->Time;
+    if(!isPositionVisible(Selection.StartTime))
+    {
+        emit positionRequested(std::max(0, Selection.StartTime - PageSizeMs / 4));
     }
+    requestFrame();
 }
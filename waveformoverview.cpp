@@ -0,0 +1,178 @@
+#include "waveformoverview.h"
+#include "waveformview.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+
+extern QColor WavBackColor;
+extern QColor WavColor;
+extern QColor RangeColor1;
+extern QColor SelectionColor;
+
+WaveformOverview::WaveformOverview(QWidget *parent) :
+    QWidget(parent)
+{
+    setFixedHeight(48);
+}
+
+void WaveformOverview::setSource(WaveformViewport *source)
+{
+    if(Source)
+    {
+        disconnect(Source, nullptr, this, nullptr);
+    }
+    Source = source;
+    if(Source)
+    {
+        connect(Source, SIGNAL(viewChanged()), this, SLOT(update()));
+        connect(Source, SIGNAL(subtitlesChanged()), this, SLOT(invalidate()));
+    }
+    invalidate();
+}
+
+void WaveformOverview::setProgress(int percent)
+{
+    if(Progress != percent)
+    {
+        Progress = percent;
+        update();
+    }
+}
+
+void WaveformOverview::invalidate()
+{
+    CacheValid = false;
+    update();
+}
+
+int WaveformOverview::lengthMs() const
+{
+    return Source->audioLength() * 1000;
+}
+
+void WaveformOverview::renderCache()
+{
+    Cache = QImage(size(), QImage::Format_RGB32);
+    Cache.fill(WavBackColor);
+    CacheValid = true;
+
+    const Peaks &PData = Source->peaks();
+    if(PData.empty() || width() <= 0) return;
+
+    QPainter painter(&Cache);
+
+    int WavHeight = height() - DensityHeight;
+    int Middle = (WavHeight - 1) / 2;
+    double PeaksPerPixel = double(PData.peaksNumber()) / width();
+
+    // Each column shows the extremes of all the peaks it covers,
+    // so every peak is read exactly once
+    painter.setPen(WavColor);
+    for(int curr_pixel = 0; curr_pixel < width(); ++curr_pixel)
+    {
+        std::size_t FirstPeak = std::floor(PeaksPerPixel * curr_pixel);
+        std::size_t LastPeak = std::floor(PeaksPerPixel * (curr_pixel + 1));
+        if(FirstPeak >= PData.peaksNumber()) break;
+        if(LastPeak <= FirstPeak) LastPeak = FirstPeak + 1;
+        if(LastPeak > PData.peaksNumber()) LastPeak = PData.peaksNumber();
+
+        int peakMin = PData[FirstPeak].min();
+        int peakMax = PData[FirstPeak].max();
+        for(std::size_t peakIndex = FirstPeak + 1; peakIndex < LastPeak; ++peakIndex)
+        {
+            if(PData[peakIndex].min() < peakMin) peakMin = PData[peakIndex].min();
+            if(PData[peakIndex].max() > peakMax) peakMax = PData[peakIndex].max();
+        }
+
+        int scaledPeakMax = std::round((double(peakMax) * WavHeight) / 65536);
+        int scaledPeakMin = std::round((double(peakMin) * WavHeight) / 65536);
+        painter.drawLine(QPoint(curr_pixel, Middle - scaledPeakMax), QPoint(curr_pixel, Middle - scaledPeakMin));
+    }
+
+    // Subtitle density
+    RangeList *Subs = Source->subtitleData().subs();
+    double MsPerPixel = double(lengthMs()) / width();
+    for(int curr_pixel = 0; curr_pixel < width(); ++curr_pixel)
+    {
+        int Count = Subs->countOverlapping(std::round(MsPerPixel * curr_pixel), std::round(MsPerPixel * (curr_pixel + 1)) - 1);
+        if(Count > 0)
+        {
+            QColor DensityColor = RangeColor1;
+            DensityColor.setAlpha(std::min(255, 96 + 40 * Count));
+            painter.fillRect(QRect(curr_pixel, WavHeight, 1, DensityHeight), DensityColor);
+        }
+    }
+}
+
+void WaveformOverview::paintProgress(QPainter &painter)
+{
+    painter.fillRect(rect(), WavBackColor);
+    painter.fillRect(QRect(0, 0, (width() * Progress) / 100, height()), SelectionColor);
+    painter.setPen(WavColor);
+    painter.drawText(rect(), Qt::AlignCenter, tr("Extracting peaks... %1%").arg(Progress));
+}
+
+void WaveformOverview::paintEvent(QPaintEvent *ev)
+{
+    Q_UNUSED(ev)
+
+    QPainter painter(this);
+
+    if(!Source)
+    {
+        paintProgress(painter);
+        return;
+    }
+
+    if(!CacheValid || Cache.size() != size())
+    {
+        renderCache();
+    }
+    painter.drawImage(0, 0, Cache);
+
+    // Highlight the portion shown by the viewport
+    int Length = lengthMs();
+    if(Length > 0)
+    {
+        int x1 = (double(Source->position()) * width()) / Length;
+        int x2 = (double(Source->position() + Source->pageSize()) * width()) / Length;
+        if(x2 <= x1) x2 = x1 + 1;
+        painter.fillRect(QRect(QPoint(x1, 0), QPoint(x2, height() - 1)), SelectionColor);
+        painter.setPen(WavColor);
+        painter.drawRect(QRect(QPoint(x1, 0), QPoint(x2, height() - 1)));
+    }
+}
+
+void WaveformOverview::resizeEvent(QResizeEvent *ev)
+{
+    QWidget::resizeEvent(ev);
+    CacheValid = false;
+}
+
+void WaveformOverview::requestPositionAt(int x)
+{
+    if(!Source || width() <= 0) return;
+
+    Constrain(x, 0, width() - 1);
+
+    // Center the viewport on the clicked point
+    int PosMs = (double(x) * lengthMs()) / width() - Source->pageSize() / 2;
+    if(PosMs < 0) PosMs = 0;
+    emit positionRequested(PosMs);
+}
+
+void WaveformOverview::mousePressEvent(QMouseEvent *ev)
+{
+    if(ev->button() == Qt::LeftButton)
+    {
+        requestPositionAt(ev->pos().x());
+    }
+}
+
+void WaveformOverview::mouseMoveEvent(QMouseEvent *ev)
+{
+    if(ev->buttons() & Qt::LeftButton)
+    {
+        requestPositionAt(ev->pos().x());
+    }
+}
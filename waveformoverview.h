@@ -0,0 +1,55 @@
+#ifndef WAVEFORMOVERVIEW_H
+#define WAVEFORMOVERVIEW_H
+
+#include <QWidget>
+#include <QImage>
+
+class WaveformViewport;
+
+// Strip showing the whole waveform and the subtitle density of the file,
+// with the portion currently shown by a WaveformViewport highlighted.
+// Clicking or dragging on it moves the viewport there.
+// Until a viewport is set, it shows the progress of the peaks extraction
+class WaveformOverview : public QWidget
+{
+    Q_OBJECT
+
+public:
+    WaveformOverview(QWidget *parent = nullptr);
+
+    void setSource(WaveformViewport *source);
+
+public slots:
+    void setProgress(int percent);
+
+    // Schedule a new rendering of the waveform and the subtitles
+    void invalidate();
+
+signals:
+    void positionRequested(int PosMs);
+
+protected:
+    void paintEvent(QPaintEvent *ev) override;
+    void resizeEvent(QResizeEvent *ev) override;
+    void mousePressEvent(QMouseEvent *ev) override;
+    void mouseMoveEvent(QMouseEvent *ev) override;
+
+private:
+    void renderCache();
+    void paintProgress(QPainter &painter);
+    void requestPositionAt(int x);
+
+    int lengthMs() const;
+
+private:
+    WaveformViewport *Source = nullptr;
+
+    QImage Cache; // Whole waveform and subtitle density, rendered once
+    bool CacheValid = false;
+
+    int Progress = 0; // Extraction progress in percent
+
+    int DensityHeight = 6; // Height of the subtitle density strip at the bottom
+};
+
+#endif // WAVEFORMOVERVIEW_H
@@ -1,89 +1,286 @@
 #include "waveformview.h"
 
-bool WaveformViewport::findFocusingSubtitle(int CursorPosMs, RangeList &RL, int ToleranceFromBorder, int PositionTolerance)
+bool WaveformViewport::findFocusingSubtitle(int Xpos, RangeList &RL)
 {
-    FocusingMode NewFocusMode = FocusNone;
-    int NewFocusedTime = -1;
-    bool Result = false;
+    const HoverHit &Hit = hoverHitMap(RL).Columns[Xpos];
 
-    if(ToleranceFromBorder < 1) ToleranceFromBorder = 1;
-
-    auto it = RL.first_at(CursorPosMs, PositionTolerance);
-    while(it != RL.end_search())
-    {
-        if(checkRangeForFocusing(it->Time, CursorPosMs, ToleranceFromBorder, NewFocusMode, NewFocusedTime))
-        {
-            Result = true;
-            break;
-        }
-        ++it;
-    }
-
-    if(NewFocusMode != FocusNone)
+    if(Hit.Mode != FocusNone)
     {
         setCursor(Qt::SizeHorCursor);
-        FocusMode = NewFocusMode;
+        FocusMode = Hit.Mode;
         OldFocusedSubtitle = FocusedSubtitle;
-        FocusedTimeMs = NewFocusedTime;
-        if(it->Time != Selection)
+        FocusedTimeMs = Hit.TimeMs;
+        if(RL.find(Hit.Sub)->Time != Selection)
         {
-            FocusedSubtitle = it;
+            FocusedSubtitle = Hit.Sub;
         }
         else if(SData.hasSelected())
         {
-            FocusedSubtitle = SData.selectedSubtitle();
+            FocusedSubtitle = SData.selectedHandle();
         }
         else
         {
             // This should be unreachable, I guess
-            FocusedSubtitle = SData.end();
+            FocusedSubtitle = SubtitleHandle();
         }
     }
 
     if(FocusedSubtitle != OldFocusedSubtitle)
     {
-        if(hasFocusedSubtitle() && FocusMode != FocusNone)
+        requestFrame();
+    }
+
+    return Hit.Mode != FocusNone;
+}
+
+const WaveformViewport::HoverHitMap &WaveformViewport::hoverHitMap(RangeList &RL)
+{
+    auto Map = std::find_if(HoverHitMaps.begin(), HoverHitMaps.end(), [&RL](const HoverHitMap &M)
+    {
+        return M.List == &RL;
+    });
+    if(Map == HoverHitMaps.end())
+    {
+        HoverHitMaps.push_back(HoverHitMap { &RL, 0, -1, -1, -1, std::vector<HoverHit>() });
+        Map = HoverHitMaps.end() - 1;
+    }
+
+    const int Width = width();
+    if(Map->Revision == RL.revision() && Map->PositionMs == PositionMs &&
+            Map->PageSizeMs == PageSizeMs && Map->Width == Width)
+    {
+        return *Map;
+    }
+
+    Map->Revision = RL.revision();
+    Map->PositionMs = PositionMs;
+    Map->PageSizeMs = PageSizeMs;
+    Map->Width = Width;
+    Map->Columns.assign(Width, HoverHit { FocusNone, -1, SubtitleHandle() });
+    if(Width == 0) return *Map;
+
+    // First, boundaries of the subtitles under the mouse, within 4 pixels.
+    // Then boundaries of the subtitles at most 2 pixels away, within 2 pixels
+    struct Pass
+    {
+        int ToleranceFromBorder;
+        int PositionTolerance;
+    };
+    const Pass Passes[] = {
+        { std::max(1, int(pixelToRelTime(4))), 0 },
+        { std::max(1, int(pixelToRelTime(2))), std::max(1, int(pixelToRelTime(2))) }
+    };
+
+    const double PixelPerMs = Width / double(PageSizeMs);
+    const int FirstMs = pixelToTime(0);
+    const int LastMs = pixelToTime(Width - 1);
+
+    for(const Pass &P : Passes)
+    {
+        const int Tolerance = P.ToleranceFromBorder;
+        auto it = RL.first_at((FirstMs + LastMs) / 2, (LastMs - FirstMs) / 2 + P.PositionTolerance + 1);
+        for(; it != RL.end_search(); ++it)
         {
-            // TODO
+            const Range &R = it->Time;
+            const int Boundaries[] = { R.StartTime, R.EndTime };
+            for(int Boundary : Boundaries)
+            {
+                // Columns whose time may be within the tolerance from the boundary
+                int FromX = std::floor((Boundary - Tolerance - PositionMs) * PixelPerMs) - 1;
+                int ToX = std::ceil((Boundary + Tolerance - PositionMs) * PixelPerMs) + 1;
+                Constrain(FromX, 0, Width - 1);
+                Constrain(ToX, 0, Width - 1);
+
+                for(int x = FromX; x <= ToX; ++x)
+                {
+                    // Earlier passes and earlier subtitles win,
+                    // as they would be found first by a lookup
+                    HoverHit &Hit = Map->Columns[x];
+                    if(Hit.Mode != FocusNone) continue;
+
+                    int CursorPosMs = pixelToTime(x);
+                    if(R.StartTime > CursorPosMs + P.PositionTolerance || R.EndTime < CursorPosMs - P.PositionTolerance) continue;
+
+                    FocusingMode Mode;
+                    int TimeMs;
+                    if(checkRangeForFocusing(R, CursorPosMs, Tolerance, Mode, TimeMs))
+                    {
+                        Hit = HoverHit { Mode, TimeMs, RL.handle(RangeList::iterator(it)) };
+                    }
+                }
+            }
         }
-        update();
     }
 
-    return Result;
+    return *Map;
 }
 
-int WaveformViewport::findSnappingPoint(int PosMs, RangeList &RL)
+void WaveformViewport::setSelectedTiming(const Range &NewTime)
 {
-    constexpr int SNAPPING_DISTANCE_PIXEL = 8;
+    SubChanged = true;
+    auto Selected = SData.selectedSubtitle();
+    moveSubtitleSnapping(*SData.subs(), Selected->Time, NewTime);
+    SData.setTiming(Selected, NewTime);
+}
+
+void WaveformViewport::initSnapping()
+{
+    // Minimum blank edges win over everything, then subtitle boundaries
+    MinBlankSnapping = Snapping.addSource(SnapMinBlank, 4);
+    for(const RangeList *RL : DisplayRangeLists)
+    {
+        TrackSnapping Track { RL, Snapping.addSource(SnapSubtitleStart, 3), Snapping.addSource(SnapSubtitleEnd, 3) };
+        rebuildSubtitleSnapping(Track);
+        SnappingTracks.push_back(Track);
+    }
+    SceneChangeSnapping = Snapping.addSource(SnapSceneChange, 2);
+    PlayCursorSnapping = Snapping.addSource(SnapPlayCursor, 2);
+    SpeechOnsetSnapping = Snapping.addSource(SnapSpeechOnset, 1);
 
-    int Candidate = -1;
+    Snapping.insertPoint(PlayCursorSnapping, PlayCursorMs);
+}
 
-    int SnappingDistanceTime = pixelToRelTime(SNAPPING_DISTANCE_PIXEL);
+void WaveformViewport::rebuildSubtitleSnapping(const TrackSnapping &Track)
+{
+    std::vector<int> Starts, Ends;
+    Starts.reserve(Track.List->size());
+    Ends.reserve(Track.List->size());
+    for(const Range &Time : Track.List->times())
+    {
+        Starts.push_back(Time.StartTime);
+        Ends.push_back(Time.EndTime);
+    }
+    Snapping.setPoints(Track.Starts, std::move(Starts));
+    Snapping.setPoints(Track.Ends, std::move(Ends));
+}
 
+void WaveformViewport::transformSubtitles(const TimeMap &map, bool selectedOnly)
+{
+    if(selectedOnly)
+    {
+        if(!SData.hasSelected()) return;
+        auto Selected = SData.selectedSubtitle();
+        SData.transformTimes(map, Selected, Selected + 1);
+    }
+    else
+    {
+        SData.transformTimes(map, SData.begin(), SData.end());
+    }
+
+    rebuildSubtitleSnapping(snappingTrack(SData.subs()));
+    if(SData.hasSelected())
+    {
+        Selection = SData.selectedSubtitle()->Time;
+    }
+
+    emit subtitlesChanged();
+    requestFrame();
+}
+
+void WaveformViewport::moveSubtitleSnapping(const RangeList &RL, const Range &OldTime, const Range &NewTime)
+{
+    const TrackSnapping &Track = snappingTrack(&RL);
+    Snapping.movePoint(Track.Starts, OldTime.StartTime, NewTime.StartTime);
+    Snapping.movePoint(Track.Ends, OldTime.EndTime, NewTime.EndTime);
+}
+
+void WaveformViewport::updateMinBlankSnapping()
+{
+    std::vector<int> Points;
     if(MinimumBlankMs > 0)
     {
         if(Info1.exists())
         {
-            Candidate = Info1.getSnappingPoint(MinimumBlankMs);
-            if(std::abs(Candidate - PosMs) <= SnappingDistanceTime)
-            {
-                return Candidate;
-            }
+            Points.push_back(Info1.getSnappingPoint(MinimumBlankMs));
         }
-
         if(Info2.exists())
         {
-            Candidate = Info2.getSnappingPoint(MinimumBlankMs);
-            if(std::abs(Candidate - PosMs) <= SnappingDistanceTime)
+            Points.push_back(Info2.getSnappingPoint(MinimumBlankMs));
+        }
+    }
+    Snapping.setPoints(MinBlankSnapping, std::move(Points));
+}
+
+void WaveformViewport::journalEntryApplied(const EditJournal::Entry &entry, bool reverted)
+{
+    // Keep the snapping points in sync with the changed subtitles,
+    // in the order the changes were applied.
+    // Large entries, e.g. transforms of a whole track, are cheaper to rebuild
+    const TrackSnapping &Track = snappingTrack(SData.subs());
+    const int Count = entry.Deltas.size();
+    if(Count > MaxSnappingMoves)
+    {
+        rebuildSubtitleSnapping(Track);
+    }
+    else
+    {
+        for(int i = 0; i < Count; ++i)
+        {
+            const EditDelta &Delta = entry.Deltas[reverted ? Count - 1 - i : i];
+            switch(Delta.Type)
             {
-                return Candidate;
+            case EditDelta::Timing:
+                moveSubtitleSnapping(*SData.subs(), reverted ? Delta.NewTime : Delta.OldTime, reverted ? Delta.OldTime : Delta.NewTime);
+                break;
+            case EditDelta::Insert:
+            case EditDelta::Remove:
+            {
+                const Range &Time = Delta.Type == EditDelta::Insert ? Delta.NewTime : Delta.OldTime;
+                if((Delta.Type == EditDelta::Insert) != reverted)
+                {
+                    Snapping.insertPoint(Track.Starts, Time.StartTime);
+                    Snapping.insertPoint(Track.Ends, Time.EndTime);
+                }
+                else
+                {
+                    Snapping.removePoint(Track.Starts, Time.StartTime);
+                    Snapping.removePoint(Track.Ends, Time.EndTime);
+                }
+                break;
+            }
+            case EditDelta::Text:
+            case EditDelta::Renumber:
+                break;
             }
         }
     }
 
-    // TODO: Add SceneChanges
+    // The selection follows the selected subtitle
+    if(SData.hasSelected())
+    {
+        Selection = SData.selectedSubtitle()->Time;
+    }
+
+    emit subtitlesChanged();
+    requestFrame();
+}
+
+int WaveformViewport::findSnappingPoint(int PosMs, RangeList &RL)
+{
+    constexpr int SNAPPING_DISTANCE_PIXEL = 8;
+
+    int SnappingDistanceTime = pixelToRelTime(SNAPPING_DISTANCE_PIXEL);
+
+    // Min blank edges follow the subtitles they refer to
+    updateMinBlankSnapping();
+
+    SnappingPoint Point;
+    auto Selected = SData.selectedSubtitle();
+    if(Selected != SData.end())
+    {
+        // The selected subtitle must not snap to its own boundaries
+        const TrackSnapping &Track = snappingTrack(SData.subs());
+        Point = Snapping.nearest(PosMs, SnappingDistanceTime, {
+            SnappingIndex::Exclusion { Track.Starts, Selected->Time.StartTime },
+            SnappingIndex::Exclusion { Track.Ends, Selected->Time.EndTime }
+        });
+    }
+    else
+    {
+        Point = Snapping.nearest(PosMs, SnappingDistanceTime);
+    }
 
-    return -1;
+    return Point.Exists ? Point.TimeMs : -1;
 }
 
 int WaveformViewport::findCorrectedSnappingPoint(int PosMs, RangeList &RL)
@@ -105,7 +302,7 @@ int WaveformViewport::findCorrectedSnappingPoint(int PosMs, RangeList &RL)
 }
 
 
-bool WaveformViewport::checkRangeForFocusing(Range &R, int CursorPosMs, int ToleranceFromBorder, FocusingMode &NewMode, int &NewFocusTime)
+bool WaveformViewport::checkRangeForFocusing(const Range &R, int CursorPosMs, int ToleranceFromBorder, FocusingMode &NewMode, int &NewFocusTime)
 {
     if(R.duration() / ToleranceFromBorder > 2)
     {
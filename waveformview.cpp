@@ -5,6 +5,8 @@
 
 #include "renderer.h"
 
+#include <QElapsedTimer>
+
 QColor WavBackColor = QColor(11, 19, 43);
 QColor WavColor = QColor(111, 255, 233);
 QColor RangeColor1 = QColor(62, 120, 178);
@@ -13,13 +15,14 @@ QColor RangeColorNonEditable = QColor(141, 153, 174);
 QColor SelectionColor = QColor(255, 255, 255, 50);
 QColor MinBlankColor = QColor(255, 255, 255, 80);
 QColor CursorColor = QColor(74, 49, 77);
+QColor ViolationColor = QColor(255, 60, 60, 60);
 
 WaveformViewport::WaveformViewport(AbstractRenderer *rend, Peaks &&pdata, SubtitleData &&sdata, QWidget *parent) :
         QOpenGLWidget(parent),
         PData(std::move(pdata)),
         SData(std::move(sdata)),
         Rend(rend),
-        FocusedSubtitle(SData.end())
+        Scheduler(this)
 {
     if(SData.hasVO())
     {
@@ -29,7 +32,13 @@ WaveformViewport::WaveformViewport(AbstractRenderer *rend, Peaks &&pdata, Subtit
     SData.setSelectedSubtitle(SData.begin());
     Selection = SData.selectedSubtitle()->Time;
 
-    FocusedSubtitle = SData.end(); // No Focused Subtitle
+    FocusedSubtitle = SubtitleHandle(); // No Focused Subtitle
+
+    initSnapping();
+
+    ValidationRules Rules = SData.validator().rules();
+    Rules.MinimumBlankMs = MinimumBlankMs;
+    SData.setValidationRules(Rules);
 
     //connect(&PlayCursorUpdater, SIGNAL(timeout()), this, SLOT(updatePlayCursorPos()));
     //PlayCursorUpdater.start(UpdateIntervalMs);
@@ -40,6 +49,41 @@ WaveformViewport::WaveformViewport(AbstractRenderer *rend, Peaks &&pdata, Subtit
     setMouseTracking(true);
 }
 
+void WaveformViewport::paintFrame(QPainter &painter, FramePassTimings *timings)
+{
+    FramePassTimings Timings;
+    QElapsedTimer PassTimer;
+
+    // Return the time elapsed since the previous pass and restart the timer
+    auto passTime = [&PassTimer]()
+    {
+        double Result = PassTimer.nsecsElapsed() / 1000000.0;
+        PassTimer.restart();
+        return Result;
+    };
+
+    PassTimer.start();
+    paintWav(painter);
+    Timings.Wav = passTime();
+    paintRuler(painter);
+    Timings.Ruler = passTime();
+    paintMinimumBlank(painter, 0, height() - 1);
+    Timings.MinimumBlank = passTime();
+    paintRangeLists(painter);
+    Timings.RangeLists = passTime();
+    paintSelection(painter);
+    Timings.Selection = passTime();
+    paintCursor(painter);
+    Timings.Cursor = passTime();
+    paintPlayCursor(painter);
+    Timings.PlayCursor = passTime();
+
+    if(timings)
+    {
+        *timings = Timings;
+    }
+}
+
 void WaveformViewport::paintWav(QPainter &painter)
 {
     double PeaksPerSecond = double(PData.sampleRate()) / PData.samplesPerPeak();
@@ -53,6 +97,13 @@ void WaveformViewport::paintWav(QPainter &painter)
     int pixel_end = width();
 
     unsigned int peaks_per_pixel = std::round(PeaksPerPixel);
+
+    // At draft quality read only a few of the peaks of each pixel
+    unsigned int peak_step = 1;
+    if(isDraft() && peaks_per_pixel > DraftPeaksPerPixel)
+    {
+        peak_step = peaks_per_pixel / DraftPeaksPerPixel;
+    }
     unsigned int peakIndex;
 
     // Peak to be shown
@@ -88,7 +139,7 @@ void WaveformViewport::paintWav(QPainter &painter)
         peakMax = PData[peakIndex].max();
 
         // If more than one peak per pixel needs to be shown, calculate the maximum and the minimum peaks among them and represent that peak
-        for(unsigned int peakCount = 1; peakIndex + peakCount < PData.peaksNumber() && peakCount < peaks_per_pixel; ++peakCount)
+        for(unsigned int peakCount = peak_step; peakIndex + peakCount < PData.peaksNumber() && peakCount < peaks_per_pixel; peakCount += peak_step)
         {
             if(PData[peakIndex + peakCount].min() < peakMin) peakMin = PData[peakIndex + peakCount].min();
             if(PData[peakIndex + peakCount].max() > peakMax) peakMax = PData[peakIndex + peakCount].max();
@@ -129,6 +180,18 @@ void WaveformViewport::paintRanges(QPainter &painter, RangeList &Subs, int topPo
     int y1 = topPos + RangeHeightDiv10;
     int y2 = bottomPos - RangeHeightDiv10;
 
+    // Focused subtitles and validation problems are always in the editable list
+    const bool IsEdited = &Subs == SData.subs();
+    RangeList::iterator Focused = IsEdited ? Subs.find(FocusedSubtitle) : Subs.end();
+
+    // When the visible ranges are too many to get a few pixels each, most of them land
+    // on the same pixels, so draw how many ranges cover each pixel column instead
+    if(Subs.countOverlapping(PositionMs, PositionMs + PageSizeMs) > width() / MinExactRangeWidthPx)
+    {
+        paintRangesDensity(painter, Subs, y1, y2, Colors[0]);
+        return;
+    }
+
     RangeList::iterator subs = Subs.subsAheadOf(PositionMs);
     while(subs != Subs.end() && subs->Time.StartTime <= PositionMs + PageSizeMs)
     {
@@ -140,7 +203,7 @@ void WaveformViewport::paintRanges(QPainter &painter, RangeList &Subs, int topPo
             QPen OldPen = painter.pen();
             QPen NewPen = OldPen;
             // If time is focused draw solid line, otherwise dot line
-            if(FocusMode == FocusBegin && FocusedSubtitle == subs)
+            if(FocusMode == FocusBegin && Focused == subs)
             {
                 NewPen.setStyle(Qt::SolidLine);
             }
@@ -160,7 +223,7 @@ void WaveformViewport::paintRanges(QPainter &painter, RangeList &Subs, int topPo
             QPen OldPen = painter.pen();
             QPen NewPen = OldPen;
             // If time is focused draw solid line, otherwise dot line
-            if(FocusMode == FocusEnd && FocusedSubtitle == subs)
+            if(FocusMode == FocusEnd && Focused == subs)
             {
                 NewPen.setStyle(Qt::SolidLine);
             }
@@ -175,6 +238,10 @@ void WaveformViewport::paintRanges(QPainter &painter, RangeList &Subs, int topPo
 
             painter.setPen(OldPen);
         }
+        if(IsEdited && SData.validator().flags(Subs.handle(subs)))
+        {
+            painter.fillRect(QRect(QPoint(h_line_begin, y1), QPoint(h_line_end, y2)), ViolationColor);
+        }
         if(topLine)
         {
             painter.drawLine(QPoint(h_line_begin, y1), QPoint(h_line_end, y1));
@@ -184,20 +251,51 @@ void WaveformViewport::paintRanges(QPainter &painter, RangeList &Subs, int topPo
             painter.drawLine(QPoint(h_line_begin, y2), QPoint(h_line_end, y2));
         }
 
-        if(h_line_end - h_line_begin > 10)
+        // Text is skipped at draft quality
+        if(!isDraft() && h_line_end - h_line_begin > 10)
         {
             const int TextMargins = 5, MinSpace = 25;
             QRect CustomDrawRect(QPoint(h_line_begin + TextMargins, y1), QPoint(h_line_end + TextMargins, y2));
             if(CustomDrawRect.width() > MinSpace)
             {
-                QTextOption Opt = topLine ? QTextOption() : QTextOption(Qt::AlignBottom);
-                painter.drawText(CustomDrawRect, subs->Text, Opt);
+                const TextLayoutCache::Entry *Layout = TextLayouts.layout(subs->Text, painter.font(), CustomDrawRect.width(), CustomDrawRect.height(), !topLine);
+                if(Layout)
+                {
+                    painter.drawStaticText(CustomDrawRect.topLeft() + Layout->Offset, Layout->Text);
+                }
             }
         }
         ++subs;
     }
 }
 
+void WaveformViewport::paintRangesDensity(QPainter &painter, RangeList &Subs, int topPos, int bottomPos, const QColor &color)
+{
+    // Columns covered by the same number of ranges are filled together
+    int RunStart = 0;
+    int RunCount = 0;
+    for(int curr_pixel = 0; curr_pixel <= width(); ++curr_pixel)
+    {
+        int Count = 0;
+        if(curr_pixel < width())
+        {
+            Count = Subs.countOverlapping(pixelToTime(curr_pixel), pixelToTime(curr_pixel + 1) - 1);
+        }
+        if(Count != RunCount || curr_pixel == width())
+        {
+            if(RunCount > 0)
+            {
+                // The more ranges overlap, the more opaque the bar
+                QColor RunColor = color;
+                RunColor.setAlpha(std::min(255, 96 + 40 * RunCount));
+                painter.fillRect(QRect(QPoint(RunStart, topPos), QPoint(curr_pixel - 1, bottomPos)), RunColor);
+            }
+            RunStart = curr_pixel;
+            RunCount = Count;
+        }
+    }
+}
+
 void WaveformViewport::paintRangeLists(QPainter &painter)
 {
     int Height = height() - RulerHeight;
@@ -15,6 +15,10 @@
 #include "constrain.h"
 
 #include "model.h"
+#include "textlayoutcache.h"
+#include "renderscheduler.h"
+#include "snappingindex.h"
+#include "trackalignment.h"
 
 #include <iostream>
 
@@ -22,6 +26,18 @@
 
 class AbstractRenderer;
 
+// Time spent in each painting pass of a frame, in milliseconds
+struct FramePassTimings
+{
+    double Wav = 0.0;
+    double Ruler = 0.0;
+    double MinimumBlank = 0.0;
+    double RangeLists = 0.0;
+    double Selection = 0.0;
+    double Cursor = 0.0;
+    double PlayCursor = 0.0;
+};
+
 class WaveformViewport : public QOpenGLWidget
 {
     Q_OBJECT
@@ -33,8 +49,27 @@ class WaveformViewport : public QOpenGLWidget
 
     AbstractRenderer *Rend;
 
+    RenderScheduler Scheduler;
+
     std::vector<RangeList *> DisplayRangeLists;
 
+    TextLayoutCache TextLayouts; // Layout of the subtitle texts drawn in paintRanges
+
+    SnappingIndex Snapping; // Times the cursor snaps to
+
+    // Snapping sources of the boundaries of a displayed subtitle list
+    struct TrackSnapping
+    {
+        const RangeList *List;
+        SnappingIndex::SourceId Starts;
+        SnappingIndex::SourceId Ends;
+    };
+    std::vector<TrackSnapping> SnappingTracks;
+    SnappingIndex::SourceId MinBlankSnapping;
+    SnappingIndex::SourceId SceneChangeSnapping;
+    SnappingIndex::SourceId SpeechOnsetSnapping;
+    SnappingIndex::SourceId PlayCursorSnapping;
+
     enum FocusingMode
     {
         FocusBegin,
@@ -42,6 +77,26 @@ class WaveformViewport : public QOpenGLWidget
         FocusNone
     };
 
+    // Subtitle boundary focused by the mouse hovering a pixel column
+    struct HoverHit
+    {
+        FocusingMode Mode; // FocusNone if no boundary is near
+        int TimeMs;
+        SubtitleHandle Sub;
+    };
+
+    // Hover hits of every pixel column for a displayed list,
+    // valid as long as the view and the list don't change
+    struct HoverHitMap
+    {
+        const RangeList *List;
+        unsigned int Revision;
+        int PositionMs;
+        int PageSizeMs;
+        int Width;
+        std::vector<HoverHit> Columns;
+    };
+    std::vector<HoverHitMap> HoverHitMaps;
 
 
 public:
@@ -51,12 +106,14 @@ public:
     void setPosition(int position)
     {
         PositionMs = position;
+        emit viewChanged();
         //update();
     }
 
     void incrementPosition(int increment)
     {
         PositionMs += increment;
+        emit viewChanged();
     }
 
     int position() const
@@ -72,29 +129,121 @@ public:
     void setPageSize(int pageSize)
     {
         PageSizeMs = pageSize;
+        emit viewChanged();
     }
 
     int pageSize() const
     {
         return PageSizeMs;
     }
+
+    const Peaks &peaks() const
+    {
+        return PData;
+    }
+
+    SubtitleData &subtitleData()
+    {
+        return SData;
+    }
+
+    // Schedule a repaint, merged with the other requests up to the display refresh rate
+    void requestFrame()
+    {
+        Scheduler.requestFrame();
+    }
+
+    // Schedule a repaint caused by user input,
+    // frames are drawn at draft quality until input settles
+    void requestInteractiveFrame()
+    {
+        Scheduler.notifyInteraction();
+        Scheduler.requestFrame();
+    }
+
+    const RenderScheduler &scheduler() const
+    {
+        return Scheduler;
+    }
+
+    void setVerticalScaling(int scaling)
+    {
+        VerticalScaling = scaling;
+    }
+
+    int verticalScaling() const
+    {
+        return VerticalScaling;
+    }
+
+    // Times of scene changes, the cursor snaps to them
+    void setSceneChanges(std::vector<int> &&timesMs)
+    {
+        Snapping.setPoints(SceneChangeSnapping, std::move(timesMs));
+    }
+
+    const std::vector<int> &sceneChanges() const
+    {
+        return Snapping.points(SceneChangeSnapping);
+    }
+
+    // Times where speech starts, the cursor snaps to them
+    void setSpeechOnsets(std::vector<int> &&timesMs)
+    {
+        Snapping.setPoints(SpeechOnsetSnapping, std::move(timesMs));
+    }
     // --------------------------------------
 
+    // Apply the changes of a subtitle file modified by another program, keeping the selection.
+    // Returns false, changing nothing, while a subtitle is being dragged
+    bool applySubtitleDiff(SubtitleDiff &&diff);
+
+    // Match the editable subtitles with the VO, and give the ones matched with at least
+    // minConfidence the timing of their VO cue, as a single change to undo.
+    // Nothing is matched without a VO or while a subtitle is being dragged
+    TrackAlignment alignToVO(double minConfidence, TimingTransfer transfer = TimingTransfer::Copy);
+
+    // Map the timings of all the editable subtitles, or of the selected one only
+    void transformSubtitles(const TimeMap &map, bool selectedOnly = false);
+
+    // Paint a whole frame with painter, which must cover the viewport size.
+    // If timings is not null, it is filled with the time spent in each pass
+    void paintFrame(QPainter &painter, FramePassTimings *timings = nullptr);
+
+public slots:
+    void undo();
+    void redo();
+
+    // Select the next, or previous, subtitle with a validation problem
+    void nextViolation();
+    void previousViolation();
+
+    // Select the next free time, after the cursor, long enough for a new subtitle
+    void nextGap();
+
+    // Search the subtitles containing text, ignoring case and diacritics,
+    // and jump to the first match after the cursor
+    void findText(const QString &text);
+
+    // Jump to the next, or previous, subtitle matching the last search
+    void nextMatch();
+    void previousMatch();
+
+signals:
+    void viewChanged(); // Emitted when the position or the page size changes
+    void subtitlesChanged(); // Emitted when the timings of subtitles have been edited
+    void positionRequested(int PosMs); // Emitted to scroll the view to PosMs
 
 protected:
     void paintGL() override
     {
+        Scheduler.frameStarted();
         QPixmap offscreen(size());
         QPainter painter(&offscreen);
-        paintWav(painter);
-        paintRuler(painter);
-        paintMinimumBlank(painter, 0, offscreen.height() - 1);
-        paintRangeLists(painter);
-        paintSelection(painter);
-        paintCursor(painter);
-        paintPlayCursor(painter);
+        paintFrame(painter);
         QPainter p2(this);
         p2.drawPixmap(0, 0, offscreen);
+        Scheduler.frameFinished();
     }
 
     void wheelEvent(QWheelEvent *ev) override;
@@ -134,6 +283,7 @@ private:
     void paintRuler(QPainter &painter);
     void paintRangeLists(QPainter &painter);
     void paintRanges(QPainter &painter, RangeList &Subs, int topPos, int bottomPos, bool topLine, bool bottomLine);
+    void paintRangesDensity(QPainter &painter, RangeList &Subs, int topPos, int bottomPos, const QColor &color);
     void paintSelection(QPainter &painter);
     void paintCursor(QPainter &painter);
     void paintPlayCursor(QPainter &painter);
@@ -141,6 +291,11 @@ private:
 
     // Utilities ----------------------------------------
 
+    bool isDraft() const
+    {
+        return Scheduler.quality() == RenderScheduler::DraftQuality;
+    }
+
     bool isPositionVisible(int PosMs) const
     {
         return PositionMs <= PosMs && PosMs <= PositionMs + PageSizeMs;
@@ -156,7 +311,7 @@ private:
 
     bool hasFocusedSubtitle()
     {
-        return FocusedSubtitle != SData.end();
+        return SData.subs()->contains(FocusedSubtitle);
     }
 
     bool hasSelection()
@@ -164,13 +319,51 @@ private:
         return Selection.StartTime >= 0;
     }
 
-    bool findFocusingSubtitle(int CursorPosMs, RangeList &RL, int ToleranceFromBorder, int PositionTolerance);
+    // Focus the subtitle boundary of RL near the pixel column Xpos, if any
+    bool findFocusingSubtitle(int Xpos, RangeList &RL);
 
-    static bool checkRangeForFocusing(Range &R, int CursorPosMs, int ToleranceFromBorder, FocusingMode &NewMode, int &NewFocusTime);
+    // Return the hit map of RL, rebuilt if the view or the list changed
+    const HoverHitMap &hoverHitMap(RangeList &RL);
+
+    static bool checkRangeForFocusing(const Range &R, int CursorPosMs, int ToleranceFromBorder, FocusingMode &NewMode, int &NewFocusTime);
+
+    // Change the timing of the selected subtitle, keeping the iterators valid
+    void setSelectedTiming(const Range &NewTime);
 
     int findSnappingPoint(int PosMs, RangeList &RL);
     int findCorrectedSnappingPoint(int PosMs, RangeList &RL);
 
+    // Register the snapping sources and fill them
+    void initSnapping();
+
+    const TrackSnapping &snappingTrack(const RangeList *RL) const
+    {
+        return *std::find_if(SnappingTracks.cbegin(), SnappingTracks.cend(), [RL](const TrackSnapping &Track)
+        {
+            return Track.List == RL;
+        });
+    }
+
+    // Fill the snapping sources of Track from its list
+    void rebuildSubtitleSnapping(const TrackSnapping &Track);
+
+    // Move the snapping points of a subtitle of RL whose timing changes
+    void moveSubtitleSnapping(const RangeList &RL, const Range &OldTime, const Range &NewTime);
+
+    void updateMinBlankSnapping();
+
+    // Update the view after a journal entry has been undone or redone
+    void journalEntryApplied(const EditJournal::Entry &entry, bool reverted);
+
+    // Select sub, scrolling to it if it isn't visible
+    void selectViolation(SubtitleHandle sub);
+
+    // Select sub and centre the view on it
+    void selectMatch(SubtitleHandle sub);
+
+    // Search the last text again if the subtitles changed since
+    void updateMatches();
+
     // ----------------------------------------------------
 
     void mousePressCoolEdit(QMouseEvent *ev, RangeList &RangeListClicked);
@@ -187,6 +380,12 @@ private:
 
     int RulerHeight = 0; // Ruler height, if 0, the ruler won't be displayed
 
+    int MinExactRangeWidthPx = 4; // Width per visible range under which ranges are drawn as density bars
+
+    unsigned int DraftPeaksPerPixel = 4; // Maximum number of peaks read for each pixel at draft quality
+
+    int MaxSnappingMoves = 256; // Undone or redone changes over which snapping points are rebuilt instead of moved
+
     Range Selection = Range { -1, 0 }; // Range representing selection, if the selection is present Selection.StartTime >= 0 otherwise it's < 0
 
     int SelectionOriginMs = -1; // The point where the mouse was clicked before a selection was highlighted, if valid its value is >= 0, otherwise it's < 0
@@ -194,8 +393,8 @@ private:
 
     FocusingMode FocusMode = FocusNone; // Flag indicating if the Focused time is left or right limit of a range, if set to FocusNone, no time is focused
     int FocusedTimeMs; // Focused limit of a range
-    SubtitleData::iterator FocusedSubtitle; // If the focused time is of a subtitle, this iterator points to the desired subtitle, otherwise it's end() of SubtitleData
-    SubtitleData::iterator OldFocusedSubtitle; // Previous focused subtitle
+    SubtitleHandle FocusedSubtitle; // If the focused time is of a subtitle, this handle refers to the desired subtitle, otherwise it's null
+    SubtitleHandle OldFocusedSubtitle; // Previous focused subtitle
 
     bool MouseDown = false; // Flag indicating whether the left mouse button is currently down
 
@@ -207,7 +406,7 @@ private:
     int MinSelTime = -1; // Minimum valid time, if valid it's >= 0
     int MaxSelTime = -1; // Maximum valid time, if valid it's >= 0
 
-    bool SubChanged = false; // Flag indicating whether to sort subs
+    bool SubChanged = false; // Flag indicating whether subtitles have been edited
 
     // int UpdateIntervalMs = 17; // Set to 17 ms in order to try to achieve 60 fps
 
@@ -215,6 +414,11 @@ private:
 
     bool ShowMinBlank = true;
     int MinimumBlankMs = 1; //Minimum blank between subtitles
+    int MinimumGapMs = 1000; // Shortest free time, besides the minimum blanks, selected by nextGap()
+
+    QString SearchText;
+    std::vector<SubtitleHandle> SearchMatches; // In time order
+    unsigned int SearchRevision = 0; // Revision of the subtitles when SearchMatches was found
     MinBlankInfo Info1;
     MinBlankInfo Info2;
 
@@ -225,6 +429,8 @@ private slots:
 
 class WaveformView : public QAbstractScrollArea
 {
+    Q_OBJECT
+
 public:
     WaveformView(AbstractRenderer *R, Peaks &&pdata, SubtitleData &&sdata, QWidget *parent = nullptr) :
         QAbstractScrollArea(parent),
@@ -240,11 +446,22 @@ public:
         horizontalScrollBar()->setSingleStep(50);
     }
 
+    WaveformViewport *waveformViewport()
+    {
+        return Viewport;
+    }
+
+public slots:
+    void setPositionMs(int PosMs)
+    {
+        horizontalScrollBar()->setValue(PosMs);
+    }
+
 protected:
     void scrollContentsBy(int, int) override
     {
         Viewport->setPosition(horizontalScrollBar()->value());
-        Viewport->update();
+        Viewport->requestInteractiveFrame();
     }
 
 private: